@@ -0,0 +1,222 @@
+#include "CommandBuffer.h"
+#include "MaterialWithMesh.h"
+#include "Stats.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <new>
+#include <type_traits>
+
+LinearAllocator::LinearAllocator(size_t blockSize)
+    : blockSize(blockSize)
+{
+}
+
+void* LinearAllocator::Allocate(size_t size, size_t alignment)
+{
+    for (;;) {
+        if (current < blocks.size()) {
+            Block& block = blocks[current];
+            const uintptr_t base = reinterpret_cast<uintptr_t>(block.Data.get());
+            const size_t aligned = ((base + offset + alignment - 1) & ~(uintptr_t(alignment) - 1)) - base;
+            if (aligned + size <= block.Size) {
+                offset = aligned + size;
+                used += size;
+                return block.Data.get() + aligned;
+            }
+            // Не влезло - следующий блок, хвост этого пропадает до Reset
+            ++current;
+            offset = 0;
+            continue;
+        }
+        const size_t bytes = std::max(blockSize, size + alignment);
+        blocks.push_back({ std::unique_ptr<std::uint8_t[]>(new std::uint8_t[bytes]), bytes });
+    }
+}
+
+void LinearAllocator::Reset()
+{
+    current = 0;
+    offset = 0;
+    used = 0;
+}
+
+void CommandBuffer::Reset()
+{
+    allocator.Reset();
+    first = nullptr;
+    last = nullptr;
+    count = 0;
+}
+
+template <typename T>
+void CommandBuffer::Append(const T& command)
+{
+    // Память не освобождается поштучно, деструкторы не зовутся
+    static_assert(std::is_trivially_destructible<T>::value, "commands must be plain data");
+    T* stored = new (allocator.Allocate(sizeof(T), alignof(T))) T(command);
+    stored->Next = nullptr;
+    if (last != nullptr) {
+        last->Next = stored;
+    } else {
+        first = stored;
+    }
+    last = stored;
+    ++count;
+}
+
+void CommandBuffer::UseProgram(MaterialWithMesh* material)
+{
+    Append(UseProgramCommand{ { CommandType::UseProgram, nullptr }, material });
+}
+
+void CommandBuffer::BindTextures(const std::uint32_t (&textures)[COMMAND_TEXTURE_UNITS])
+{
+    BindTexturesCommand command{ { CommandType::BindTextures, nullptr }, {} };
+    std::copy(textures, textures + COMMAND_TEXTURE_UNITS, command.Textures);
+    Append(command);
+}
+
+void CommandBuffer::SetBlend(bool enabled)
+{
+    Append(SetBlendCommand{ { CommandType::SetBlend, nullptr }, enabled });
+}
+
+void CommandBuffer::SetMat4(ShaderParam param, const glm::mat4& value)
+{
+    Append(SetMat4Command{ { CommandType::SetMat4, nullptr }, param, value });
+}
+
+void CommandBuffer::SetFloat(ShaderParam param, float value)
+{
+    Append(SetFloatCommand{ { CommandType::SetFloat, nullptr }, param, value });
+}
+
+void CommandBuffer::BindUniformBlock(std::uint32_t binding, std::uint32_t buffer, size_t offset, size_t size)
+{
+    Append(BindUniformBlockCommand{ { CommandType::BindUniformBlock, nullptr }, binding, buffer, offset, size });
+}
+
+void CommandBuffer::Draw(const GeometryRange& range)
+{
+    Append(DrawCommand{ { CommandType::Draw, nullptr }, range });
+}
+
+void CommandBuffer::RecordParallel(ThreadPool& pool, std::vector<CommandBuffer>& buffers, size_t itemCount,
+    const std::function<void(size_t chunk, size_t first, size_t last, CommandBuffer& buffer)>& record)
+{
+    const size_t chunks = buffers.size();
+    pool.ParallelFor(chunks, [&](size_t chunk) {
+        CommandBuffer& buffer = buffers[chunk];
+        buffer.Reset();
+        record(chunk, itemCount * chunk / chunks, itemCount * (chunk + 1) / chunks, buffer);
+    });
+}
+
+void CommandExecutor::Begin()
+{
+    material = nullptr;
+    program = nullptr;
+    texturesKnown = false;
+    pool = GeometryRange::INVALID_POOL;
+}
+
+void CommandExecutor::Execute(const CommandBuffer& buffer, const std::function<void(MaterialWithMesh&)>& setupProgram)
+{
+    for (const Command* command = buffer.First(); command != nullptr; command = command->Next) {
+        switch (command->Type) {
+        case CommandType::UseProgram: {
+            material = static_cast<const UseProgramCommand*>(command)->Material;
+            if (material->GetProgramKey() == program) {
+                break;
+            }
+            program = material->GetProgramKey();
+            material->UseShaderProgram();
+            if (setupProgram) {
+                setupProgram(*material);
+            }
+            ++Stats::Frame.ProgramSwitches;
+            break;
+        }
+        case CommandType::BindTextures: {
+            const BindTexturesCommand& bind = *static_cast<const BindTexturesCommand*>(command);
+            bool switched = false;
+            for (unsigned unit = 0; unit < COMMAND_TEXTURE_UNITS; ++unit) {
+                if (bind.Textures[unit] == 0) {
+                    continue;
+                }
+                if (texturesKnown && textures[unit] == bind.Textures[unit]) {
+                    ++Stats::Frame.TextureBindsSkipped;
+                    continue;
+                }
+                glActiveTexture(GL_TEXTURE0 + unit);
+                glBindTexture(GL_TEXTURE_2D, bind.Textures[unit]);
+                textures[unit] = bind.Textures[unit];
+                ++Stats::Frame.TextureBinds;
+                switched = true;
+            }
+            // Блоки, которые первая команда кадра не задает, неизвестны: считаем их пустыми,
+            // чтобы привязка туда старой текстуры не пропустилась
+            if (!texturesKnown) {
+                for (unsigned unit = 0; unit < COMMAND_TEXTURE_UNITS; ++unit) {
+                    textures[unit] = bind.Textures[unit];
+                }
+            }
+            texturesKnown = true;
+            Stats::Frame.TextureSwitches += switched;
+            break;
+        }
+        case CommandType::SetBlend: {
+            const bool enabled = static_cast<const SetBlendCommand*>(command)->Enabled;
+            if (enabled == blending) {
+                break;
+            }
+            if (enabled) {
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            } else {
+                glDisable(GL_BLEND);
+            }
+            // Прозрачные проверяют глубину, но не пишут ее
+            glDepthMask(enabled ? GL_FALSE : GL_TRUE);
+            blending = enabled;
+            break;
+        }
+        case CommandType::SetMat4: {
+            const SetMat4Command& set = *static_cast<const SetMat4Command*>(command);
+            material->SetMat4(set.Param, set.Value);
+            break;
+        }
+        case CommandType::SetFloat: {
+            const SetFloatCommand& set = *static_cast<const SetFloatCommand*>(command);
+            material->SetFloat(set.Param, set.Value);
+            break;
+        }
+        case CommandType::BindUniformBlock: {
+            const BindUniformBlockCommand& bind = *static_cast<const BindUniformBlockCommand*>(command);
+            glBindBufferRange(GL_UNIFORM_BUFFER, bind.Binding, bind.Buffer, bind.Offset, bind.Size);
+            ++Stats::Frame.UniformBlockBinds;
+            break;
+        }
+        case CommandType::Draw: {
+            const GeometryRange& range = static_cast<const DrawCommand*>(command)->Range;
+            if (range.Pool != pool) {
+                pool = range.Pool;
+                ++Stats::Frame.VertexArraySwitches;
+            }
+            GeometryArena::Draw(range);
+            ++Stats::Frame.QueuedPackets;
+            break;
+        }
+        }
+    }
+}
+
+void CommandExecutor::End()
+{
+    if (blending) {
+        glDisable(GL_BLEND);
+        glDepthMask(GL_TRUE);
+        blending = false;
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
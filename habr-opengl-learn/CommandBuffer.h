@@ -0,0 +1,180 @@
+#pragma once
+#include "Common.h"
+#include "GeometryArena.h"
+#include "ShaderReflection.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+class MaterialWithMesh;
+class ThreadPool;
+
+// Сколько текстурных блоков задает BindTextures
+const unsigned COMMAND_TEXTURE_UNITS = 2;
+
+// Память сдвигом указателя внутри блоков, освобождается только вся сразу (Reset).
+// Блоки после Reset остаются, так что в установившемся режиме запись кадра не трогает кучу.
+class LinearAllocator
+{
+public:
+    explicit LinearAllocator(size_t blockSize = 64 * 1024);
+
+    LinearAllocator(LinearAllocator&&) = default;
+    LinearAllocator& operator=(LinearAllocator&&) = default;
+
+    void* Allocate(size_t size, size_t alignment);
+
+    void Reset();
+
+    // Выдано с последнего Reset, в байтах
+    size_t Used() const
+    {
+        return used;
+    }
+
+private:
+    struct Block {
+        std::unique_ptr<std::uint8_t[]> Data;
+        size_t Size;
+    };
+
+    std::vector<Block> blocks;
+    size_t blockSize;
+    size_t current = 0;
+    size_t offset = 0;
+    size_t used = 0;
+};
+
+enum class CommandType : std::uint8_t {
+    UseProgram,
+    BindTextures,
+    SetBlend,
+    SetMat4,
+    SetFloat,
+    BindUniformBlock,
+    Draw,
+};
+
+// Команды - простые данные без вызовов GL: материал, имена текстур, участок арены, значения uniform.
+// Лежат в памяти LinearAllocator буфера односвязным списком в порядке записи.
+struct Command {
+    CommandType Type;
+    const Command* Next;
+};
+
+struct UseProgramCommand : Command {
+    MaterialWithMesh* Material;
+};
+
+// 0 - блок не трогать
+struct BindTexturesCommand : Command {
+    std::uint32_t Textures[COMMAND_TEXTURE_UNITS];
+};
+
+// Смешивание по альфе; вместе с ним выключается запись глубины
+struct SetBlendCommand : Command {
+    bool Enabled;
+};
+
+// Uniform текущей программы (последний UseProgram)
+struct SetMat4Command : Command {
+    ShaderParam Param;
+    glm::mat4 Value;
+};
+
+struct SetFloatCommand : Command {
+    ShaderParam Param;
+    float Value;
+};
+
+// Участок буфера на точку привязки блоков uniform, обычно из FrameRing
+struct BindUniformBlockCommand : Command {
+    std::uint32_t Binding;
+    std::uint32_t Buffer;
+    size_t Offset;
+    size_t Size;
+};
+
+struct DrawCommand : Command {
+    GeometryRange Range;
+};
+
+// Буфер команд одного потока. Запись не трогает GL и другие буферы, так что буферы можно
+// заполнять из рабочих потоков параллельно (RecordParallel), а исполнять - CommandExecutor в потоке контекста.
+class CommandBuffer
+{
+public:
+    CommandBuffer() = default;
+    CommandBuffer(const CommandBuffer&) = delete;
+    CommandBuffer& operator=(const CommandBuffer&) = delete;
+    CommandBuffer(CommandBuffer&&) = default;
+    CommandBuffer& operator=(CommandBuffer&&) = default;
+
+    // Забывает команды, память остается за буфером
+    void Reset();
+
+    void UseProgram(MaterialWithMesh* material);
+    void BindTextures(const std::uint32_t (&textures)[COMMAND_TEXTURE_UNITS]);
+    void SetBlend(bool enabled);
+    void SetMat4(ShaderParam param, const glm::mat4& value);
+    void SetFloat(ShaderParam param, float value);
+    void BindUniformBlock(std::uint32_t binding, std::uint32_t buffer, size_t offset, size_t size);
+    void Draw(const GeometryRange& range);
+
+    const Command* First() const
+    {
+        return first;
+    }
+
+    size_t CommandCount() const
+    {
+        return count;
+    }
+
+    size_t Bytes() const
+    {
+        return allocator.Used();
+    }
+
+    // Делит [0, itemCount) на buffers.size() кусков подряд и пишет кусок chunk в buffers[chunk]
+    // через record(chunk, first, last, buffer) на потоках pool. Буферы сбрасываются перед записью.
+    // Порядок буферов фиксирован, так что исполнение по порядку не зависит от числа потоков.
+    static void RecordParallel(ThreadPool& pool, std::vector<CommandBuffer>& buffers, size_t itemCount,
+        const std::function<void(size_t chunk, size_t first, size_t last, CommandBuffer& buffer)>& record);
+
+private:
+    // Копия command в память буфера, в конец списка
+    template <typename T>
+    void Append(const T& command);
+
+    LinearAllocator allocator;
+    Command* first = nullptr;
+    Command* last = nullptr;
+    size_t count = 0;
+};
+
+// Исполняет буферы команд вызовами GL - только в потоке контекста. Помнит привязки между буферами
+// и пропускает повторные glUseProgram/glBindTexture; VAO повторно не привязывает GeometryArena.
+// Смены программы, текстур и VAO считаются в Stats (ProgramSwitches, TextureSwitches, VertexArraySwitches).
+class CommandExecutor
+{
+public:
+    // Начало кадра: привязки, сделанные в обход исполнителя, неизвестны
+    void Begin();
+
+    // setupProgram вызывается после каждой смены программы - для uniform кадра (view, projection, сэмплеры)
+    void Execute(const CommandBuffer& buffer, const std::function<void(MaterialWithMesh&)>& setupProgram = nullptr);
+
+    // Выключает смешивание и включает запись глубины, если буферы их поменяли
+    void End();
+
+private:
+    MaterialWithMesh* material = nullptr;
+    const void* program = nullptr;
+    std::uint32_t textures[COMMAND_TEXTURE_UNITS] = {};
+    bool texturesKnown = false;
+    unsigned pool = GeometryRange::INVALID_POOL;
+    bool blending = false;
+};
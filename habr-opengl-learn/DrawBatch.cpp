@@ -0,0 +1,126 @@
+#include "DrawBatch.h"
+#include "Stats.h"
+#include <algorithm>
+
+static size_t IndexSize(GLenum type)
+{
+    return type == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+}
+
+static bool SameRange(const GeometryRange& a, const GeometryRange& b)
+{
+    return a.Pool == b.Pool && a.BaseVertex == b.BaseVertex && a.IndexOffset == b.IndexOffset
+        && a.IndexCount == b.IndexCount && a.IndexType == b.IndexType;
+}
+
+// Заливает данные целиком, буфер переразмечается - драйвер не ждет кадр, который еще читает старые
+static void UploadBuffer(GLuint buffer, const void* data, size_t bytes)
+{
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, bytes, data, GL_STREAM_DRAW);
+}
+
+DrawBatch::~DrawBatch()
+{
+    glDeleteBuffers(1, &commandBuffer);
+    glDeleteBuffers(1, &instanceBuffer);
+}
+
+bool DrawBatch::IsIndirectSupported()
+{
+    // Без ARB_base_instance поле baseInstance обязано быть нулем
+    return GLEW_VERSION_4_3 || (GLEW_ARB_multi_draw_indirect && GLEW_ARB_base_instance);
+}
+
+void DrawBatch::Clear()
+{
+    ranges.clear();
+    commands.clear();
+    instances.clear();
+    dirty = true;
+}
+
+void DrawBatch::Add(const GeometryRange& range, const InstanceTransform& transform)
+{
+    if (!range.IsValid() || range.IndexCount == 0) {
+        return;
+    }
+    instances.push_back(transform);
+    dirty = true;
+    if (!ranges.empty() && SameRange(ranges.back(), range)) {
+        ++commands.back().InstanceCount;
+        return;
+    }
+
+    DrawElementsIndirectCommand command;
+    command.Count = static_cast<GLuint>(range.IndexCount);
+    command.InstanceCount = 1;
+    command.FirstIndex = static_cast<GLuint>(range.IndexOffset / IndexSize(range.IndexType));
+    command.BaseVertex = range.BaseVertex;
+    command.BaseInstance = static_cast<GLuint>(instances.size() - 1);
+    ranges.push_back(range);
+    commands.push_back(command);
+}
+
+void DrawBatch::Upload()
+{
+    dirty = false;
+    groups.clear();
+    order.resize(commands.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    // baseInstance у команд свой, так что порядок команд можно менять, не трогая экземпляры
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return ranges[a].Pool != ranges[b].Pool ? ranges[a].Pool < ranges[b].Pool : ranges[a].IndexType < ranges[b].IndexType;
+    });
+
+    std::vector<DrawElementsIndirectCommand> sorted;
+    sorted.reserve(commands.size());
+    for (size_t i : order) {
+        const GeometryRange& range = ranges[i];
+        if (groups.empty() || groups.back().Range.Pool != range.Pool || groups.back().Range.IndexType != range.IndexType) {
+            groups.push_back({ range, sorted.size(), 0, 0, 0 });
+        }
+        Group& group = groups.back();
+        ++group.CommandCount;
+        group.Instances += commands[i].InstanceCount;
+        group.Triangles += commands[i].Count / 3 * commands[i].InstanceCount;
+        sorted.push_back(commands[i]);
+    }
+
+    if (instanceBuffer == 0) {
+        glGenBuffers(1, &instanceBuffer);
+    }
+    UploadBuffer(instanceBuffer, instances.data(), instances.size() * sizeof(InstanceTransform));
+    if (IsIndirectSupported()) {
+        if (commandBuffer == 0) {
+            glGenBuffers(1, &commandBuffer);
+        }
+        UploadBuffer(commandBuffer, sorted.data(), sorted.size() * sizeof(DrawElementsIndirectCommand));
+    }
+}
+
+void DrawBatch::Submit()
+{
+    if (commands.empty()) {
+        return;
+    }
+    if (dirty) {
+        Upload();
+    }
+
+    if (!IsIndirectSupported()) {
+        for (size_t i : order) {
+            GeometryArena::DrawInstanced(ranges[i], instanceBuffer, commands[i].InstanceCount, commands[i].BaseInstance);
+        }
+        return;
+    }
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+    for (const Group& group : groups) {
+        GeometryArena::MultiDrawIndirect(group.Range, instanceBuffer, group.FirstCommand * sizeof(DrawElementsIndirectCommand), group.CommandCount);
+        Stats::Frame.Instances += group.Instances;
+        Stats::Frame.Triangles += group.Triangles;
+    }
+}
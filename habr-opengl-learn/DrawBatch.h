@@ -0,0 +1,66 @@
+#pragma once
+#include "Common.h"
+#include "GeometryArena.h"
+#include <cstddef>
+#include <vector>
+
+// Команда glMultiDrawElementsIndirect, раскладка задана спецификацией
+struct DrawElementsIndirectCommand {
+    GLuint Count;
+    GLuint InstanceCount;
+    GLuint FirstIndex;
+    GLint BaseVertex;
+    GLuint BaseInstance;
+};
+
+// Набор отрисовок разных мешей из GeometryArena одним материалом с SHADER_FEATURE_INSTANCED.
+// Отрисовка - участок арены и InstanceTransform ее экземпляров. С glMultiDrawElementsIndirect
+// (GL 4.3 или ARB_multi_draw_indirect + ARB_base_instance) весь набор уходит одним вызовом на пул арены
+// и тип индексов: команды лежат в GL_DRAW_INDIRECT_BUFFER, а baseInstance команды сдвигает чтение
+// атрибутов экземпляра - так шейдер получает данные своей отрисовки. Без них - вызов на отрисовку.
+class DrawBatch
+{
+public:
+    DrawBatch() = default;
+    DrawBatch(const DrawBatch&) = delete;
+    DrawBatch& operator=(const DrawBatch&) = delete;
+    ~DrawBatch();
+
+    static bool IsIndirectSupported();
+
+    void Clear();
+
+    // Один экземпляр участка; подряд идущие экземпляры одного участка сливаются в одну команду
+    void Add(const GeometryRange& range, const InstanceTransform& transform);
+
+    // Заливает команды и экземпляры, если набор менялся, и рисует
+    void Submit();
+
+    size_t CommandCount() const
+    {
+        return commands.size();
+    }
+
+private:
+    // Команды одного пула и типа индексов подряд в буфере команд
+    struct Group {
+        GeometryRange Range;
+        size_t FirstCommand;
+        GLsizei CommandCount;
+        GLsizei Instances;
+        GLsizei Triangles;
+    };
+
+    void Upload();
+
+    std::vector<GeometryRange> ranges;
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<InstanceTransform> instances;
+    std::vector<Group> groups;
+    // Порядок команд в буфере: отсортированы по пулу и типу индексов
+    std::vector<size_t> order;
+
+    GLuint commandBuffer = 0;
+    GLuint instanceBuffer = 0;
+    bool dirty = false;
+};
@@ -0,0 +1,167 @@
+#include "FrameRing.h"
+#include "Stats.h"
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+// Сколько ждать забор за один glClientWaitSync, в наносекундах
+static const GLuint64 FENCE_WAIT_STEP = 1000000;
+
+static size_t AlignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+FrameRing::~FrameRing()
+{
+    for (GLsync& fence : fences) {
+        if (fence != nullptr) {
+            glDeleteSync(fence);
+        }
+    }
+    if (buffer == 0) {
+        return;
+    }
+    if (persistent) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    }
+    glDeleteBuffers(1, &buffer);
+}
+
+bool FrameRing::IsPersistentSupported()
+{
+    return GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+}
+
+void FrameRing::QueryUniformAlignment()
+{
+    GLint alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    if (alignment > 0) {
+        uniformAlignment = static_cast<size_t>(alignment);
+    }
+}
+
+bool FrameRing::CreateForUniformBlocks(size_t blockCount, size_t blockBytes, size_t batches)
+{
+    QueryUniformAlignment();
+    return Create(blockCount * AlignUp(blockBytes, uniformAlignment) + batches * uniformAlignment);
+}
+
+bool FrameRing::Create(size_t bytes)
+{
+    QueryUniformAlignment();
+    // Участки начинаются с выровненного смещения, так что выравнивание внутри участка верно и для всего буфера
+    frameBytes = AlignUp(bytes, uniformAlignment);
+    const size_t totalBytes = frameBytes * FRAMES;
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    persistent = IsPersistentSupported();
+    if (persistent) {
+        const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_COPY_WRITE_BUFFER, totalBytes, nullptr, flags);
+        mapped = static_cast<std::uint8_t*>(glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, totalBytes, flags));
+        if (mapped == nullptr) {
+            std::cout << "ERROR::FRAME_RING::MAP_FAILED" << std::endl;
+            glDeleteBuffers(1, &buffer);
+            buffer = 0;
+            persistent = false;
+            return false;
+        }
+    } else {
+        glBufferData(GL_COPY_WRITE_BUFFER, totalBytes, nullptr, GL_STREAM_DRAW);
+        shadow.resize(frameBytes);
+        mapped = shadow.data();
+    }
+
+    frame = 0;
+    used = 0;
+    flushed = 0;
+    return true;
+}
+
+std::uint8_t* FrameRing::FrameData()
+{
+    return persistent ? mapped + frame * frameBytes : mapped;
+}
+
+void FrameRing::BeginFrame()
+{
+    used = 0;
+    flushed = 0;
+    GLsync& fence = fences[frame];
+    if (fence == nullptr) {
+        return;
+    }
+
+    // Обычно забор уже пройден и первый вызов возвращается сразу. Иначе отправляем команды драйверу,
+    // чтобы забор вообще дошел до GPU, и ждем по шагу.
+    const auto start = std::chrono::steady_clock::now();
+    GLenum result = glClientWaitSync(fence, 0, 0);
+    while (result == GL_TIMEOUT_EXPIRED) {
+        result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_STEP);
+    }
+    if (result == GL_WAIT_FAILED) {
+        std::cout << "ERROR::FRAME_RING::WAIT_FAILED" << std::endl;
+    }
+    Stats::Frame.RingWaitMicroseconds += static_cast<unsigned>(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+    glDeleteSync(fence);
+    fence = nullptr;
+}
+
+void* FrameRing::Allocate(size_t bytes, size_t alignment, size_t& offset)
+{
+    size_t current = used.load(std::memory_order_relaxed);
+    size_t start;
+    do {
+        start = AlignUp(current, alignment);
+        if (start + bytes > frameBytes) {
+            overflows.fetch_add(1, std::memory_order_relaxed);
+            if (!overflowReported.exchange(true)) {
+                std::cout << "ERROR::FRAME_RING::FULL " << bytes << " bytes, " << frameBytes << " per frame" << std::endl;
+            }
+            return nullptr;
+        }
+    } while (!used.compare_exchange_weak(current, start + bytes, std::memory_order_relaxed));
+
+    offset = frame * frameBytes + start;
+    return FrameData() + start;
+}
+
+void FrameRing::Flush()
+{
+    const size_t end = used.load(std::memory_order_relaxed);
+    if (persistent || end == flushed) {
+        return;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, frame * frameBytes + flushed, end - flushed, shadow.data() + flushed);
+    flushed = end;
+}
+
+bool FrameRing::BindUniform(GLuint binding, const void* data, size_t bytes)
+{
+    size_t offset;
+    void* slot = Allocate(bytes, uniformAlignment, offset);
+    if (slot == nullptr) {
+        return false;
+    }
+    memcpy(slot, data, bytes);
+    Flush();
+    glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, offset, bytes);
+    ++Stats::Frame.UniformBlockBinds;
+    return true;
+}
+
+void FrameRing::EndFrame()
+{
+    Flush();
+    Stats::Frame.RingBytes += static_cast<unsigned>(used.load(std::memory_order_relaxed));
+    // Allocate зовут и рабочие потоки, а Stats::Frame не атомарный - переполнения копятся здесь
+    Stats::Frame.RingOverflows += overflows.exchange(0, std::memory_order_relaxed);
+    fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    frame = (frame + 1) % FRAMES;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include "Common.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Кольцевой буфер данных кадра (матрицы моделей и т.п.) на FRAMES кадров, по участку на кадр.
+// С GL 4.4 или ARB_buffer_storage буфер создается glBufferStorage и отображается один раз
+// (GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT): данные пишутся прямо в его память, без glBufferSubData
+// и glMapBufferRange на каждый кадр. Участок кадра защищает забор (glFenceSync) из EndFrame: BeginFrame
+// того же участка через FRAMES кадров ждет, пока GPU его дочитает. Ожидание идет в Stats::Frame.RingWaitMicroseconds -
+// если оно не ноль, CPU обогнал GPU больше чем на FRAMES - 1 кадр.
+// Без буферов с постоянным отображением (контекст 3.3) кадр пишется в копию в памяти и уходит в буфер через Flush.
+class FrameRing
+{
+public:
+    static const unsigned FRAMES = 3;
+
+    FrameRing() = default;
+    FrameRing(const FrameRing&) = delete;
+    FrameRing& operator=(const FrameRing&) = delete;
+    ~FrameRing();
+
+    static bool IsPersistentSupported();
+
+    // Буфер на FRAMES участков по frameBytes байт. Только в потоке контекста.
+    bool Create(size_t frameBytes);
+
+    // Участок кадра под blockCount блоков uniform по blockBytes, каждый с выравниванием GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT.
+    // batches - сколько раз за кадр блоки выделяются пачкой (RenderQueue::Record): начало пачки выравнивается отдельно.
+    bool CreateForUniformBlocks(size_t blockCount, size_t blockBytes, size_t batches = 0);
+
+    // Переходит к участку следующего кадра, дождавшись его забора
+    void BeginFrame();
+
+    // bytes байт в участке кадра со смещением, кратным alignment (степень двойки). GL не трогает,
+    // можно вызывать из нескольких потоков сразу. offset - смещение от начала буфера, для glBindBufferRange.
+    // nullptr, если участок кончился: переполнение попадет в Stats::Frame.RingOverflows в EndFrame.
+    void* Allocate(size_t bytes, size_t alignment, size_t& offset);
+
+    // Без постоянного отображения отправляет в буфер все, что выделено с прошлого Flush, - до отрисовок,
+    // которые это читают. С постоянным ничего не делает: память когерентна.
+    void Flush();
+
+    // Копирует data в кольцо и ставит этот участок на точку binding блоков uniform.
+    // false, если участок кадра кончился - блок остается прежним.
+    bool BindUniform(GLuint binding, const void* data, size_t bytes);
+
+    // Ставит забор на участок кадра
+    void EndFrame();
+
+    GLuint GetBuffer() const
+    {
+        return buffer;
+    }
+
+    bool IsPersistent() const
+    {
+        return persistent;
+    }
+
+    // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, запрошено в Create - рабочим потокам спрашивать драйвер нельзя
+    size_t GetUniformAlignment() const
+    {
+        return uniformAlignment;
+    }
+
+private:
+    // Начало участка текущего кадра в памяти, куда пишет Allocate
+    std::uint8_t* FrameData();
+
+    void QueryUniformAlignment();
+
+    GLuint buffer = 0;
+    bool persistent = false;
+    // Отображение всего буфера или копия одного участка
+    std::uint8_t* mapped = nullptr;
+    std::vector<std::uint8_t> shadow;
+    size_t frameBytes = 0;
+    size_t uniformAlignment = 256;
+    unsigned frame = 0;
+    std::atomic<size_t> used{ 0 };
+    size_t flushed = 0;
+    // Переполнения кадра; об ошибке пишется один раз, дальше только счетчик
+    std::atomic<unsigned> overflows{ 0 };
+    std::atomic<bool> overflowReported{ false };
+    GLsync fences[FRAMES] = {};
+};
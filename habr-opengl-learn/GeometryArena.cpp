@@ -0,0 +1,439 @@
+#include "GeometryArena.h"
+#include "Stats.h"
+#include <algorithm>
+#include <map>
+
+// Начальный размер пула; дальше буферы растут вдвое
+static const size_t INITIAL_VERTEX_CAPACITY = 64 * 1024;
+static const size_t INITIAL_INDEX_CAPACITY = 256 * 1024;
+static const size_t INDEX_ALIGNMENT = 4;
+
+// Free-list: свободные блоки по смещению, соседние сливаются при освобождении
+class RangeAllocator
+{
+public:
+    explicit RangeAllocator(size_t capacity)
+        : capacity(capacity)
+    {
+        freeBlocks[0] = capacity;
+    }
+
+    bool Allocate(size_t size, size_t alignment, size_t& offset)
+    {
+        for (auto it = freeBlocks.begin(); it != freeBlocks.end(); ++it) {
+            const size_t blockStart = it->first;
+            const size_t blockEnd = it->first + it->second;
+            const size_t start = (blockStart + alignment - 1) / alignment * alignment;
+            if (start + size > blockEnd) {
+                continue;
+            }
+
+            freeBlocks.erase(it);
+            if (start > blockStart) {
+                freeBlocks[blockStart] = start - blockStart;
+            }
+            if (start + size < blockEnd) {
+                freeBlocks[start + size] = blockEnd - (start + size);
+            }
+            used += size;
+            offset = start;
+            return true;
+        }
+        return false;
+    }
+
+    void Free(size_t offset, size_t size)
+    {
+        if (size == 0) {
+            return;
+        }
+        used -= size;
+        auto it = freeBlocks.emplace(offset, size).first;
+
+        auto next = std::next(it);
+        if (next != freeBlocks.end() && it->first + it->second == next->first) {
+            it->second += next->second;
+            freeBlocks.erase(next);
+        }
+        if (it != freeBlocks.begin()) {
+            auto previous = std::prev(it);
+            if (previous->first + previous->second == it->first) {
+                previous->second += it->second;
+                freeBlocks.erase(it);
+            }
+        }
+    }
+
+    void Grow(size_t newCapacity)
+    {
+        const size_t oldCapacity = capacity;
+        capacity = newCapacity;
+        // Добавка к концу - обычное освобождение, сольется с последним свободным блоком
+        used += newCapacity - oldCapacity;
+        Free(oldCapacity, newCapacity - oldCapacity);
+    }
+
+    size_t Capacity() const
+    {
+        return capacity;
+    }
+
+    size_t Used() const
+    {
+        return used;
+    }
+
+    size_t FreeBlockCount() const
+    {
+        return freeBlocks.size();
+    }
+
+    size_t LargestFreeBlock() const
+    {
+        size_t largest = 0;
+        for (const auto& block : freeBlocks) {
+            largest = std::max(largest, block.second);
+        }
+        return largest;
+    }
+
+    // 0 - вся свободная память одним блоком, ближе к 1 - раздроблена на мелкие
+    float Fragmentation() const
+    {
+        const size_t free = capacity - used;
+        return free == 0 ? 0.f : 1.f - float(LargestFreeBlock()) / free;
+    }
+
+private:
+    std::map<size_t, size_t> freeBlocks;
+    size_t capacity;
+    size_t used = 0;
+};
+
+struct GeometryPool {
+    VertexLayout Layout;
+    GLuint Vao = 0;
+    GLuint VertexBuffer = 0;
+    GLuint IndexBuffer = 0;
+    // Вершинный аллокатор считает в вершинах: так смещение сразу дает baseVertex
+    RangeAllocator Vertices{ INITIAL_VERTEX_CAPACITY };
+    // Индексный - в байтах, 16- и 32-битные индексы лежат вперемешку
+    RangeAllocator Indices{ INITIAL_INDEX_CAPACITY };
+    unsigned Meshes = 0;
+    unsigned Grows = 0;
+};
+
+static std::vector<GeometryPool> pools;
+static GLuint boundVao = 0;
+
+static bool SameLayout(const VertexLayout& a, const VertexLayout& b)
+{
+    if (a.Stride() != b.Stride() || a.Attributes().size() != b.Attributes().size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.Attributes().size(); ++i) {
+        if (a.Attributes()[i].Location != b.Attributes()[i].Location || a.Attributes()[i].Format != b.Attributes()[i].Format) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static size_t IndexSize(GLenum type)
+{
+    return type == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+}
+
+static void BindVertexArray(GLuint vao)
+{
+    if (boundVao == vao) {
+        ++Stats::Frame.VertexArrayBindsSkipped;
+        return;
+    }
+    glBindVertexArray(vao);
+    boundVao = vao;
+    ++Stats::Frame.VertexArrayBinds;
+}
+
+static GLuint CreateBuffer(size_t bytes)
+{
+    GLuint buffer;
+    glGenBuffers(1, &buffer);
+    // GL_COPY_WRITE_BUFFER не входит в состояние VAO, в отличие от GL_ELEMENT_ARRAY_BUFFER
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, bytes, nullptr, GL_STATIC_DRAW);
+    return buffer;
+}
+
+// Привязывает буферы пула к его VAO
+static void AttachBuffers(GeometryPool& pool)
+{
+    BindVertexArray(pool.Vao);
+    glBindBuffer(GL_ARRAY_BUFFER, pool.VertexBuffer);
+    pool.Layout.Apply();
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool.IndexBuffer);
+}
+
+static unsigned FindPool(const VertexLayout& layout)
+{
+    for (unsigned i = 0; i < pools.size(); ++i) {
+        if (SameLayout(pools[i].Layout, layout)) {
+            return i;
+        }
+    }
+
+    pools.emplace_back();
+    GeometryPool& pool = pools.back();
+    pool.Layout = layout;
+    glGenVertexArrays(1, &pool.Vao);
+    pool.VertexBuffer = CreateBuffer(pool.Vertices.Capacity() * layout.Stride());
+    pool.IndexBuffer = CreateBuffer(pool.Indices.Capacity());
+    AttachBuffers(pool);
+    return static_cast<unsigned>(pools.size() - 1);
+}
+
+// Новый буфер большего размера с копией старого содержимого
+static GLuint GrowBuffer(GLuint buffer, size_t oldBytes, size_t newBytes)
+{
+    const GLuint grown = CreateBuffer(newBytes);
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+    glDeleteBuffers(1, &buffer);
+    return grown;
+}
+
+static size_t AllocateOrGrow(GeometryPool& pool, RangeAllocator& allocator, size_t size, size_t alignment, size_t unitBytes, GLuint& buffer)
+{
+    size_t offset = 0;
+    if (allocator.Allocate(size, alignment, offset)) {
+        return offset;
+    }
+
+    const size_t oldCapacity = allocator.Capacity();
+    const size_t newCapacity = std::max(oldCapacity * 2, oldCapacity + size + alignment);
+    buffer = GrowBuffer(buffer, oldCapacity * unitBytes, newCapacity * unitBytes);
+    allocator.Grow(newCapacity);
+    ++pool.Grows;
+    // VAO держит старые буферы - перепривязываем
+    AttachBuffers(pool);
+
+    allocator.Allocate(size, alignment, offset);
+    return offset;
+}
+
+GeometryRange GeometryArena::Allocate(const VertexLayout& layout, const void* vertices, size_t vertexCount,
+    const std::vector<std::uint32_t>& indices)
+{
+    // Индексы локальные для меша, так что 16 бит хватает и в большом пуле
+    if (vertexCount <= 0x10000) {
+        const std::vector<std::uint16_t> shorts(indices.begin(), indices.end());
+        return Allocate(layout, vertices, vertexCount, shorts.data(), shorts.size(), GL_UNSIGNED_SHORT);
+    }
+    return Allocate(layout, vertices, vertexCount, indices.data(), indices.size(), GL_UNSIGNED_INT);
+}
+
+GeometryRange GeometryArena::Allocate(const VertexLayout& layout, const void* vertices, size_t vertexCount,
+    const void* indices, size_t indexCount, GLenum indexType)
+{
+    GeometryRange range;
+    if (vertexCount == 0 || indexCount == 0 || (indexType == GL_UNSIGNED_SHORT && vertexCount > 0x10000)) {
+        return range;
+    }
+
+    range.Pool = FindPool(layout);
+    GeometryPool& pool = pools[range.Pool];
+
+    const size_t stride = layout.Stride();
+    const size_t vertexOffset = AllocateOrGrow(pool, pool.Vertices, vertexCount, 1, stride, pool.VertexBuffer);
+    if (vertices != nullptr) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, pool.VertexBuffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, vertexOffset * stride, vertexCount * stride, vertices);
+    }
+
+    range.BaseVertex = static_cast<GLint>(vertexOffset);
+    range.VertexCount = static_cast<GLsizei>(vertexCount);
+    range.IndexType = indexType;
+    range.IndexCount = static_cast<GLsizei>(indexCount);
+    const size_t indexBytes = indexCount * IndexSize(indexType);
+    range.IndexOffset = AllocateOrGrow(pool, pool.Indices, indexBytes, INDEX_ALIGNMENT, 1, pool.IndexBuffer);
+    if (indices != nullptr) {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, pool.IndexBuffer);
+        glBufferSubData(GL_COPY_WRITE_BUFFER, range.IndexOffset, indexBytes, indices);
+    }
+    ++pool.Meshes;
+    return range;
+}
+
+void* GeometryArena::MapVertices(const GeometryRange& range)
+{
+    if (!range.IsValid() || range.VertexCount == 0) {
+        return nullptr;
+    }
+    const GeometryPool& pool = pools[range.Pool];
+    const size_t stride = pool.Layout.Stride();
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pool.VertexBuffer);
+    // INVALIDATE_RANGE: старое содержимое участка не нужно, драйвер не ждет GPU и не копирует его
+    return glMapBufferRange(GL_COPY_WRITE_BUFFER, range.BaseVertex * stride, range.VertexCount * stride,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+}
+
+void* GeometryArena::MapIndices(const GeometryRange& range)
+{
+    if (!range.IsValid() || range.IndexCount == 0) {
+        return nullptr;
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, pools[range.Pool].IndexBuffer);
+    return glMapBufferRange(GL_COPY_WRITE_BUFFER, range.IndexOffset, range.IndexCount * IndexSize(range.IndexType),
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+}
+
+bool GeometryArena::Unmap()
+{
+    // Map* оставляет буфер привязанным к GL_COPY_WRITE_BUFFER, а выделение участков его перепривязывает
+    return glUnmapBuffer(GL_COPY_WRITE_BUFFER) == GL_TRUE;
+}
+
+void GeometryArena::Free(GeometryRange& range)
+{
+    if (!range.IsValid() || range.Pool >= pools.size()) {
+        return;
+    }
+
+    GeometryPool& pool = pools[range.Pool];
+    if (range.VertexCount > 0) {
+        pool.Vertices.Free(range.BaseVertex, range.VertexCount);
+        --pool.Meshes;
+    }
+    pool.Indices.Free(range.IndexOffset, range.IndexCount * IndexSize(range.IndexType));
+    range = GeometryRange();
+}
+
+void GeometryArena::Bind(const GeometryRange& range)
+{
+    BindVertexArray(pools[range.Pool].Vao);
+}
+
+void GeometryArena::Unbind()
+{
+    glBindVertexArray(0);
+    boundVao = 0;
+}
+
+void GeometryArena::Draw(const GeometryRange& range)
+{
+    if (!range.IsValid()) {
+        return;
+    }
+    Bind(range);
+    glDrawElementsBaseVertex(GL_TRIANGLES, range.IndexCount, range.IndexType, (GLvoid*)range.IndexOffset, range.BaseVertex);
+    ++Stats::Frame.DrawCalls;
+    Stats::Frame.Triangles += range.IndexCount / 3;
+}
+
+void GeometryArena::DrawExternalIndices(const GeometryRange& range, GLuint indexBuffer, size_t indexOffset, GLsizei indexCount)
+{
+    if (!range.IsValid() || indexCount <= 0) {
+        return;
+    }
+    Bind(range);
+    // GL_ELEMENT_ARRAY_BUFFER - состояние VAO, общего для пула: после вызова возвращаем его EBO
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glDrawElementsBaseVertex(GL_TRIANGLES, indexCount, range.IndexType, (GLvoid*)indexOffset, range.BaseVertex);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, pools[range.Pool].IndexBuffer);
+    ++Stats::Frame.DrawCalls;
+    Stats::Frame.Triangles += indexCount / 3;
+}
+
+// Атрибуты экземпляров в привязанном VAO. Указатели ставятся при каждой отрисовке: имя удаленного
+// буфера могло достаться новому, а VAO держал бы старый. Это два вызова на целый набор экземпляров.
+static void AttachInstances(GLuint instanceBuffer, GLuint firstInstance)
+{
+    glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer);
+    for (GLuint i = 0; i < 2; ++i) {
+        const GLuint location = INSTANCE_ATTRIBUTE_LOCATION + i;
+        const size_t offset = firstInstance * sizeof(InstanceTransform) + i * sizeof(glm::vec4);
+        glVertexAttribPointer(location, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceTransform), (GLvoid*)offset);
+        glEnableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 1);
+    }
+}
+
+// VAO пула общий с отрисовками без экземпляров - после своей отрисовки атрибуты экземпляров выключаются,
+// иначе следующий glDrawElements из этого пула читал бы их из чужого буфера
+static void DetachInstances()
+{
+    for (GLuint i = 0; i < 2; ++i) {
+        const GLuint location = INSTANCE_ATTRIBUTE_LOCATION + i;
+        glDisableVertexAttribArray(location);
+        glVertexAttribDivisor(location, 0);
+    }
+}
+
+void GeometryArena::DrawInstanced(const GeometryRange& range, GLuint instanceBuffer, GLsizei instanceCount, GLuint firstInstance)
+{
+    if (!range.IsValid() || instanceCount <= 0) {
+        return;
+    }
+    Bind(range);
+    AttachInstances(instanceBuffer, firstInstance);
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, range.IndexCount, range.IndexType, (GLvoid*)range.IndexOffset,
+        instanceCount, range.BaseVertex);
+    DetachInstances();
+    ++Stats::Frame.DrawCalls;
+    Stats::Frame.Instances += instanceCount;
+    Stats::Frame.Triangles += range.IndexCount / 3 * instanceCount;
+}
+
+void GeometryArena::MultiDrawIndirect(const GeometryRange& range, GLuint instanceBuffer, size_t commandOffset, GLsizei commandCount)
+{
+    if (!range.IsValid() || commandCount <= 0) {
+        return;
+    }
+    Bind(range);
+    // Экземпляры каждой команды выбирает ее baseInstance
+    AttachInstances(instanceBuffer, 0);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, range.IndexType, (GLvoid*)commandOffset, commandCount, 0);
+    DetachInstances();
+    ++Stats::Frame.DrawCalls;
+    Stats::Frame.IndirectCommands += commandCount;
+}
+
+GeometryRange GeometryArena::SubRange(const GeometryRange& range, size_t firstIndex, size_t indexCount)
+{
+    GeometryRange sub = range;
+    sub.IndexOffset = range.IndexOffset + firstIndex * IndexSize(range.IndexType);
+    sub.IndexCount = static_cast<GLsizei>(indexCount);
+    return sub;
+}
+
+void GeometryArena::Release()
+{
+    Unbind();
+    for (GeometryPool& pool : pools) {
+        glDeleteVertexArrays(1, &pool.Vao);
+        glDeleteBuffers(1, &pool.VertexBuffer);
+        glDeleteBuffers(1, &pool.IndexBuffer);
+    }
+    pools.clear();
+}
+
+void GeometryArena::PrintStats()
+{
+    for (size_t i = 0; i < pools.size(); ++i) {
+        const GeometryPool& pool = pools[i];
+        const size_t stride = pool.Layout.Stride();
+        std::cout << "GeometryArena: pool=" << i
+            << " stride=" << stride
+            << " meshes=" << pool.Meshes
+            << " grows=" << pool.Grows
+            << " vertexBytes=" << pool.Vertices.Used() * stride << "/" << pool.Vertices.Capacity() * stride
+            << " (" << 100.f * pool.Vertices.Used() / pool.Vertices.Capacity() << "%)"
+            << " vertexFreeBlocks=" << pool.Vertices.FreeBlockCount()
+            << " vertexFragmentation=" << pool.Vertices.Fragmentation()
+            << " indexBytes=" << pool.Indices.Used() << "/" << pool.Indices.Capacity()
+            << " (" << 100.f * pool.Indices.Used() / pool.Indices.Capacity() << "%)"
+            << " indexFreeBlocks=" << pool.Indices.FreeBlockCount()
+            << " indexFragmentation=" << pool.Indices.Fragmentation()
+            << std::endl;
+    }
+}
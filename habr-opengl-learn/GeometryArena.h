@@ -0,0 +1,103 @@
+#pragma once
+#include "Common.h"
+#include "VertexLayout.h"
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Участок меша в общих буферах арены. Своих GL-объектов у меша нет.
+struct GeometryRange {
+    static const unsigned INVALID_POOL = ~0u;
+
+    unsigned Pool = INVALID_POOL;
+    // Первая вершина меша в VBO пула - индексы остаются локальными для меша
+    GLint BaseVertex = 0;
+    GLsizei VertexCount = 0;
+    // Смещение индексов в EBO пула, в байтах
+    size_t IndexOffset = 0;
+    GLsizei IndexCount = 0;
+    GLenum IndexType = GL_UNSIGNED_SHORT;
+
+    bool IsValid() const
+    {
+        return Pool != INVALID_POOL;
+    }
+};
+
+// Первый из двух атрибутов экземпляра (vec4 + vec4), см. INSTANCED в shader-common-matrices.glsl
+const GLuint INSTANCE_ATTRIBUTE_LOCATION = 6;
+
+// Положение экземпляра для DrawInstanced: 32 байта вместо mat4 модели
+struct InstanceTransform {
+    glm::vec3 Position;
+    GLfloat Scale;
+    // Кватернион поворота: xyz - ось * sin(угол / 2), w - cos(угол / 2)
+    glm::vec4 Rotation;
+
+    // То же, что glm::translate(position) * glm::rotate(angle, axis) * glm::scale(scale); угол в радианах
+    static InstanceTransform Make(const glm::vec3& position, GLfloat angle, const glm::vec3& axis, GLfloat scale = 1.f)
+    {
+        const glm::vec3 sinAxis = glm::normalize(axis) * std::sin(angle * .5f);
+        return { position, scale, glm::vec4(sinAxis, std::cos(angle * .5f)) };
+    }
+};
+
+// Общая память под геометрию всех мешей.
+// На каждый VertexLayout заводится пул: один VAO, один VBO и один EBO, из которых
+// free-list аллокатор (first-fit со слиянием соседних свободных блоков) выделяет участки.
+// Меши с одинаковым layout рисуются без перепривязки VAO и буферов через glDrawElementsBaseVertex -
+// это же нужно для multi-draw. Когда места не хватает, буферы пула вырастают вдвое.
+//
+// Арена сама следит за привязанным VAO, поэтому чужой glBindVertexArray между ее вызовами
+// нужно закрывать GeometryArena::Unbind().
+namespace GeometryArena {
+    // Заливает уже упакованные вершины (в формате layout) и индексы. Индексы сжимаются
+    // до 16 бит, если вершин в меше не больше 65536. Возвращает невалидный участок, если меш пустой.
+    GeometryRange Allocate(const VertexLayout& layout, const void* vertices, size_t vertexCount,
+        const std::vector<std::uint32_t>& indices);
+
+    // То же для индексов, уже упакованных в indexType (например, прямо из отображенного файла) - без копий.
+    // Шестнадцатибитные индексы допустимы, только если вершин не больше 65536.
+    // vertices или indices равны nullptr - место только выделяется, заполнить его можно через MapVertices/MapIndices.
+    GeometryRange Allocate(const VertexLayout& layout, const void* vertices, size_t vertexCount,
+        const void* indices, size_t indexCount, GLenum indexType);
+
+    // Отображает вершины или индексы участка только на запись (содержимое участка теряется), например
+    // чтобы распаковать в них сжатый меш без промежуточного буфера. Одновременно отображен один участок;
+    // до Unmap участки этого пула не выделяются. nullptr - не удалось.
+    void* MapVertices(const GeometryRange& range);
+    void* MapIndices(const GeometryRange& range);
+    // false - содержимое испорчено (например, сменился видеорежим), его нужно залить заново
+    bool Unmap();
+
+    // Возвращает участок аллокатору; range становится невалидным
+    void Free(GeometryRange& range);
+
+    // Привязывает VAO пула, если привязан другой
+    void Bind(const GeometryRange& range);
+    void Unbind();
+
+    void Draw(const GeometryRange& range);
+
+    // Вершины участка range, indexCount индексов его типа из чужого буфера indexBuffer со смещения indexOffset (байты) -
+    // например, кластеры после отсечения, записанные в FrameRing. EBO пула в VAO подменяется только на этот вызов.
+    void DrawExternalIndices(const GeometryRange& range, GLuint indexBuffer, size_t indexOffset, GLsizei indexCount);
+
+    // instanceCount экземпляров участка одним glDrawElementsInstancedBaseVertex; instanceBuffer -
+    // массив InstanceTransform, чтение начинается с firstInstance.
+    // Атрибуты экземпляров живут в VAO пула, обычные шейдеры их не читают.
+    void DrawInstanced(const GeometryRange& range, GLuint instanceBuffer, GLsizei instanceCount, GLuint firstInstance = 0);
+
+    // glMultiDrawElementsIndirect: commandCount команд из привязанного GL_DRAW_INDIRECT_BUFFER со смещения
+    // commandOffset (байты). Все команды - над пулом и типом индексов участка range, см. DrawBatch.
+    void MultiDrawIndirect(const GeometryRange& range, GLuint instanceBuffer, size_t commandOffset, GLsizei commandCount);
+
+    // Часть индексов участка над теми же вершинами - например, уровень LOD
+    GeometryRange SubRange(const GeometryRange& range, size_t firstIndex, size_t indexCount);
+
+    // Удаляет буферы и VAO всех пулов, до glfwTerminate
+    void Release();
+
+    // Заполненность и фрагментация по пулам
+    void PrintStats();
+}
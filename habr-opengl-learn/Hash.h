@@ -0,0 +1,27 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// FNV-1a 64 бита: простой и быстрый хэш, которого достаточно для ключей кэшей.
+// Строковая версия constexpr, так что хэш литерала можно посчитать при компиляции.
+const std::uint64_t FNV_OFFSET_BASIS = 14695981039346656037ull;
+const std::uint64_t FNV_PRIME = 1099511628211ull;
+
+constexpr std::uint64_t HashString(const char* str, std::uint64_t hash = FNV_OFFSET_BASIS)
+{
+    while (*str != '\0') {
+        hash ^= static_cast<std::uint8_t>(*str++);
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+inline std::uint64_t HashBytes(const void* data, std::size_t size, std::uint64_t hash = FNV_OFFSET_BASIS)
+{
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(data);
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
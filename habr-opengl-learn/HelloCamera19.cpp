@@ -1,9 +1,18 @@
 #include "HelloCamera19.h"
+#include "CommandBuffer.h"
+#include "DrawBatch.h"
+#include "FrameRing.h"
 #include "MaterialWithMesh.h"
+#include "ProceduralGeometry.h"
+#include "RenderQueue.h"
 #include "Camera.h"
+#include "Stats.h"
+#include "ThreadPool.h"
+#include <cmath>
+#include <utility>
+#include <vector>
 
-static GLuint VAO;
-static GLuint EBO;
+// Вертикальный угол обзора в градусах, меняется колесом мыши
 static GLfloat FOV = 45.f;
 static Camera camera;
 
@@ -20,56 +29,49 @@ static glm::vec3 cubesPositions[] = {
     glm::vec3(-1.3f,  1.0f, -1.5f)
 };
 
+// Что рисуем: cubesPositions или, в стресс-режиме, сетка из stressCubes кубов и других фигур
+static std::vector<glm::vec3> cubes;
+
+// Цикл с uniform и отрисовкой на каждый куб, тот же цикл через RenderQueue с сортировкой по состоянию,
+// очереди по кускам кубов на всех ядрах с записью в CommandBuffer, glDrawElementsInstanced на каждую фигуру
+// или glMultiDrawElementsIndirect на все сразу (DrawBatch)
+enum class DrawMode { Loop, Queue, Threaded, Instanced, Indirect, Count };
+static const char* DRAW_MODE_NAMES[] = { "loop", "queue", "threaded", "instanced", "indirect" };
+static DrawMode drawMode = DrawMode::Loop;
+
+// Стресс-режим (--stress-cubes): каждые STRESS_FRAMES кадров печатаются среднее время кадра
+// и число вызовов отрисовки, и режим меняется по кругу
+static const unsigned STRESS_FRAMES = 120;
+static const GLfloat STRESS_SPACING = 2.f;
+static unsigned stressCubes = 0;
+static unsigned measuredFrames = 0;
+static double measuredSeconds = 0.0;
+static double lastFrameTime = 0.0;
+static double loopFrameMs = 0.0;
+
 
 class FirstCubeMeshNMaterial : public MaterialWithMesh {
 protected:
-    const std::vector<GLfloat> vertices = {
-    -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
-     0.5f, -0.5f, -0.5f,  1.0f, 0.0f,
-     0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-     0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
-    -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
-
-    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-     0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-     0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
-     0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
-    -0.5f,  0.5f,  0.5f,  0.0f, 1.0f,
-    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-
-    -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-    -0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-    -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-
-     0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-     0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-     0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-     0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-     0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-     0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-
-    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-     0.5f, -0.5f, -0.5f,  1.0f, 1.0f,
-     0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-     0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-
-    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
-     0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-     0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-     0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-    -0.5f,  0.5f,  0.5f,  0.0f, 0.0f,
-    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f
-    };
+    // Например, SHADER_FEATURE_INSTANCED для DrawInstanced
+    const unsigned features;
+
+    // Куб из ProceduralGeometry: 24 вершины (по 4 на грань) и 36 индексов, считается при компиляции
+    static constexpr auto cube = Procedural::Cube();
+    static constexpr auto vertices = Procedural::Interleave<VertexSemantic::Position, VertexSemantic::TexCoord>(cube);
+
+    // Исходные float и то, что лежит в VBO: half-позиция и 16-битные UV, 20 -> 12 байт на вершину
+    const VertexLayout layout = VertexLayout().Add(0, VertexFormat::Float3).Add(1, VertexFormat::Float2);
+    const VertexLayout packedLayout = VertexLayout().Add(0, VertexFormat::Half3).Add(1, VertexFormat::UNorm16x2);
 
 public:
+    explicit FirstCubeMeshNMaterial(unsigned features = SHADER_FEATURE_NONE)
+        : features(features)
+    {
+    }
+
     virtual void LoadShader() {
-        LoadShaderImpl("shader-1.8-vertexProjections3DCube.glsl", "shader-1.8-fragment3DCube.glsl");
+        // Стадии общие с другими материалами, см. ProgramPipeline
+        LoadPipelineImpl("shader-1.8-vertexProjections3DCube.glsl", "shader-fragmentTextured.glsl", SHADER_FEATURE_TWO_TEXTURES | features);
     }
 
     virtual void FillVerticesBuffers() {
@@ -78,11 +80,15 @@ public:
            GL_DYNAMIC_DRAW: данные будут меняться довольно часто;
            GL_STREAM_DRAW: данные будут меняться при каждой отрисовке.
          */
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), &vertices[0], GL_STATIC_DRAW);
+        // Сначала готовый .mesh (см. --convert-mesh в Tools.h), без него - куб из ProceduralGeometry,
+        // рисуем через glDrawElements
+        if (!FillFromMeshFile("Resources/Models/cube.mesh")) {
+            FillIndexedBuffers(vertices, layout, packedLayout, cube.Indices, "cube");
+        }
     }
 
     virtual void DrawShape() override {
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        DrawIndexed();
     }
 
     virtual void SetupVerticesData() override
@@ -98,62 +104,60 @@ public:
             * Конфигурация атрибутов, выполненная через glVertexAttribPointer.
             * VBO ассоциированные с вершинными атрибутами с помощью glVertexAttribPointer
         */
-        glGenVertexArrays(1, &VAO);
-        // =================================   Bind Vertex array FIRST =================================
-        glBindVertexArray(VAO);
-
-        /*
-         * Создаем просто буфер типа ARRAY (с сырыми данными?) и складываем туда вертексы
-         */
-        GLuint VBO;
-        glGenBuffers(1, &VBO);
-
-        // Then...
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-        // В зависимости от фигуры - вызываем отрисовку
+        // VAO, VBO и EBO общие для всех мешей с этим packedLayout - их заводит и настраивает GeometryArena
         this->FillVerticesBuffers();
+    }
+};
 
-        // Размечаем память в шейдере
-        /**
-            Первый аргумент описывает какой аргумент шейдера мы хотим настроить. Мы хотим специфицировать значение аргумента position, позиция которого была указана следующим образом: layout (location = 0).
-            Следующий аргумент описывает размер аргумента в шейдере. Поскольку мы использовали vec3 то мы указываем 3.
-            Третий аргумент описывает используемый тип данных. Мы указываем GL_FLOAT, поскольку vec в шейдере использует числа с плавающей точкой.
-            Четвертый аргумент указывает необходимость нормализовать входные данные. Если мы укажем GL_TRUE, то все данные будут расположены между 0 (-1 для знаковых значений) и 1. Нам нормализация не требуется, поэтому мы оставляем GL_FALSE;
-            Пятый аргумент называется шагом и описывает расстояние между наборами данных. Мы также можем указать шаг равный 0 и тогда OpenGL высчитает шаг (работает только с плотно упакованными наборами данных). Как выручить существенную пользу от этого аргумента мы рассмотрим позже.
-            Последний параметр имеет тип GLvoid* и поэтому требует такое странное приведение типов. Это смещение начала данных в буфере. У нас буфер не имеет смещения и поэтому мы указываем 0.
-        */
-        /*
-        layout(position=0),
-        vec3 = 3,
-        GLFLOAT - тк вектор с флоатами,
-        GL_FALSE - не нормализовывать,
-        8 * sizeof(GLfloat) - ШАГ (или общее кол-во данных для вершины) - шесть флоатов, тк у нас 3 на позицию + 3 на цвет,
-        (GLvoid*)0 - Смещение - 0, тк мы читаем с нуля три флоат вершины и после этого перепрыгиваем на следующий шаг: (0-12, 24-36, 48-60, ...)
-        */
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)0);
-        // Явно включаем аттрибут
-        glEnableVertexAttribArray(0);
+// Фигура из ProceduralGeometry с шейдером и layout куба - разнородная сцена стресс-режима
+class ShapeMaterial : public FirstCubeMeshNMaterial {
+protected:
+    const ProceduralMesh shape;
+    const char* const name;
 
-        /*
-        * layout(position=1),
-        * vec2 = 2,
-        * ...,
-        * ...,
-        * ...,
-        * (GLvoid*)(6 * sizeof(GLfloat)) - - Указатель на величину отступа
-        */
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
-        // Явно включаем аттрибут
-        glEnableVertexAttribArray(1);
+public:
+    ShapeMaterial(ProceduralMesh shape, const char* name, unsigned features)
+        : FirstCubeMeshNMaterial(features), shape(std::move(shape)), name(name)
+    {
+    }
 
-        glBindVertexArray(0);
+    // Сфера, тор и цилиндр - единственные фигуры сцены, где окупаются уровни LOD и отсечение кластеров:
+    // меш сразу идет через MeshOptimizer, MeshLod и MeshletBuilder
+    virtual void FillVerticesBuffers() override {
+        IndexedMesh mesh = Procedural::Build(shape, layout, { VertexSemantic::Position, VertexSemantic::TexCoord });
+        FillIndexedMesh(mesh, layout, packedLayout, name);
     }
 };
 
 static MaterialWithMesh* materialWithMeshObject;
+// Куб i рисуется фигурой i % shapes.size(); shapes[0] - сам materialWithMeshObject.
+// instancedShapes - те же фигуры с шейдером SHADER_FEATURE_INSTANCED, общим для всех.
+static std::vector<MaterialWithMesh*> shapes;
+static std::vector<MaterialWithMesh*> instancedShapes;
+// Все кубы всеми фигурами - команды glMultiDrawElementsIndirect
+static DrawBatch* batch;
+// Пакеты режима Queue, собираются заново каждый кадр
+static RenderQueue queue;
+// Режим Threaded: по очереди и буферу команд на кусок кубов, кусков - по числу потоков с главным.
+// Буферы исполняются по порядку кусков в потоке контекста.
+static std::vector<RenderQueue> chunkQueues;
+static std::vector<CommandBuffer> chunkCommands;
+static CommandExecutor executor;
+// Матрицы моделей кадра для блока ModelBlock у shapes: пишутся прямо в память буфера, участок на кадр
+static FrameRing* frameRing;
+// Индексы кластеров после отсечения (режим Loop), по месту на каждую отрисовку. Кончилось место -
+// остальные объекты кадра рисуются целым уровнем LOD, без отсечения.
+static FrameRing* indexRing;
+static const size_t INDEX_RING_FRAME_BYTES = 8 * 1024 * 1024;
 static DeltaTime deltaTime;
 
+// Хэши имен uniform считаются при компиляции - в Update нет ни строк, ни запросов к драйверу
+static constexpr ShaderParam OurTexture1Param("ourTexture1");
+static constexpr ShaderParam OurTexture2Param("ourTexture2");
+static constexpr ShaderParam ModelParam("model");
+static constexpr ShaderParam ViewParam("view");
+static constexpr ShaderParam ProjectionParam("projection");
+
 static GLuint texture1;
 static GLuint texture2;
 
@@ -232,8 +236,8 @@ static void TickFor3DCube() {
     glm::mat4 view = glm::mat4(1.f);
     view = glm::translate(view, glm::vec3(0.f, 0.f, -3.f));
 
-    // Матрица проекции: сгенерируется в GLM
-    glm::mat4 projection = glm::perspective(FOV, 800.f / 600.f, .1f, 100.f);
+    // Матрица проекции: сгенерируется в GLM. glm 0.9.9 ждет угол в радианах, FOV - в градусах, как и у SelectLod
+    glm::mat4 projection = glm::perspective(glm::radians(FOV), 800.f / 600.f, .1f, 100.f);
 
 
     // Первый аргумент должен быть позицией переменной.
@@ -244,9 +248,7 @@ static void TickFor3DCube() {
     glUniformMatrix4fv(materialWithMeshObject->GetUniformLocation("view"), 1, GL_FALSE, glm::value_ptr(view));
     glUniformMatrix4fv(materialWithMeshObject->GetUniformLocation("projection"), 1, GL_FALSE, glm::value_ptr(projection));
 
-    glBindVertexArray(VAO);
     materialWithMeshObject->DrawShape();
-    glBindVertexArray(0);
 }
 
 static glm::mat4 GetViewMatrixOnlyForRotation()
@@ -309,7 +311,8 @@ static glm::mat4 GetViewMatrixForFreeLook()
 
     glm::vec3 target = cameraPos + cameraFront;
 
-    
+#ifdef LESSON19_TRACE_CAMERA
+    // Строка на каждый кадр - в стресс-режиме она сама заметно влияет на время кадра
     printf(
         "CameraPos: (%f, %f, %f); CameraFront: (%f, %f, %f); Sum: (x: %f,  y:%f, z: %f); Yaw: %f; Pitch: %f; Front: (%f, %f, %f)\n", 
         cameraPos.x, cameraPos.y, cameraPos.z, 
@@ -318,6 +321,7 @@ static glm::mat4 GetViewMatrixForFreeLook()
         yaw, pitch,
         front.x, front.y, front.z
     ); 
+#endif
 
     return glm::lookAt(
         cameraPos, // camera
@@ -326,14 +330,103 @@ static glm::mat4 GetViewMatrixForFreeLook()
     );
 }
 
-void Lesson19::Begin()
+// Поворот куба i - тот же, что в цикле Update
+static glm::mat4 CubeModel(unsigned i)
+{
+    glm::mat4 model = glm::mat4(1.f);
+    model = glm::translate(model, cubes[i]);
+    GLfloat angle = 20.0f * i;
+    return glm::rotate(model, angle, glm::vec3(1.0f, 0.3f, 0.5f));
+}
+
+// Пакет куба i для RenderQueue. Каждый третий куб - с текстурами в обратном порядке, каждый четвертый
+// (если transparent) - полупрозрачный: очереди есть что сортировать и в обычном режиме
+static RenderPacket CubePacket(unsigned i, bool transparent)
+{
+    RenderPacket packet;
+    packet.Material = shapes[i % shapes.size()];
+    packet.Textures[0] = i % 3 == 1 ? texture2 : texture1;
+    packet.Textures[1] = i % 3 == 1 ? texture1 : texture2;
+    packet.Model = CubeModel(i);
+    packet.Opacity = transparent && i % 4 == 3 ? .5f : 1.f;
+    return packet;
+}
+
+// Куб со стороной side кубов перед камерой
+static void BuildStressCubes(unsigned count)
 {
-    materialWithMeshObject = new FirstCubeMeshNMaterial();
-    materialWithMeshObject->LoadShader();
-    materialWithMeshObject->SetupVerticesData();
+    const unsigned side = static_cast<unsigned>(std::ceil(std::cbrt(double(count))));
+    const GLfloat half = (side - 1) * STRESS_SPACING * .5f;
+    cubes.clear();
+    for (unsigned i = 0; i < count; ++i) {
+        const unsigned x = i % side;
+        const unsigned y = i / side % side;
+        const unsigned z = i / (side * side);
+        cubes.push_back(glm::vec3(x * STRESS_SPACING - half, y * STRESS_SPACING - half, -5.f - z * STRESS_SPACING));
+    }
+}
+
+void Lesson19::Begin(unsigned stressCubeCount)
+{
+    stressCubes = stressCubeCount;
+    if (stressCubes > 0) {
+        BuildStressCubes(stressCubes);
+    }
+    else {
+        cubes.assign(std::begin(cubesPositions), std::end(cubesPositions));
+    }
+
+    materialWithMeshObject = new FirstCubeMeshNMaterial(SHADER_FEATURE_MODEL_BLOCK);
+    shapes.push_back(materialWithMeshObject);
+    instancedShapes.push_back(new FirstCubeMeshNMaterial(SHADER_FEATURE_INSTANCED));
+    if (stressCubes > 0) {
+        // Разные меши с одним layout лежат в одном пуле арены - DrawBatch рисует их одним вызовом
+        const std::pair<ProceduralMesh, const char*> extraShapes[] = {
+            { Procedural::UVSphere<16, 8>(), "sphere" },
+            { Procedural::Torus<16, 8>(), "torus" },
+            { Procedural::Cylinder<12>(), "cylinder" },
+            { Procedural::Icosphere<1>(), "icosphere" },
+        };
+        for (const auto& extra : extraShapes) {
+            shapes.push_back(new ShapeMaterial(extra.first, extra.second, SHADER_FEATURE_MODEL_BLOCK));
+            instancedShapes.push_back(new ShapeMaterial(extra.first, extra.second, SHADER_FEATURE_INSTANCED));
+        }
+    }
+    for (size_t i = 0; i < shapes.size(); ++i) {
+        shapes[i]->LoadShader();
+        shapes[i]->SetupVerticesData();
+        instancedShapes[i]->LoadShader();
+        instancedShapes[i]->SetupVerticesData();
+    }
+
+    // Повороты те же, что в CubeModel
+    std::vector<std::vector<InstanceTransform>> instances(shapes.size());
+    batch = new DrawBatch();
+    for (unsigned i = 0; i < cubes.size(); ++i) {
+        const InstanceTransform transform = InstanceTransform::Make(cubes[i], 20.0f * i, glm::vec3(1.0f, 0.3f, 0.5f));
+        const size_t shape = i % shapes.size();
+        instances[shape].push_back(transform);
+    }
+    for (size_t i = 0; i < shapes.size(); ++i) {
+        instancedShapes[i]->SetInstances(instances[i]);
+        // Экземпляры фигуры подряд: DrawBatch сливает их в одну команду, как одна отрисовка в режиме Instanced
+        const GeometryRange range = instancedShapes[i]->GetDrawRange();
+        for (const InstanceTransform& transform : instances[i]) {
+            batch->Add(range, transform);
+        }
+    }
 
     LoadTwoTextures();
 
+    chunkQueues.resize(ThreadPool::Instance().ThreadCount() + 1);
+    chunkCommands.resize(chunkQueues.size());
+
+    // По матрице на куб; пачками их выделяют очередь Queue и очереди кусков Threaded
+    frameRing = new FrameRing();
+    frameRing->CreateForUniformBlocks(cubes.size(), sizeof(glm::mat4), chunkQueues.size() + 1);
+    indexRing = new FrameRing();
+    indexRing->Create(INDEX_RING_FRAME_BYTES);
+
 	// Для того чтобы понять куда смотрит камера нам нужно вычесть ( cameraTarget - cameraPos )
 	// Мы получим направление из позиции камеры в таргет
 	glm::vec3 cameraPos = glm::vec3(.0f, .0f, 3.f);
@@ -366,26 +459,85 @@ void Lesson19::Begin()
 
 void doMovement();
 
-void Lesson19::Update()
+static void ResetMeasure()
 {
-    deltaTime.UpdateDeltaTime();
+    measuredFrames = 0;
+    measuredSeconds = 0.0;
+    // Первый кадр в новом режиме не считаем - в нем еще хвост старого
+    lastFrameTime = 0.0;
+}
 
-    doMovement();
+// Следующий режим; без glMultiDrawElementsIndirect DrawBatch рисует по вызову на куб, его пропускаем
+static void NextDrawMode()
+{
+    drawMode = static_cast<DrawMode>((static_cast<int>(drawMode) + 1) % static_cast<int>(DrawMode::Count));
+    if (drawMode == DrawMode::Indirect && !DrawBatch::IsIndirectSupported()) {
+        drawMode = DrawMode::Loop;
+    }
+    ResetMeasure();
+}
 
-    materialWithMeshObject->UseShaderProgram();
+// Среднее время кадра в текущем режиме; в стресс-режиме после STRESS_FRAMES кадров режим меняется
+static void MeasureFrame()
+{
+    const double now = glfwGetTime();
+    if (lastFrameTime > 0.0) {
+        measuredSeconds += now - lastFrameTime;
+        ++measuredFrames;
+    }
+    lastFrameTime = now;
+    if (stressCubes == 0 || measuredFrames < STRESS_FRAMES) {
+        return;
+    }
+
+    // Stats::Last - предыдущий кадр, он уже нарисован в этом режиме
+    const double frameMs = measuredSeconds * 1000.0 / measuredFrames;
+    std::cout << "Stress " << cubes.size() << " cubes, " << shapes.size() << " meshes, " << DRAW_MODE_NAMES[static_cast<int>(drawMode)]
+        << ": " << frameMs << " ms/frame, " << Stats::Last.DrawCalls << " draw calls, ring wait "
+        << Stats::Last.RingWaitMicroseconds << " us";
+    if (Stats::Last.RingOverflows > 0) {
+        std::cout << " (" << Stats::Last.RingOverflows << " ring overflows)";
+    }
+    if (drawMode == DrawMode::Indirect) {
+        std::cout << " (" << Stats::Last.IndirectCommands << " commands)";
+    }
+    if (drawMode == DrawMode::Threaded) {
+        std::cout << ", " << chunkCommands.size() << " command buffers, " << Stats::Last.QueuedPackets << " visible";
+    }
+    if (drawMode == DrawMode::Queue) {
+        // Смены состояния после сортировки против порядка кубов
+        const RenderQueue::Switches& sorted = queue.GetSortedSwitches();
+        const RenderQueue::Switches& unsorted = queue.GetUnsortedSwitches();
+        std::cout << ", switches program " << sorted.Programs << "/" << unsorted.Programs
+            << " textures " << sorted.Textures << "/" << unsorted.Textures
+            << " vao " << sorted.VertexArrays << "/" << unsorted.VertexArrays;
+    }
+    if (drawMode != DrawMode::Loop && loopFrameMs > 0.0) {
+        std::cout << ", loop " << loopFrameMs << " ms, " << loopFrameMs / frameMs << "x";
+    }
+    std::cout << std::endl;
+    if (drawMode == DrawMode::Loop) {
+        loopFrameMs = frameMs;
+    }
+    NextDrawMode();
+}
+
+// Кадр текущим режимом. material - первая фигура режима, через нее ставятся общие uniform.
+static void DrawFrame(MaterialWithMesh* material)
+{
+    material->UseShaderProgram();
 
     // Активируем текстурный блок перед привязкой текстуры
     glActiveTexture(GL_TEXTURE0);
     // Привязываем нужную текстуру
     glBindTexture(GL_TEXTURE_2D, texture1);
     // Привязываем текстурный блок 0 к его uniform-переменной
-    // glUniform1i and glUniform1iv are the only two functions that may be used to load uniform variables defined as sampler types.
-    GLint texture1Sampler2Dlocation = materialWithMeshObject->GetUniformLocation("ourTexture1");
-    glUniform1i(texture1Sampler2Dlocation, 0);
+    // Сэмплеры не меняются, так что после первого кадра Set* не доходят до glUniform1i
+    material->SetInt(OurTexture1Param, 0);
 
     glActiveTexture(GL_TEXTURE1);
     glBindTexture(GL_TEXTURE_2D, texture2);
-    glUniform1i(materialWithMeshObject->GetUniformLocation("ourTexture2"), 1);
+    material->SetInt(OurTexture2Param, 1);
 
 
     // MATRICES
@@ -399,32 +551,114 @@ void Lesson19::Update()
     //glm::mat4 view = GetViewMatrixForKeyboardTravelling();
     glm::mat4 view = GetViewMatrixForFreeLook();
 
-    // Матрица проекции: сгенерируется в GLM
-    glm::mat4 projection = glm::perspective(FOV, 800.f / 600.f, .1f, 100.f);
+    // Матрица проекции: сгенерируется в GLM. glm 0.9.9 ждет угол в радианах, FOV - в градусах, как и у SelectLod
+    glm::mat4 projection = glm::perspective(glm::radians(FOV), 800.f / 600.f, .1f, 100.f);
 
     // Первый аргумент должен быть позицией переменной.
     // Второй аргумент сообщает OpenGL сколько матриц мы собираемся отправлять, в нашем случае 1.
     // Третий аргумент говорит требуется ли транспонировать матрицу. OpenGL разработчики часто используют внутренних матричный формат, называемый column-major ordering, который используется в GLM по умолчанию, поэтому нам не требуется транспонировать матрицы, мы можем оставить GL_FALSE.
     // Последний параметр — это, собственно, данные, но GLM не хранит данные точно так как OpenGL хочет их видеть, поэтому мы преобразовываем их с помощью value_ptr.
-    glUniformMatrix4fv(materialWithMeshObject->GetUniformLocation("view"), 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(materialWithMeshObject->GetUniformLocation("projection"), 1, GL_FALSE, glm::value_ptr(projection));
-    GLint modelLocation = materialWithMeshObject->GetUniformLocation("model");
+    material->SetMat4(ViewParam, view);
+    material->SetMat4(ProjectionParam, projection);
+
+    if (drawMode != DrawMode::Loop) {
+        // Повороты и позиции уже в буферах экземпляров, model - общая для всех
+        material->SetMat4(ModelParam, glm::mat4(1.f));
+        if (drawMode == DrawMode::Indirect) {
+            batch->Submit();
+            return;
+        }
+        for (MaterialWithMesh* shape : instancedShapes) {
+            shape->DrawInstanced();
+        }
+        return;
+    }
 
-    glBindVertexArray(VAO);
+    auto setupProgram = [&](MaterialWithMesh& program) {
+        program.SetInt(OurTexture1Param, 0);
+        program.SetInt(OurTexture2Param, 1);
+        program.SetMat4(ViewParam, view);
+        program.SetMat4(ProjectionParam, projection);
+    };
 
-    int i = -1;
-    for (const glm::vec3& position : cubesPositions) {
-        // Calculate the model matrix for each object and pass it to shader before drawing
-        glm::mat4 model = glm::mat4(1.f);
-        model = glm::translate(model, cubesPositions[++i]);
-        GLfloat angle = 20.0f * i;
-        model = glm::rotate(model, angle, glm::vec3(1.0f, 0.3f, 0.5f));
-        glUniformMatrix4fv(modelLocation, 1, GL_FALSE, glm::value_ptr(model));
+    if (drawMode == DrawMode::Queue) {
+        queue.Begin(view);
+        for (unsigned i = 0; i < cubes.size(); ++i) {
+            RenderPacket packet = CubePacket(i, true);
+            packet.Material->SelectLod(cameraPos, packet.Model, FOV, 600.f);
+            packet.Range = packet.Material->GetDrawRange();
+            queue.Add(packet);
+        }
+        queue.Submit(setupProgram, frameRing);
+        return;
+    }
+
+    if (drawMode == DrawMode::Threaded) {
+        // Отсечение, LOD, сортировка и матрицы - на рабочих потоках, GL - только здесь.
+        // Прозрачных нет: им нужен один порядок от дальних к ближним на все куски.
+        const MeshletCulling::Frustum frustum(projection * view);
+        const glm::vec3 eye = cameraPos;
+        CommandBuffer::RecordParallel(ThreadPool::Instance(), chunkCommands, cubes.size(),
+            [&](size_t chunk, size_t first, size_t last, CommandBuffer& commands) {
+                RenderQueue& chunkQueue = chunkQueues[chunk];
+                chunkQueue.Begin(view);
+                for (size_t i = first; i < last; ++i) {
+                    RenderPacket packet = CubePacket(static_cast<unsigned>(i), false);
+                    const MaterialWithMesh& shape = *packet.Material;
+                    if (!frustum.Contains(glm::vec3(packet.Model * glm::vec4(shape.GetBoundsCenter(), 1.f)), shape.GetBoundsRadius())) {
+                        continue;
+                    }
+                    packet.Range = shape.GetDrawRange(shape.ChooseLod(eye, packet.Model, FOV, 600.f));
+                    chunkQueue.Add(packet);
+                }
+                chunkQueue.Record(commands, frameRing);
+            });
+        frameRing->Flush();
+        executor.Begin();
+        for (const CommandBuffer& commands : chunkCommands) {
+            executor.Execute(commands, setupProgram);
+        }
+        executor.End();
+        return;
+    }
 
-        materialWithMeshObject->DrawShape();
+    for (unsigned i = 0; i < cubes.size(); ++i) {
+        MaterialWithMesh* shape = shapes[i % shapes.size()];
+        // Calculate the model matrix for each object and pass it to shader before drawing
+        const glm::mat4 model = CubeModel(i);
+        // Без glUniform: матрица пишется в кольцо кадра, блок ModelBlock смотрит на ее участок
+        if (!frameRing->BindUniform(MODEL_BLOCK_BINDING, &model, sizeof(model))) {
+            // Блок остался от прошлого куба - рисовать с ним нельзя, переполнение считает FrameRing
+            continue;
+        }
+
+        // Дальние кубы рисуются грубым уровнем LOD, FOV здесь - то же, что Camera::Zoom
+        shape->SelectLod(cameraPos, model, FOV, 600.f);
+        // Для мешей из нескольких кластеров - только кластеры в кадре и лицом к камере
+        shape->CullMeshlets(projection * view, model, cameraPos, *indexRing);
+        shape->DrawShape();
     }
+}
 
-    glBindVertexArray(0);
+void Lesson19::Update()
+{
+    deltaTime.UpdateDeltaTime();
+
+    doMovement();
+
+    // Шейдер общий для всех фигур режима, uniform ставятся через первую
+    MaterialWithMesh* material = drawMode == DrawMode::Loop ? materialWithMeshObject : instancedShapes[0];
+    if (!material->IsShaderReady()) {
+        return;
+    }
+    MeasureFrame();
+
+    // BeginFrame ждет, пока GPU дочитает участки колец от кадра FrameRing::FRAMES назад
+    frameRing->BeginFrame();
+    indexRing->BeginFrame();
+    DrawFrame(material);
+    indexRing->EndFrame();
+    frameRing->EndFrame();
 }
 
 
@@ -437,6 +671,11 @@ void Lesson19::KeyCallback(int key, int action)
     } else if (action == GLFW_RELEASE) {
         keys[key] = false;
     }
+    // Цикл с отрисовкой на куб, очередь с сортировкой, очереди на потоках, instancing или multi-draw indirect
+    if (key == GLFW_KEY_I && action == GLFW_PRESS) {
+        NextDrawMode();
+        std::cout << "Lesson19: " << DRAW_MODE_NAMES[static_cast<int>(drawMode)] << std::endl;
+    }
 }
 
 static const GLfloat sensitivity = .05f;
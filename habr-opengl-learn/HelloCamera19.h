@@ -3,7 +3,10 @@
 #include "Common.h"
 
 namespace Lesson19 {
-	void Begin();
+	// stressCubes > 0 - стресс-режим: столько кубов и других фигур на сетке, сравнение цикла,
+	// очереди с сортировкой (RenderQueue), очередей на всех ядрах (CommandBuffer), instancing и multi-draw indirect
+	// по времени кадра и числу отрисовок
+	void Begin(unsigned stressCubes = 0);
 
 	void Update();
 
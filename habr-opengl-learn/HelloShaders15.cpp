@@ -451,6 +451,10 @@ void Lesson15::Begin() {
 }
 
 void Lesson15::Update() {
+	if (!setupVertices->IsShaderReady()) {
+		return;
+	}
+
 	GLfloat timeValue = glfwGetTime();
 	GLfloat greenValue = (sin(timeValue) / 2) + 0.5;
 	// Обновляем цвет в шейдере через uniform переменную
@@ -1,27 +1,19 @@
 #include "Hellomatrices17.h"
 #include "MaterialWithMesh.h"
+#include "ProceduralGeometry.h"
 
 static GLuint VAO;
 static GLuint EBO;
 
 class TriangleWithTexMaterialNoStaticClass : public MaterialWithMesh {
 protected:
-    const std::vector<GLfloat> vertices = {
-        // Позиции          // Цвета             // Текстурные координаты
-     0.5f,  0.5f, 0.0f,   1.0f, 0.0f, 0.0f,   1.0f, 1.0f,   // Верхний правый
-     0.5f, -0.5f, 0.0f,   0.0f, 1.0f, 0.0f,   1.0f, 0.0f,   // Нижний правый
-    -0.5f, -0.5f, 0.0f,   0.0f, 0.0f, 1.0f,   0.0f, 0.0f,   // Нижний левый
-    -0.5f,  0.5f, 0.0f,   1.0f, 1.0f, 0.0f,   0.0f, 1.0f    // Верхний левый
-    };
-
-    const GLuint quadIndicies[6] = {
-         0, 1, 3,   // Первый треугольник
-         1, 2, 3    // Второй треугольник
-    };
+    // Квадрат из ProceduralGeometry, позиции, цвета и текстурные координаты подряд - считается при компиляции
+    static constexpr auto quad = Procedural::Quad();
+    static constexpr auto vertices = Procedural::Interleave<VertexSemantic::Position, VertexSemantic::Color, VertexSemantic::TexCoord>(quad);
 
 public:
     virtual void LoadShader() {
-        LoadShaderImpl("shader-1.7-vertexWithMatrix.glsl", "shader-16-fragmentTexQuadMix.glsl");
+        LoadShaderImpl("shader-1.7-vertexWithMatrix.glsl", "shader-fragmentTextured.glsl", SHADER_FEATURE_TWO_TEXTURES);
     }
 
     virtual void FillVerticesBuffers() {
@@ -35,7 +27,7 @@ public:
         glGenBuffers(1, &EBO);
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(quadIndicies), quadIndicies, GL_STATIC_DRAW);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(quad.Indices), quad.Indices.data(), GL_STATIC_DRAW);
     }
 
     virtual void DrawShape() override {
@@ -198,6 +190,10 @@ void Lesson17::Begin() {
 }
 
 void Lesson17::Update() {
+    if (!materialWithMeshObject->IsShaderReady()) {
+        return;
+    }
+
     materialWithMeshObject->UseShaderProgram();
 
     // glBindTexture(GL_TEXTURE_2D, texture);
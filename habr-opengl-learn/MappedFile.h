@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Файл, отображенный в память только для чтения.
+// Данные читаются прямо со страниц кэша ОС - без буферов потоков и лишних копий.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool Open(const std::string& path);
+    void Close();
+
+    bool IsOpen() const
+    {
+        return opened;
+    }
+
+    const char* Data() const
+    {
+        return data;
+    }
+
+    size_t Size() const
+    {
+        return size;
+    }
+
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+    bool opened = false;
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#endif
+};
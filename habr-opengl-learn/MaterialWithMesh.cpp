@@ -1,14 +1,307 @@
 #include "MaterialWithMesh.h"
+#include "FrameRing.h"
+#include "MeshCodec.h"
+#include "MeshFile.h"
+#include "MeshOptimizer.h"
+#include "ShaderLibrary.h"
+#include "VertexQuantizer.h"
+#include <algorithm>
+#include <cstring>
 
-void MaterialWithMesh::LoadShaderImpl(const GLchar* vertexShaderPath, const GLchar* fragmentShaderPath) {
-	shader = new Shader(vertexShaderPath, fragmentShaderPath);
+void MaterialWithMesh::LoadShaderImpl(const GLchar* vertexShaderPath, const GLchar* fragmentShaderPath, unsigned features) {
+	// Шейдер соберется в фоне вместе с остальными, см. ShaderCompiler.
+	// Материалы с одинаковыми шейдерами делят одну программу.
+	shaderFeatures = features;
+	shader = ShaderLibrary::Get(vertexShaderPath, fragmentShaderPath, features);
+}
+
+void MaterialWithMesh::LoadPipelineImpl(const GLchar* vertexShaderPath, const GLchar* fragmentShaderPath, unsigned features) {
+	if (!ProgramPipeline::IsSupported()) {
+		LoadShaderImpl(vertexShaderPath, fragmentShaderPath, features);
+		return;
+	}
+	shaderFeatures = features;
+	pipeline = ShaderLibrary::GetPipeline(vertexShaderPath, fragmentShaderPath, features);
 }
 
 void MaterialWithMesh::UseShaderProgram() {
+	if (pipeline != nullptr) {
+		pipeline->Use();
+		return;
+	}
 	shader->Use();
 }
 
+bool MaterialWithMesh::IsShaderReady() const {
+	if (pipeline != nullptr) {
+		return pipeline->IsReady();
+	}
+	return shader != nullptr && shader->IsReady();
+}
+
 GLint MaterialWithMesh::GetUniformLocation(const GLchar* parameter) const {
-	return glGetUniformLocation(shader->Program, parameter);
+	return shader != nullptr ? shader->GetUniformLocation(parameter) : -1;
+}
+
+GLint MaterialWithMesh::GetUniformLocation(ShaderParam parameter) const {
+	return shader != nullptr ? shader->GetUniformLocation(parameter) : -1;
+}
+
+void MaterialWithMesh::SetInt(ShaderParam parameter, GLint value) {
+	if (pipeline != nullptr) {
+		pipeline->SetInt(parameter, value);
+		return;
+	}
+	shader->SetInt(parameter, value);
+}
+
+void MaterialWithMesh::SetFloat(ShaderParam parameter, GLfloat value) {
+	if (pipeline != nullptr) {
+		pipeline->SetFloat(parameter, value);
+		return;
+	}
+	shader->SetFloat(parameter, value);
+}
+
+void MaterialWithMesh::SetVec3(ShaderParam parameter, const glm::vec3& value) {
+	if (pipeline != nullptr) {
+		pipeline->SetVec3(parameter, value);
+		return;
+	}
+	shader->SetVec3(parameter, value);
+}
+
+void MaterialWithMesh::SetVec4(ShaderParam parameter, const glm::vec4& value) {
+	if (pipeline != nullptr) {
+		pipeline->SetVec4(parameter, value);
+		return;
+	}
+	shader->SetVec4(parameter, value);
+}
+
+void MaterialWithMesh::SetMat4(ShaderParam parameter, const glm::mat4& value) {
+	if (pipeline != nullptr) {
+		pipeline->SetMat4(parameter, value);
+		return;
+	}
+	shader->SetMat4(parameter, value);
+}
+
+
+MaterialWithMesh::~MaterialWithMesh() {
+	GeometryArena::Free(geometry);
+	// Без экземпляров материал мог жить и без контекста GL (--bench-command-buffers)
+	if (instanceBuffer != 0) {
+		glDeleteBuffers(1, &instanceBuffer);
+	}
+}
+
+void MaterialWithMesh::FillIndexedBuffers(const std::vector<GLfloat>& vertices, const VertexLayout& layout, const VertexLayout& packedLayout, const char* meshName) {
+	IndexedMesh mesh = MeshIndexer::Build(vertices.data(), vertices.size() * sizeof(GLfloat) / layout.Stride(), layout.Stride());
+	MeshIndexer::PrintReport(meshName, mesh);
+	FillIndexedMesh(mesh, layout, packedLayout, meshName);
+}
+
+void MaterialWithMesh::FillIndexedBuffers(const std::vector<GLfloat>& vertices, const VertexLayout& layout, const VertexLayout& packedLayout,
+	const std::vector<std::uint32_t>& indices, const char* meshName) {
+	// Вершины уже без повторов - сварка не нужна, остальные проходы те же
+	IndexedMesh mesh;
+	mesh.VertexStride = layout.Stride();
+	mesh.Vertices.resize(vertices.size() * sizeof(GLfloat));
+	memcpy(mesh.Vertices.data(), vertices.data(), mesh.Vertices.size());
+	mesh.Indices = indices;
+	mesh.SourceVertexCount = mesh.VertexCount();
+	FillIndexedMesh(mesh, layout, packedLayout, meshName);
+}
+
+void MaterialWithMesh::FillIndexedMesh(IndexedMesh& mesh, const VertexLayout& layout, const VertexLayout& packedLayout, const char* meshName) {
+	// Порядок треугольников под кэш вершин и перерисовку; позиция - первые три float
+	MeshOptimizer::PrintReport(meshName, MeshOptimizer::Optimize(mesh));
+	// Уровни строятся по точным float до квантования
+	lods = MeshLod::Build(mesh);
+	MeshLod::PrintReport(meshName, lods);
+	// Один кластер отсекать нечего - его целиком отсекает объект
+	meshlets = MeshletBuilder::Build(mesh);
+	MeshletBuilder::PrintReport(meshName, meshlets);
+	if (meshlets.Meshlets.size() <= 1) {
+		meshlets = MeshletMesh();
+	}
+
+	// Квантуем уже сваренные вершины: их меньше, а сварка идет по точным float
+	QuantizeReport report;
+	const std::vector<std::uint8_t> packed = VertexQuantizer::Convert(mesh.Vertices.data(), mesh.VertexCount(), layout, packedLayout, &report);
+	VertexQuantizer::PrintReport(meshName, report);
+
+	GeometryArena::Free(geometry);
+	geometry = GeometryArena::Allocate(packedLayout, packed.data(), mesh.VertexCount(), lods.Indices);
+	lods.Indices.clear();
+	lods.Indices.shrink_to_fit();
+	lod = 0;
 }
 
+// Сжатый .mesh распаковывается прямо в отображенные участки арены
+static bool DecodeMeshFile(const MeshFile& file, const GeometryRange& range) {
+	const MeshFileHeader& header = file.Header();
+	void* vertices = GeometryArena::MapVertices(range);
+	bool decoded = vertices != nullptr
+		&& MeshCodec::DecodeVertices(vertices, header.VertexCount, file.Layout(), file.Vertices(), header.VerticesSize);
+	if (vertices != nullptr) {
+		decoded = GeometryArena::Unmap() && decoded;
+	}
+	if (!decoded) {
+		return false;
+	}
+
+	void* indices = GeometryArena::MapIndices(range);
+	decoded = indices != nullptr
+		&& MeshCodec::DecodeIndices(indices, header.IndexCount, header.IndexType, header.VertexCount, file.Indices(), header.IndicesSize);
+	if (indices != nullptr) {
+		decoded = GeometryArena::Unmap() && decoded;
+	}
+	return decoded;
+}
+
+bool MaterialWithMesh::FillFromMeshFile(const char* path) {
+	MeshFile file;
+	if (!file.Open(path)) {
+		return false;
+	}
+	const MeshFileHeader& header = file.Header();
+	const bool encoded = file.IsEncoded();
+	GeometryRange range = GeometryArena::Allocate(file.Layout(), encoded ? nullptr : file.Vertices(), header.VertexCount,
+		encoded ? nullptr : file.Indices(), header.IndexCount, header.IndexType);
+	if (!range.IsValid()) {
+		return false;
+	}
+	if (encoded && !DecodeMeshFile(file, range)) {
+		std::cout << "ERROR::MESH_FILE::CORRUPT_DATA " << path << std::endl;
+		GeometryArena::Free(range);
+		return false;
+	}
+
+	GeometryArena::Free(geometry);
+	geometry = range;
+	meshlets = MeshletMesh();
+	lods = MeshLodChain();
+	lods.Levels.push_back({ 0, header.IndexCount, 0.f });
+	// Сфера вокруг коробки всех частей
+	if (header.SubmeshCount > 0) {
+		const MeshFileSubmesh* submeshes = file.Submeshes();
+		glm::vec3 low(submeshes[0].BoundsMin[0], submeshes[0].BoundsMin[1], submeshes[0].BoundsMin[2]);
+		glm::vec3 high(submeshes[0].BoundsMax[0], submeshes[0].BoundsMax[1], submeshes[0].BoundsMax[2]);
+		for (std::uint32_t i = 1; i < header.SubmeshCount; ++i) {
+			low = glm::min(low, glm::vec3(submeshes[i].BoundsMin[0], submeshes[i].BoundsMin[1], submeshes[i].BoundsMin[2]));
+			high = glm::max(high, glm::vec3(submeshes[i].BoundsMax[0], submeshes[i].BoundsMax[1], submeshes[i].BoundsMax[2]));
+		}
+		lods.Center = (low + high) * .5f;
+		lods.Radius = glm::length(high - low) * .5f;
+	}
+	lod = 0;
+	std::cout << "MeshFile " << path << ": " << header.VertexCount << " vertices x " << header.VertexStride << " bytes, "
+		<< header.IndexCount / 3 << " triangles, " << header.SubmeshCount << " submeshes" << std::endl;
+	return true;
+}
+
+void MaterialWithMesh::SetInstances(const std::vector<InstanceTransform>& instances) {
+	if (instanceBuffer == 0) {
+		glGenBuffers(1, &instanceBuffer);
+	}
+	// GL_COPY_WRITE_BUFFER не трогает привязки VAO
+	glBindBuffer(GL_COPY_WRITE_BUFFER, instanceBuffer);
+	const size_t bytes = instances.size() * sizeof(InstanceTransform);
+	if (instances.size() > instanceCapacity) {
+		instanceCapacity = std::max(instances.size(), instanceCapacity * 2);
+		glBufferData(GL_COPY_WRITE_BUFFER, instanceCapacity * sizeof(InstanceTransform), nullptr, GL_DYNAMIC_DRAW);
+	}
+	if (bytes > 0) {
+		glBufferSubData(GL_COPY_WRITE_BUFFER, 0, bytes, instances.data());
+	}
+	instanceCount = static_cast<GLsizei>(instances.size());
+}
+
+void MaterialWithMesh::DrawInstanced() {
+	culledIndexCount = -1;
+	if (lods.Levels.empty() || instanceCount == 0) {
+		return;
+	}
+	const MeshLodLevel& level = lods.Levels[lod];
+	GeometryArena::DrawInstanced(GeometryArena::SubRange(geometry, level.FirstIndex, level.IndexCount), instanceBuffer, instanceCount);
+	Stats::Frame.LodDraws[lod] += instanceCount;
+}
+
+GeometryRange MaterialWithMesh::GetDrawRange() const {
+	return GetDrawRange(lod);
+}
+
+GeometryRange MaterialWithMesh::GetDrawRange(unsigned level) const {
+	if (level >= lods.Levels.size()) {
+		return GeometryRange();
+	}
+	const MeshLodLevel& range = lods.Levels[level];
+	return GeometryArena::SubRange(geometry, range.FirstIndex, range.IndexCount);
+}
+
+unsigned MaterialWithMesh::SelectLod(const glm::vec3& cameraPosition, const glm::mat4& model, float fovDegrees, float viewportHeight) {
+	lod = ChooseLod(cameraPosition, model, fovDegrees, viewportHeight);
+	return lod;
+}
+
+unsigned MaterialWithMesh::ChooseLod(const glm::vec3& cameraPosition, const glm::mat4& model, float fovDegrees, float viewportHeight) const {
+	if (lods.Levels.size() <= 1) {
+		return 0;
+	}
+
+	const glm::vec3 center = glm::vec3(model * glm::vec4(lods.Center, 1.f));
+	const float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+	// Расстояние до ближайшей точки сферы: вблизи и внутри нее - самый детальный уровень
+	const float distance = glm::length(center - cameraPosition) - lods.Radius * scale;
+	return MeshLod::Select(lods, MeshLod::PixelsPerUnit(distance, fovDegrees, viewportHeight), scale);
+}
+
+void MaterialWithMesh::CullMeshlets(const glm::mat4& viewProjection, const glm::mat4& model, const glm::vec3& cameraPosition, FrameRing& ring) {
+	culledIndexCount = -1;
+	if (meshlets.Meshlets.empty() || lod != 0) {
+		return;
+	}
+
+	// Границы кластеров в координатах модели - туда же переводим камеру
+	const glm::vec3 localCamera = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.f));
+	MeshletCullStats stats;
+	culledIndices.clear();
+	MeshletCulling::Cull(meshlets, viewProjection * model, localCamera, culledIndices, &stats);
+	// Индексы меняются каждую отрисовку - у каждой свое место в кольце кадра, в формате индексов арены
+	const size_t indexSize = geometry.IndexType == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+	void* target = ring.Allocate(culledIndices.size() * indexSize, indexSize, culledOffset);
+	if (target == nullptr) {
+		return;
+	}
+	if (geometry.IndexType == GL_UNSIGNED_SHORT) {
+		std::uint16_t* shorts = static_cast<std::uint16_t*>(target);
+		for (size_t i = 0; i < culledIndices.size(); ++i) {
+			shorts[i] = static_cast<std::uint16_t>(culledIndices[i]);
+		}
+	} else {
+		memcpy(target, culledIndices.data(), culledIndices.size() * sizeof(std::uint32_t));
+	}
+	ring.Flush();
+	culledBuffer = ring.GetBuffer();
+	culledIndexCount = static_cast<GLsizei>(culledIndices.size());
+	Stats::Frame.TrianglesCulled += static_cast<unsigned>(stats.Triangles - stats.TrianglesVisible);
+}
+
+void MaterialWithMesh::DrawIndexed() {
+	if (lods.Levels.empty()) {
+		return;
+	}
+	if (culledIndexCount >= 0) {
+		if (culledIndexCount > 0) {
+			GeometryArena::DrawExternalIndices(geometry, culledBuffer, culledOffset, culledIndexCount);
+		}
+		++Stats::Frame.LodDraws[lod];
+		culledIndexCount = -1;
+		return;
+	}
+	const MeshLodLevel& level = lods.Levels[lod];
+	GeometryArena::Draw(GeometryArena::SubRange(geometry, level.FirstIndex, level.IndexCount));
+	++Stats::Frame.LodDraws[lod];
+}
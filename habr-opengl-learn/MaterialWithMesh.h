@@ -1,12 +1,25 @@
 #pragma once
 
 #include "Common.h"
+#include "GeometryArena.h"
+#include "MeshIndexer.h"
+#include "MeshLod.h"
+#include "Meshlets.h"
+#include "ProgramPipeline.h"
 #include "Shader.h"
+#include "ShaderPreprocessor.h"
+#include "VertexLayout.h"
+#include <array>
+#include <cstdint>
 #include <vector>
 
+class FrameRing;
+
 class MaterialWithMesh
 {
 public:
+	virtual ~MaterialWithMesh();
+
 	virtual void DrawShape() = 0;
 
 	virtual const GLchar* getVertexShaderSource() const
@@ -27,11 +40,150 @@ public:
 
 	virtual void UseShaderProgram();
 
+	// Пока шейдер собирается, материал не рисуется
+	bool IsShaderReady() const;
+
+	// Позиции есть только у цельной программы, у конвейера они свои в каждой стадии
 	GLint GetUniformLocation(const GLchar* parameter) const;
 
+	GLint GetUniformLocation(ShaderParam parameter) const;
+
+	// Uniform в программу или в стадии конвейера - смотря что загружено
+	void SetInt(ShaderParam parameter, GLint value);
+	void SetFloat(ShaderParam parameter, GLfloat value);
+	void SetVec3(ShaderParam parameter, const glm::vec3& value);
+	void SetVec4(ShaderParam parameter, const glm::vec4& value);
+	void SetMat4(ShaderParam parameter, const glm::mat4& value);
+
+	// Выбирает уровень LOD для следующих DrawShape по размеру меша на экране.
+	// fovDegrees - вертикальный угол обзора (Camera::Zoom), viewportHeight - высота окна в пикселях.
+	unsigned SelectLod(const glm::vec3& cameraPosition, const glm::mat4& model, float fovDegrees, float viewportHeight);
+
+	// То же без записи в материал - можно звать из рабочих потоков, см. CommandBuffer::RecordParallel
+	unsigned ChooseLod(const glm::vec3& cameraPosition, const glm::mat4& model, float fovDegrees, float viewportHeight) const;
+
+	// Отсекает кластеры меша для следующего DrawShape и пишет индексы видимых в участок кадра ring -
+	// у каждого объекта свой, так что буфер, который GPU еще читает, не переписывается.
+	// Работает на детальном уровне LOD у мешей, где кластеров больше одного; иначе, и если в ring нет места,
+	// ничего не делает - рисуется весь уровень.
+	void CullMeshlets(const glm::mat4& viewProjection, const glm::mat4& model, const glm::vec3& cameraPosition, FrameRing& ring);
+
+	// Экземпляры для DrawInstanced. Буфер переписывается целиком и растет по мере надобности.
+	void SetInstances(const std::vector<InstanceTransform>& instances);
+
+	// Все экземпляры из SetInstances одним вызовом на выбранном уровне LOD, без отсечения кластеров.
+	// Шейдер должен быть собран с SHADER_FEATURE_INSTANCED; uniform model применяется поверх экземпляра.
+	void DrawInstanced();
+
+	// Индексы выбранного уровня LOD в арене - например, для DrawBatch
+	GeometryRange GetDrawRange() const;
+
+	// Индексы уровня lod из ChooseLod
+	GeometryRange GetDrawRange(unsigned lod) const;
+
+	// Ограничивающая сфера меша в координатах модели
+	glm::vec3 GetBoundsCenter() const
+	{
+		return lods.Center;
+	}
+
+	float GetBoundsRadius() const
+	{
+		return lods.Radius;
+	}
+
+	// Чем материал рисуется: конвейер или программа. Совпадает у материалов с общими шейдерами.
+	const void* GetProgramKey() const
+	{
+		return pipeline != nullptr ? static_cast<const void*>(pipeline) : static_cast<const void*>(shader);
+	}
+
+	GLsizei GetInstanceCount() const
+	{
+		return instanceCount;
+	}
+
+	unsigned GetLodCount() const
+	{
+		return static_cast<unsigned>(lods.Levels.size());
+	}
+
+	// nullptr, если материал рисуется конвейером
+	Shader* GetShader() const
+	{
+		return shader;
+	}
+
+	ProgramPipeline* GetPipeline() const
+	{
+		return pipeline;
+	}
+
+	// Маска ShaderFeature, с которой загружен шейдер
+	unsigned GetShaderFeatures() const
+	{
+		return shaderFeatures;
+	}
+
 protected:
 	Shader* shader = nullptr;
+	ProgramPipeline* pipeline = nullptr;
+	unsigned shaderFeatures = SHADER_FEATURE_NONE;
+
+	// Участок меша в GeometryArena со всеми уровнями LOD, заполняется FillIndexedBuffers
+	GeometryRange geometry;
+	// Уровни внутри geometry (индексы после загрузки не хранятся) и выбранный уровень
+	MeshLodChain lods;
+	unsigned lod = 0;
+
+	// Кластеры уровня 0 и индексы, собранные отсечением: буфер FrameRing и смещение в нем.
+	// culledIndexCount < 0 - отсечения перед этой отрисовкой не было.
+	MeshletMesh meshlets;
+	std::vector<std::uint32_t> culledIndices;
+	GLuint culledBuffer = 0;
+	size_t culledOffset = 0;
+	GLsizei culledIndexCount = -1;
+
+	// Буфер InstanceTransform, его вместимость в экземплярах и сколько их залито
+	GLuint instanceBuffer = 0;
+	size_t instanceCapacity = 0;
+	GLsizei instanceCount = 0;
+
+	// Сваривает одинаковые вершины сырого массива (тройки вершин для GL_TRIANGLES), оптимизирует
+	// порядок (MeshOptimizer), строит уровни LOD (MeshLod) и кластеры (MeshletBuilder), упаковывает вершины из layout в packedLayout
+	// (VertexQuantizer) и кладет все в GeometryArena.
+	// VAO и атрибуты - общие для всех мешей с тем же packedLayout, их настраивает арена.
+	void FillIndexedBuffers(const std::vector<GLfloat>& vertices, const VertexLayout& layout, const VertexLayout& packedLayout, const char* meshName);
+
+	// То же для готового индексированного меша (ProceduralGeometry): без сварки, остальные проходы те же
+	void FillIndexedBuffers(const std::vector<GLfloat>& vertices, const VertexLayout& layout, const VertexLayout& packedLayout,
+		const std::vector<std::uint32_t>& indices, const char* meshName);
+
+	// Общая часть обоих FillIndexedBuffers: оптимизация порядка, LOD, кластеры, упаковка и арена
+	void FillIndexedMesh(IndexedMesh& mesh, const VertexLayout& layout, const VertexLayout& packedLayout, const char* meshName);
+
+	// Готовый меш из .mesh (MeshFile): вершины и индексы идут в арену прямо из отображенного файла,
+	// без разбора и промежуточных копий; сжатый файл распаковывается прямо в отображенные буферы.
+	// Один уровень LOD, без кластеров. false - файла нет или он не подходит.
+	bool FillFromMeshFile(const char* path);
+
+	// То же для constexpr-фигур из ProceduralGeometry
+	template <size_t VertexFloats, size_t IndexCount>
+	void FillIndexedBuffers(const std::array<GLfloat, VertexFloats>& vertices, const VertexLayout& layout, const VertexLayout& packedLayout,
+		const std::array<std::uint32_t, IndexCount>& indices, const char* meshName)
+	{
+		FillIndexedBuffers(std::vector<GLfloat>(vertices.begin(), vertices.end()), layout, packedLayout,
+			std::vector<std::uint32_t>(indices.begin(), indices.end()), meshName);
+	}
+
+	// glDrawElementsBaseVertex выбранного уровня LOD из FillIndexedBuffers
+	void DrawIndexed();
+
+	// features - маска ShaderFeature для шейдеров с перестановками
+	void LoadShaderImpl(const GLchar* vertexShaderPath, const GLchar* fragmentShaderPath, unsigned features = SHADER_FEATURE_NONE);
 
-	void LoadShaderImpl(const GLchar* vertexShaderPath, const GLchar* fragmentShaderPath);
+	// То же, но из отдельных стадий, общих для всех материалов. Без GL_ARB_separate_shader_objects
+	// материал получает обычную программу через LoadShaderImpl.
+	void LoadPipelineImpl(const GLchar* vertexShaderPath, const GLchar* fragmentShaderPath, unsigned features = SHADER_FEATURE_NONE);
 };
 
@@ -0,0 +1,679 @@
+#include "MeshCodec.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(_M_IX86) || defined(_M_X64) || defined(__i386__) || defined(__x86_64__)
+#define MESH_CODEC_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define MESH_CODEC_SSE41
+#else
+#include <cpuid.h>
+// GCC/Clang без -msse4.1: интринсики разрешены только в функциях с этим атрибутом
+#define MESH_CODEC_SSE41 __attribute__((target("sse4.1")))
+#endif
+#endif
+
+// Вершины распаковываются блоками: разности блока - во временный буфер на стеке, затем суммирование.
+// 256 вершин делятся на группы и по 8, и по 4 значения при любом числе дорожек.
+static const size_t BLOCK_VERTICES = 256;
+static const size_t MAX_ATTRIBUTE_SIZE = 16;
+// Нули после данных атрибута: SIMD-распаковка группы всегда читает 16 байт
+static const size_t STREAM_PADDING = 16;
+
+// Заголовок атрибута в потоке вершин, за ним управляющие байты, данные и STREAM_PADDING
+struct AttributeStreamHeader {
+    std::uint32_t ControlBytes;
+    std::uint32_t DataBytes;
+};
+
+static size_t LaneBytes(VertexFormat format)
+{
+    switch (format) {
+    case VertexFormat::Half3:
+    case VertexFormat::UNorm16x2:
+        return 2;
+    case VertexFormat::UNorm8x4:
+        return 1;
+    default:
+        return 4;
+    }
+}
+
+// Значений на управляющий байт: бит на 16-битное значение (1 или 2 байта), 2 бита на 32-битное (1-4 байта)
+static size_t GroupValues(size_t laneBytes)
+{
+    return laneBytes == 2 ? 8 : 4;
+}
+
+template <typename T>
+static T ZigZag(T delta)
+{
+    return static_cast<T>((delta << 1) ^ (0 - (delta >> (sizeof(T) * 8 - 1))));
+}
+
+template <typename T>
+static T UnZigZag(T value)
+{
+    return static_cast<T>((value >> 1) ^ (0 - (value & 1)));
+}
+
+template <typename T>
+static void EncodeLanes(const std::uint8_t* vertices, size_t vertexCount, size_t stride, size_t offset, size_t lanes, std::vector<T>& out)
+{
+    T previous[MAX_ATTRIBUTE_SIZE] = {};
+    out.reserve(vertexCount * lanes);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            T value;
+            memcpy(&value, vertices + v * stride + offset + lane * sizeof(T), sizeof(T));
+            out.push_back(ZigZag(static_cast<T>(value - previous[lane])));
+            previous[lane] = value;
+        }
+    }
+}
+
+std::vector<std::uint8_t> MeshCodec::EncodeVertices(const void* vertices, size_t vertexCount, const VertexLayout& layout)
+{
+    const std::uint8_t* source = static_cast<const std::uint8_t*>(vertices);
+    const size_t stride = layout.Stride();
+    std::vector<std::uint8_t> out;
+
+    for (const VertexAttribute& attribute : layout.Attributes()) {
+        const size_t laneBytes = LaneBytes(attribute.Format);
+        const size_t lanes = GetVertexFormatInfo(attribute.Format).Size / laneBytes;
+        std::vector<std::uint8_t> controls;
+        std::vector<std::uint8_t> data;
+
+        if (laneBytes == 1) {
+            EncodeLanes(source, vertexCount, stride, attribute.Offset, lanes, data);
+        }
+        else if (laneBytes == 2) {
+            std::vector<std::uint16_t> values;
+            EncodeLanes(source, vertexCount, stride, attribute.Offset, lanes, values);
+            values.resize((values.size() + 7) / 8 * 8);
+            for (size_t group = 0; group < values.size(); group += 8) {
+                std::uint8_t control = 0;
+                for (size_t k = 0; k < 8; ++k) {
+                    const std::uint16_t value = values[group + k];
+                    data.push_back(static_cast<std::uint8_t>(value));
+                    if (value > 0xFF) {
+                        control |= 1 << k;
+                        data.push_back(static_cast<std::uint8_t>(value >> 8));
+                    }
+                }
+                controls.push_back(control);
+            }
+        }
+        else {
+            std::vector<std::uint32_t> values;
+            EncodeLanes(source, vertexCount, stride, attribute.Offset, lanes, values);
+            values.resize((values.size() + 3) / 4 * 4);
+            for (size_t group = 0; group < values.size(); group += 4) {
+                std::uint8_t control = 0;
+                for (size_t k = 0; k < 4; ++k) {
+                    std::uint32_t value = values[group + k];
+                    const std::uint32_t length = value > 0xFFFFFF ? 4 : value > 0xFFFF ? 3 : value > 0xFF ? 2 : 1;
+                    control |= (length - 1) << (k * 2);
+                    for (std::uint32_t i = 0; i < length; ++i, value >>= 8) {
+                        data.push_back(static_cast<std::uint8_t>(value));
+                    }
+                }
+                controls.push_back(control);
+            }
+        }
+
+        const AttributeStreamHeader header = { static_cast<std::uint32_t>(controls.size()), static_cast<std::uint32_t>(data.size()) };
+        const std::uint8_t* headerBytes = reinterpret_cast<const std::uint8_t*>(&header);
+        out.insert(out.end(), headerBytes, headerBytes + sizeof(header));
+        out.insert(out.end(), controls.begin(), controls.end());
+        out.insert(out.end(), data.begin(), data.end());
+        out.insert(out.end(), STREAM_PADDING, 0);
+    }
+    return out;
+}
+
+// Распаковка разностей одного блока из потока атрибута
+struct LaneReader {
+    const std::uint8_t* Controls;
+    const std::uint8_t* Data;
+    const std::uint8_t* DataEnd;
+};
+
+static bool ReadGroupsScalar(LaneReader& reader, size_t laneBytes, size_t groups, std::uint8_t* out)
+{
+    const std::uint8_t* data = reader.Data;
+    for (size_t group = 0; group < groups; ++group) {
+        const unsigned control = *reader.Controls++;
+        if (laneBytes == 2) {
+            for (unsigned k = 0; k < 8; ++k, out += 2) {
+                out[0] = *data++;
+                out[1] = (control >> k) & 1 ? *data++ : 0;
+            }
+        }
+        else {
+            for (unsigned k = 0; k < 4; ++k, out += 4) {
+                const unsigned length = ((control >> (k * 2)) & 3) + 1;
+                for (unsigned i = 0; i < 4; ++i) {
+                    out[i] = i < length ? *data++ : 0;
+                }
+            }
+        }
+        // Поврежденные длины не уведут чтение дальше нулевого хвоста
+        if (data > reader.DataEnd) {
+            return false;
+        }
+    }
+    reader.Data = data;
+    return true;
+}
+
+template <typename T>
+static void AccumulateScalar(const std::uint8_t* deltas, size_t count, size_t lanes, T* previous, std::uint8_t* destination, size_t stride)
+{
+    for (size_t v = 0; v < count; ++v, destination += stride) {
+        for (size_t lane = 0; lane < lanes; ++lane) {
+            T delta;
+            memcpy(&delta, deltas + (v * lanes + lane) * sizeof(T), sizeof(T));
+            previous[lane] = static_cast<T>(previous[lane] + UnZigZag(delta));
+        }
+        memcpy(destination, previous, lanes * sizeof(T));
+    }
+}
+
+#ifdef MESH_CODEC_X86
+// Маски pshufb для каждого управляющего байта и число байт данных, которые он занимает
+struct ShuffleTables {
+    std::uint8_t Shuffle16[256][16];
+    std::uint8_t Length16[256];
+    std::uint8_t Shuffle32[256][16];
+    std::uint8_t Length32[256];
+};
+
+static ShuffleTables BuildShuffleTables()
+{
+    ShuffleTables tables;
+    for (unsigned control = 0; control < 256; ++control) {
+        unsigned position = 0;
+        for (unsigned k = 0; k < 8; ++k) {
+            tables.Shuffle16[control][k * 2] = static_cast<std::uint8_t>(position++);
+            tables.Shuffle16[control][k * 2 + 1] = (control >> k) & 1 ? static_cast<std::uint8_t>(position++) : 0x80;
+        }
+        tables.Length16[control] = static_cast<std::uint8_t>(position);
+
+        position = 0;
+        for (unsigned k = 0; k < 4; ++k) {
+            const unsigned length = ((control >> (k * 2)) & 3) + 1;
+            for (unsigned i = 0; i < 4; ++i) {
+                tables.Shuffle32[control][k * 4 + i] = i < length ? static_cast<std::uint8_t>(position++) : 0x80;
+            }
+        }
+        tables.Length32[control] = static_cast<std::uint8_t>(position);
+    }
+    return tables;
+}
+
+static const ShuffleTables& GetShuffleTables()
+{
+    static const ShuffleTables tables = BuildShuffleTables();
+    return tables;
+}
+
+MESH_CODEC_SSE41 static bool ReadGroupsSse41(LaneReader& reader, size_t laneBytes, size_t groups, std::uint8_t* out)
+{
+    const ShuffleTables& tables = GetShuffleTables();
+    const std::uint8_t(*shuffle)[16] = laneBytes == 2 ? tables.Shuffle16 : tables.Shuffle32;
+    const std::uint8_t* lengths = laneBytes == 2 ? tables.Length16 : tables.Length32;
+    const std::uint8_t* data = reader.Data;
+    for (size_t group = 0; group < groups; ++group, out += 16) {
+        const unsigned control = *reader.Controls++;
+        const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+        const __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(shuffle[control]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi8(bytes, mask));
+        data += lengths[control];
+        if (data > reader.DataEnd) {
+            return false;
+        }
+    }
+    reader.Data = data;
+    return true;
+}
+
+// Запись первых size байт (4, 8, 12 или 16) регистра
+MESH_CODEC_SSE41 static void StorePartial(std::uint8_t* destination, const __m128i& value, size_t size)
+{
+    if (size == 16) {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination), value);
+        return;
+    }
+    if (size >= 8) {
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(destination), value);
+        if (size == 12) {
+            const int last = _mm_extract_epi32(value, 2);
+            memcpy(destination + 8, &last, sizeof(last));
+        }
+        return;
+    }
+    const int first = _mm_cvtsi128_si32(value);
+    memcpy(destination, &first, sizeof(first));
+}
+
+// Разности лежат подряд по attributeSize байт на вершину; лишние дорожки регистра не записываются.
+// __m128i по ссылке: 32-битный MSVC не выравнивает такие параметры на стеке
+MESH_CODEC_SSE41 static void AccumulateSse41(const std::uint8_t* deltas, size_t count, size_t laneBytes, size_t attributeSize,
+    __m128i& previous, std::uint8_t* destination, size_t stride)
+{
+    const __m128i zero = _mm_setzero_si128();
+    for (size_t v = 0; v < count; ++v, destination += stride) {
+        const __m128i delta = _mm_loadu_si128(reinterpret_cast<const __m128i*>(deltas + v * attributeSize));
+        __m128i value;
+        if (laneBytes == 4) {
+            const __m128i sign = _mm_sub_epi32(zero, _mm_and_si128(delta, _mm_set1_epi32(1)));
+            value = _mm_xor_si128(_mm_srli_epi32(delta, 1), sign);
+            previous = _mm_add_epi32(previous, value);
+        }
+        else if (laneBytes == 2) {
+            const __m128i sign = _mm_sub_epi16(zero, _mm_and_si128(delta, _mm_set1_epi16(1)));
+            value = _mm_xor_si128(_mm_srli_epi16(delta, 1), sign);
+            previous = _mm_add_epi16(previous, value);
+        }
+        else {
+            const __m128i sign = _mm_sub_epi8(zero, _mm_and_si128(delta, _mm_set1_epi8(1)));
+            value = _mm_xor_si128(_mm_and_si128(_mm_srli_epi16(delta, 1), _mm_set1_epi8(0x7F)), sign);
+            previous = _mm_add_epi8(previous, value);
+        }
+        StorePartial(destination, previous, attributeSize);
+    }
+}
+
+bool MeshCodec::HasSimd()
+{
+    static const bool supported = [] {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 1);
+        return (info[2] & (1 << 19)) != 0;
+#else
+        unsigned a, b, c, d;
+        return __get_cpuid(1, &a, &b, &c, &d) && (c & bit_SSE4_1) != 0;
+#endif
+    }();
+    return supported;
+}
+#else
+bool MeshCodec::HasSimd()
+{
+    return false;
+}
+#endif
+
+static bool DecodeAttribute(std::uint8_t* destination, size_t vertexCount, size_t stride, size_t laneBytes, size_t attributeSize,
+    LaneReader& reader, bool simd)
+{
+    const size_t lanes = attributeSize / laneBytes;
+    // Разности блока + хвост, который SIMD читает за последней вершиной
+    alignas(16) std::uint8_t deltas[BLOCK_VERTICES * MAX_ATTRIBUTE_SIZE + 16] = {};
+    std::uint32_t previous32[MAX_ATTRIBUTE_SIZE / 4] = {};
+    std::uint16_t previous16[MAX_ATTRIBUTE_SIZE / 2] = {};
+    std::uint8_t previous8[MAX_ATTRIBUTE_SIZE] = {};
+#ifdef MESH_CODEC_X86
+    __m128i previousSimd = _mm_setzero_si128();
+#endif
+
+    for (size_t first = 0; first < vertexCount; first += BLOCK_VERTICES) {
+        const size_t count = std::min(BLOCK_VERTICES, vertexCount - first);
+        const size_t blockBytes = count * attributeSize;
+        std::uint8_t* target = destination + first * stride;
+
+        const std::uint8_t* source = deltas;
+        if (laneBytes == 1) {
+            // Байтовые дорожки хранятся как есть
+            if (reader.Data + blockBytes > reader.DataEnd) {
+                return false;
+            }
+            source = reader.Data;
+            reader.Data += blockBytes;
+        }
+        else {
+            const size_t groups = (count * lanes + GroupValues(laneBytes) - 1) / GroupValues(laneBytes);
+#ifdef MESH_CODEC_X86
+            const bool read = simd ? ReadGroupsSse41(reader, laneBytes, groups, deltas) : ReadGroupsScalar(reader, laneBytes, groups, deltas);
+#else
+            const bool read = ReadGroupsScalar(reader, laneBytes, groups, deltas);
+#endif
+            if (!read) {
+                return false;
+            }
+        }
+
+#ifdef MESH_CODEC_X86
+        if (simd) {
+            // Байтовые дорожки читаются прямо из потока: за ними всегда есть STREAM_PADDING
+            AccumulateSse41(source, count, laneBytes, attributeSize, previousSimd, target, stride);
+            continue;
+        }
+#endif
+        if (laneBytes == 4) {
+            AccumulateScalar(source, count, lanes, previous32, target, stride);
+        }
+        else if (laneBytes == 2) {
+            AccumulateScalar(source, count, lanes, previous16, target, stride);
+        }
+        else {
+            AccumulateScalar(source, count, lanes, previous8, target, stride);
+        }
+    }
+    return true;
+}
+
+bool MeshCodec::DecodeVertices(void* destination, size_t vertexCount, const VertexLayout& layout, const void* data, size_t size, bool simd)
+{
+    simd = simd && HasSimd();
+    const std::uint8_t* cursor = static_cast<const std::uint8_t*>(data);
+    const std::uint8_t* end = cursor + size;
+    std::uint8_t* target = static_cast<std::uint8_t*>(destination);
+
+    for (const VertexAttribute& attribute : layout.Attributes()) {
+        AttributeStreamHeader header;
+        if (size_t(end - cursor) < sizeof(header)) {
+            return false;
+        }
+        memcpy(&header, cursor, sizeof(header));
+        cursor += sizeof(header);
+
+        const size_t laneBytes = LaneBytes(attribute.Format);
+        const size_t attributeSize = GetVertexFormatInfo(attribute.Format).Size;
+        const size_t values = vertexCount * (attributeSize / laneBytes);
+        const size_t expectedControls = laneBytes == 1 ? 0 : (values + GroupValues(laneBytes) - 1) / GroupValues(laneBytes);
+        if (header.ControlBytes != expectedControls || size_t(end - cursor) < size_t(header.ControlBytes) + header.DataBytes + STREAM_PADDING) {
+            return false;
+        }
+
+        LaneReader reader = { cursor, cursor + header.ControlBytes, cursor + header.ControlBytes + header.DataBytes };
+        if (!DecodeAttribute(target + attribute.Offset, vertexCount, layout.Stride(), laneBytes, attributeSize, reader, simd)
+            || reader.Data != reader.DataEnd) {
+            return false;
+        }
+        cursor = reader.DataEnd + STREAM_PADDING;
+    }
+    return cursor == end;
+}
+
+// Индексы: 4-битные коды, два на байт (сначала младшая тетрада); за байтом - varint явных вершин из него
+static const unsigned CODE_RESTART = 0;
+static const unsigned CODE_NEXT = 1;
+static const unsigned CODE_FIFO = 2;
+static const unsigned FIFO_SIZE = 13;
+static const unsigned CODE_EXPLICIT = CODE_FIFO + FIFO_SIZE;
+
+static void WriteVarint(std::vector<std::uint8_t>& out, std::uint32_t value)
+{
+    while (value >= 0x80) {
+        out.push_back(static_cast<std::uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+static bool ReadVarint(const std::uint8_t*& cursor, const std::uint8_t* end, std::uint32_t& value)
+{
+    value = 0;
+    for (unsigned shift = 0; shift < 35; shift += 7) {
+        if (cursor == end) {
+            return false;
+        }
+        const std::uint8_t byte = *cursor++;
+        value |= std::uint32_t(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Общее состояние кодера и декодера вершин-ссылок
+struct IndexCoderState {
+    std::uint32_t Fifo[FIFO_SIZE] = {};
+    unsigned Head = 0;
+    std::uint32_t Next = 0;
+    std::uint32_t Last = 0;
+
+    // i-я по свежести вершина в FIFO
+    std::uint32_t Recent(unsigned i) const
+    {
+        return Fifo[(Head + FIFO_SIZE - 1 - i) % FIFO_SIZE];
+    }
+
+    void Push(std::uint32_t vertex)
+    {
+        Fifo[Head] = vertex;
+        Head = (Head + 1) % FIFO_SIZE;
+        Next = std::max(Next, vertex + 1);
+        Last = vertex;
+    }
+};
+
+class IndexWriter
+{
+public:
+    explicit IndexWriter(std::vector<std::uint8_t>& out) : out(out)
+    {
+    }
+
+    ~IndexWriter()
+    {
+        Flush();
+    }
+
+    void Restart()
+    {
+        Code(CODE_RESTART);
+        Flush();
+    }
+
+    void Vertex(std::uint32_t vertex)
+    {
+        if (vertex == state.Next) {
+            Code(CODE_NEXT);
+        }
+        else {
+            unsigned hit = FIFO_SIZE;
+            for (unsigned i = 0; i < FIFO_SIZE && hit == FIFO_SIZE; ++i) {
+                if (state.Recent(i) == vertex) {
+                    hit = i;
+                }
+            }
+            if (hit < FIFO_SIZE) {
+                Code(CODE_FIFO + hit);
+            }
+            else {
+                Code(CODE_EXPLICIT);
+                WriteVarint(explicits, ZigZag(vertex - state.Last));
+            }
+        }
+        state.Push(vertex);
+        if (pending == 2) {
+            Flush();
+        }
+    }
+
+private:
+    void Code(unsigned code)
+    {
+        codes |= code << (pending * 4);
+        ++pending;
+    }
+
+    void Flush()
+    {
+        if (pending == 0) {
+            return;
+        }
+        out.push_back(static_cast<std::uint8_t>(codes));
+        out.insert(out.end(), explicits.begin(), explicits.end());
+        explicits.clear();
+        codes = 0;
+        pending = 0;
+    }
+
+    std::vector<std::uint8_t>& out;
+    std::vector<std::uint8_t> explicits;
+    IndexCoderState state;
+    unsigned codes = 0;
+    unsigned pending = 0;
+};
+
+void MeshCodec::EncodeIndices(const std::uint32_t* indices, size_t indexCount, std::vector<std::uint8_t>& out)
+{
+    const size_t triangleCount = indexCount / 3;
+    WriteVarint(out, static_cast<std::uint32_t>(triangleCount));
+
+    // Направленные ребра (from << 32 | to) -> треугольник, отсортированные для поиска соседа
+    std::vector<std::pair<std::uint64_t, std::uint32_t>> edges;
+    edges.reserve(triangleCount * 3);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        for (unsigned corner = 0; corner < 3; ++corner) {
+            const std::uint64_t key = std::uint64_t(indices[t * 3 + corner]) << 32 | indices[t * 3 + (corner + 1) % 3];
+            edges.push_back({ key, static_cast<std::uint32_t>(t) });
+        }
+    }
+    std::sort(edges.begin(), edges.end());
+
+    std::vector<bool> used(triangleCount, false);
+    auto findUnused = [&](std::uint32_t from, std::uint32_t to) -> size_t {
+        const std::uint64_t key = std::uint64_t(from) << 32 | to;
+        auto it = std::lower_bound(edges.begin(), edges.end(), std::make_pair(key, std::uint32_t(0)));
+        for (; it != edges.end() && it->first == key; ++it) {
+            if (!used[it->second]) {
+                return it->second;
+            }
+        }
+        return triangleCount;
+    };
+
+    IndexWriter writer(out);
+    for (size_t start = 0; start < triangleCount; ++start) {
+        if (used[start]) {
+            continue;
+        }
+        used[start] = true;
+        const std::uint32_t* triangle = indices + start * 3;
+        // Поворот, после которого у полосы есть продолжение
+        unsigned rotation = 0;
+        for (unsigned r = 0; r < 3; ++r) {
+            if (findUnused(triangle[(r + 2) % 3], triangle[(r + 1) % 3]) != triangleCount) {
+                rotation = r;
+                break;
+            }
+        }
+        writer.Restart();
+        for (unsigned corner = 0; corner < 3; ++corner) {
+            writer.Vertex(triangle[(rotation + corner) % 3]);
+        }
+
+        // Полоса: треугольник (a, b, c) на нечетном шаге выводится как (b, a, c), чтобы сохранить обход
+        std::uint32_t a = triangle[(rotation + 1) % 3];
+        std::uint32_t b = triangle[(rotation + 2) % 3];
+        bool odd = true;
+        for (;;) {
+            const std::uint32_t from = odd ? b : a;
+            const std::uint32_t to = odd ? a : b;
+            const size_t next = findUnused(from, to);
+            if (next == triangleCount) {
+                break;
+            }
+            used[next] = true;
+            const std::uint32_t* neighbour = indices + next * 3;
+            unsigned corner = 0;
+            while (neighbour[corner] != from || neighbour[(corner + 1) % 3] != to) {
+                ++corner;
+            }
+            const std::uint32_t c = neighbour[(corner + 2) % 3];
+            writer.Vertex(c);
+            a = b;
+            b = c;
+            odd = !odd;
+        }
+    }
+}
+
+template <typename T>
+static bool DecodeIndexStreams(T* destination, size_t indexCount, size_t vertexCount, const std::uint8_t* cursor, const std::uint8_t* end)
+{
+    size_t written = 0;
+    while (written < indexCount) {
+        std::uint32_t triangleCount;
+        if (!ReadVarint(cursor, end, triangleCount) || triangleCount > (indexCount - written) / 3) {
+            return false;
+        }
+        const size_t streamEnd = written + size_t(triangleCount) * 3;
+
+        IndexCoderState state;
+        std::uint32_t strip[3] = {};
+        unsigned stripSize = 0;
+        bool odd = false;
+        while (written < streamEnd) {
+            if (cursor == end) {
+                return false;
+            }
+            const unsigned codes = *cursor++;
+            for (unsigned nibble = 0; nibble < 2 && written < streamEnd; ++nibble) {
+                const unsigned code = (codes >> (nibble * 4)) & 0xF;
+                if (code == CODE_RESTART) {
+                    stripSize = 0;
+                    odd = false;
+                    // Рестарт всегда закрывает байт
+                    break;
+                }
+                std::uint32_t vertex;
+                if (code == CODE_NEXT) {
+                    vertex = state.Next;
+                }
+                else if (code < CODE_EXPLICIT) {
+                    vertex = state.Recent(code - CODE_FIFO);
+                }
+                else {
+                    std::uint32_t delta;
+                    if (!ReadVarint(cursor, end, delta)) {
+                        return false;
+                    }
+                    vertex = state.Last + UnZigZag(delta);
+                }
+                if (vertex >= vertexCount) {
+                    return false;
+                }
+                state.Push(vertex);
+
+                if (stripSize < 3) {
+                    strip[stripSize++] = vertex;
+                    if (stripSize < 3) {
+                        continue;
+                    }
+                    destination[written++] = static_cast<T>(strip[0]);
+                    destination[written++] = static_cast<T>(strip[1]);
+                    destination[written++] = static_cast<T>(strip[2]);
+                }
+                else {
+                    strip[0] = strip[1];
+                    strip[1] = strip[2];
+                    strip[2] = vertex;
+                    destination[written++] = static_cast<T>(strip[odd ? 1 : 0]);
+                    destination[written++] = static_cast<T>(strip[odd ? 0 : 1]);
+                    destination[written++] = static_cast<T>(vertex);
+                }
+                odd = !odd;
+            }
+        }
+    }
+    return true;
+}
+
+bool MeshCodec::DecodeIndices(void* destination, size_t indexCount, GLenum indexType, size_t vertexCount, const void* data, size_t size)
+{
+    const std::uint8_t* cursor = static_cast<const std::uint8_t*>(data);
+    if (indexType == GL_UNSIGNED_SHORT) {
+        return DecodeIndexStreams(static_cast<std::uint16_t*>(destination), indexCount, vertexCount, cursor, cursor + size);
+    }
+    return DecodeIndexStreams(static_cast<std::uint32_t*>(destination), indexCount, vertexCount, cursor, cursor + size);
+}
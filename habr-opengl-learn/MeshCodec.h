@@ -0,0 +1,35 @@
+#pragma once
+#include "Common.h"
+#include "VertexLayout.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Сжатие вершин и индексов для .mesh (MeshFile), чтобы холодный старт меньше упирался в диск.
+//
+// Вершины: каждый атрибут кодируется отдельно. Значения режутся на дорожки по ширине формата
+// (8 бит - UNorm8x4, 16 бит - Half3 и UNorm16x2, 32 бита - float и 10_10_10_2), от каждой дорожки
+// берется разность с той же дорожкой предыдущей вершины и zigzag. Малые разности пишутся
+// байтами переменной длины группами по 8 (16 бит) или по 4 (32 бита) с управляющим байтом на группу -
+// такие группы распаковываются одним pshufb (SSE4.1), суммирование идет сразу по всем дорожкам вершины.
+//
+// Индексы: треугольники каждой части собираются в полосы - соседний треугольник делит с предыдущим
+// ребро и стоит одну вершину. Вершина кодируется 4 битами: следующая новая, попадание в FIFO недавних
+// или явная разность. Распаковка дает обычный список треугольников (порядок внутри части меняется).
+namespace MeshCodec {
+    std::vector<std::uint8_t> EncodeVertices(const void* vertices, size_t vertexCount, const VertexLayout& layout);
+
+    // Дописывает в out самостоятельный поток для indexCount индексов (одна часть меша)
+    void EncodeIndices(const std::uint32_t* indices, size_t indexCount, std::vector<std::uint8_t>& out);
+
+    // Распаковка прямо в destination - например, в отображенный буфер GL (GeometryArena::MapVertices).
+    // simd = false - скалярный путь, для сравнения. false - данные повреждены.
+    bool DecodeVertices(void* destination, size_t vertexCount, const VertexLayout& layout, const void* data, size_t size, bool simd = true);
+
+    // Потоки EncodeIndices подряд, пока не наберется indexCount индексов типа indexType.
+    // Индексы меньше vertexCount - иначе false.
+    bool DecodeIndices(void* destination, size_t indexCount, GLenum indexType, size_t vertexCount, const void* data, size_t size);
+
+    // Есть ли SSE4.1 для DecodeVertices
+    bool HasSimd();
+}
@@ -0,0 +1,208 @@
+#include "MeshFile.h"
+#include "MeshCodec.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+static std::uint64_t Align(std::uint64_t offset)
+{
+    return (offset + MESH_FILE_ALIGNMENT - 1) / MESH_FILE_ALIGNMENT * MESH_FILE_ALIGNMENT;
+}
+
+static size_t IndexSize(std::uint32_t indexType)
+{
+    return indexType == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+}
+
+template <typename Index>
+static bool IndicesInRange(const Index* indices, size_t indexCount, std::uint32_t vertexCount)
+{
+    for (size_t i = 0; i < indexCount; ++i) {
+        if (indices[i] >= vertexCount) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Содержимое несжатого файла и части: индекс за вершинами или часть за индексами - чтение GPU за пределами
+// участка арены, то есть мусор из соседних мешей. Сжатые индексы проверяет MeshCodec::DecodeIndices.
+static bool ValidContents(const MeshFileHeader& header, const char* data)
+{
+    const MeshFileSubmesh* submeshes = reinterpret_cast<const MeshFileSubmesh*>(data + header.SubmeshesOffset);
+    for (std::uint32_t i = 0; i < header.SubmeshCount; ++i) {
+        if (std::uint64_t(submeshes[i].FirstIndex) + submeshes[i].IndexCount > header.IndexCount) {
+            return false;
+        }
+    }
+    if (header.Encoding == MESH_FILE_ENCODING_CODEC) {
+        return true;
+    }
+    const char* indices = data + header.IndicesOffset;
+    if (header.IndexType == GL_UNSIGNED_SHORT) {
+        return IndicesInRange(reinterpret_cast<const std::uint16_t*>(indices), header.IndexCount, header.VertexCount);
+    }
+    return IndicesInRange(reinterpret_cast<const std::uint32_t*>(indices), header.IndexCount, header.VertexCount);
+}
+
+bool MeshFile::Open(const std::string& path)
+{
+    Close();
+    if (!file.Open(path)) {
+        return false;
+    }
+
+    const MeshFileHeader* candidate = reinterpret_cast<const MeshFileHeader*>(file.Data());
+    const std::uint64_t size = file.Size();
+    bool valid = size >= sizeof(MeshFileHeader)
+        && candidate->Magic == MAGIC
+        && candidate->Version == VERSION
+        && (candidate->IndexType == GL_UNSIGNED_SHORT || candidate->IndexType == GL_UNSIGNED_INT)
+        && (candidate->Encoding == MESH_FILE_ENCODING_NONE || candidate->Encoding == MESH_FILE_ENCODING_CODEC);
+    valid = valid
+        && (candidate->Encoding == MESH_FILE_ENCODING_CODEC
+            || (candidate->VerticesSize == std::uint64_t(candidate->VertexCount) * candidate->VertexStride
+                && candidate->IndicesSize == std::uint64_t(candidate->IndexCount) * IndexSize(candidate->IndexType)))
+        && candidate->AttributesOffset + std::uint64_t(candidate->AttributeCount) * sizeof(MeshFileAttribute) <= size
+        && candidate->SubmeshesOffset + std::uint64_t(candidate->SubmeshCount) * sizeof(MeshFileSubmesh) <= size
+        && candidate->VerticesOffset + candidate->VerticesSize <= size
+        && candidate->IndicesOffset + candidate->IndicesSize <= size;
+    valid = valid && ValidContents(*candidate, file.Data());
+    if (!valid) {
+        std::cout << "ERROR::MESH_FILE::INVALID " << path << std::endl;
+        file.Close();
+        return false;
+    }
+
+    // Layout собирается заново и должен дать те же смещения и шаг, что записаны в файле
+    const MeshFileAttribute* attributes = reinterpret_cast<const MeshFileAttribute*>(file.Data() + candidate->AttributesOffset);
+    layout = VertexLayout();
+    for (std::uint32_t i = 0; i < candidate->AttributeCount; ++i) {
+        if (attributes[i].Format > static_cast<std::uint32_t>(VertexFormat::SNorm10x3) || attributes[i].Offset != layout.Stride()) {
+            valid = false;
+            break;
+        }
+        layout.Add(attributes[i].Location, static_cast<VertexFormat>(attributes[i].Format));
+    }
+    if (!valid || layout.Stride() != candidate->VertexStride) {
+        std::cout << "ERROR::MESH_FILE::INVALID_LAYOUT " << path << std::endl;
+        file.Close();
+        return false;
+    }
+
+    header = candidate;
+    return true;
+}
+
+void MeshFile::Close()
+{
+    header = nullptr;
+    layout = VertexLayout();
+    file.Close();
+}
+
+const MeshFileSubmesh* MeshFile::Submeshes() const
+{
+    return reinterpret_cast<const MeshFileSubmesh*>(file.Data() + header->SubmeshesOffset);
+}
+
+const void* MeshFile::Vertices() const
+{
+    return file.Data() + header->VerticesOffset;
+}
+
+const void* MeshFile::Indices() const
+{
+    return file.Data() + header->IndicesOffset;
+}
+
+// Сжатые индексы: отдельный поток на каждый отрезок между границами частей - полосы переставляют
+// треугольники только внутри отрезка, и диапазоны частей остаются верными
+static std::vector<std::uint8_t> EncodeIndices(const std::vector<std::uint32_t>& indices, const std::vector<MeshFileSubmesh>& submeshes)
+{
+    std::vector<std::uint32_t> bounds = { 0, static_cast<std::uint32_t>(indices.size()) };
+    for (const MeshFileSubmesh& submesh : submeshes) {
+        bounds.push_back(submesh.FirstIndex);
+        bounds.push_back(submesh.FirstIndex + submesh.IndexCount);
+    }
+    std::sort(bounds.begin(), bounds.end());
+    bounds.erase(std::unique(bounds.begin(), bounds.end()), bounds.end());
+
+    std::vector<std::uint8_t> encoded;
+    for (size_t i = 1; i < bounds.size(); ++i) {
+        MeshCodec::EncodeIndices(indices.data() + bounds[i - 1], bounds[i] - bounds[i - 1], encoded);
+    }
+    return encoded;
+}
+
+bool MeshFile::Write(const std::string& path, const VertexLayout& layout, const void* vertices, size_t vertexCount,
+    const std::vector<std::uint32_t>& indices, const std::vector<MeshFileSubmesh>& submeshes, bool compress)
+{
+    MeshFileHeader header = {};
+    header.Magic = MAGIC;
+    header.Version = VERSION;
+    header.AttributeCount = static_cast<std::uint32_t>(layout.Attributes().size());
+    header.VertexStride = static_cast<std::uint32_t>(layout.Stride());
+    header.VertexCount = static_cast<std::uint32_t>(vertexCount);
+    header.IndexCount = static_cast<std::uint32_t>(indices.size());
+    header.IndexType = vertexCount <= 0x10000 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    header.SubmeshCount = static_cast<std::uint32_t>(submeshes.size());
+    header.AttributesOffset = Align(sizeof(MeshFileHeader));
+    header.SubmeshesOffset = Align(header.AttributesOffset + header.AttributeCount * sizeof(MeshFileAttribute));
+    header.VerticesOffset = Align(header.SubmeshesOffset + header.SubmeshCount * sizeof(MeshFileSubmesh));
+
+    std::vector<std::uint8_t> encodedVertices;
+    std::vector<std::uint8_t> encodedIndices;
+    if (compress) {
+        header.Encoding = MESH_FILE_ENCODING_CODEC;
+        encodedVertices = MeshCodec::EncodeVertices(vertices, vertexCount, layout);
+        encodedIndices = EncodeIndices(indices, submeshes);
+        header.VerticesSize = encodedVertices.size();
+        header.IndicesSize = encodedIndices.size();
+    }
+    else {
+        header.VerticesSize = std::uint64_t(vertexCount) * layout.Stride();
+        header.IndicesSize = std::uint64_t(indices.size()) * IndexSize(header.IndexType);
+    }
+    header.IndicesOffset = Align(header.VerticesOffset + header.VerticesSize);
+
+    std::vector<MeshFileAttribute> attributes;
+    for (const VertexAttribute& attribute : layout.Attributes()) {
+        attributes.push_back({ attribute.Location, static_cast<std::uint32_t>(attribute.Format), static_cast<std::uint32_t>(attribute.Offset), 0 });
+    }
+
+    std::vector<char> packedIndices(compress ? 0 : indices.size() * IndexSize(header.IndexType));
+    if (compress) {
+        packedIndices.assign(encodedIndices.begin(), encodedIndices.end());
+    }
+    else if (header.IndexType == GL_UNSIGNED_SHORT) {
+        for (size_t i = 0; i < indices.size(); ++i) {
+            const std::uint16_t index = static_cast<std::uint16_t>(indices[i]);
+            memcpy(&packedIndices[i * sizeof(index)], &index, sizeof(index));
+        }
+    }
+    else if (!indices.empty()) {
+        memcpy(packedIndices.data(), indices.data(), packedIndices.size());
+    }
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cout << "ERROR::MESH_FILE::CANNOT_WRITE " << path << std::endl;
+        return false;
+    }
+
+    // Пишет блок с нулевым выравниванием перед ним
+    std::uint64_t written = 0;
+    auto writeAt = [&out, &written](std::uint64_t offset, const void* data, size_t size) {
+        static const char zeros[MESH_FILE_ALIGNMENT] = {};
+        out.write(zeros, offset - written);
+        out.write(static_cast<const char*>(data), size);
+        written = offset + size;
+    };
+    writeAt(0, &header, sizeof(header));
+    writeAt(header.AttributesOffset, attributes.data(), attributes.size() * sizeof(MeshFileAttribute));
+    writeAt(header.SubmeshesOffset, submeshes.data(), submeshes.size() * sizeof(MeshFileSubmesh));
+    writeAt(header.VerticesOffset, compress ? encodedVertices.data() : vertices, header.VerticesSize);
+    writeAt(header.IndicesOffset, packedIndices.data(), packedIndices.size());
+    return out.good();
+}
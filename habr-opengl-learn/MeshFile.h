@@ -0,0 +1,111 @@
+#pragma once
+#include "Common.h"
+#include "MappedFile.h"
+#include "VertexLayout.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Двоичный формат меша (.mesh), готовый к заливке в буферы без разбора.
+//
+// Формат (little-endian), каждый блок выровнен по MESH_FILE_ALIGNMENT от начала файла:
+//   MeshFileHeader
+//   MeshFileAttribute[attributeCount] - layout вершины, форматы из VertexFormat
+//   MeshFileSubmesh[submeshCount]     - диапазоны индексов и границы частей
+//   вершины: vertexCount * vertexStride байт, уже в упакованных форматах
+//   индексы: indexCount * (2 или 4) байт, тип - indexType (GL_UNSIGNED_SHORT / GL_UNSIGNED_INT)
+// Вершины и индексы отдаются в glBufferSubData прямо со страниц отображенного файла.
+// При encoding = MESH_FILE_ENCODING_CODEC вершины и индексы сжаты MeshCodec (индексы - потоком на часть)
+// и распаковываются прямо в отображенные буферы GL.
+
+const std::uint32_t MESH_FILE_ALIGNMENT = 16;
+
+const std::uint32_t MESH_FILE_ENCODING_NONE = 0;
+const std::uint32_t MESH_FILE_ENCODING_CODEC = 1;
+
+struct MeshFileHeader {
+    std::uint32_t Magic;
+    std::uint32_t Version;
+    std::uint32_t AttributeCount;
+    std::uint32_t VertexStride;
+    std::uint32_t VertexCount;
+    std::uint32_t IndexCount;
+    std::uint32_t IndexType;
+    std::uint32_t SubmeshCount;
+    std::uint64_t AttributesOffset;
+    std::uint64_t SubmeshesOffset;
+    std::uint64_t VerticesOffset;
+    std::uint64_t IndicesOffset;
+    std::uint32_t Encoding;
+    std::uint32_t Reserved;
+    // Размеры блоков в файле: без сжатия совпадают с vertexCount * vertexStride и indexCount * размер индекса
+    std::uint64_t VerticesSize;
+    std::uint64_t IndicesSize;
+};
+
+struct MeshFileAttribute {
+    std::uint32_t Location;
+    // static_cast<std::uint32_t>(VertexFormat)
+    std::uint32_t Format;
+    std::uint32_t Offset;
+    std::uint32_t Reserved;
+};
+
+struct MeshFileSubmesh {
+    std::uint32_t FirstIndex;
+    std::uint32_t IndexCount;
+    // Ограничивающая сфера и коробка в координатах модели
+    float Center[3];
+    float Radius;
+    float BoundsMin[3];
+    float BoundsMax[3];
+    char Name[32];
+};
+
+// Открытый .mesh. Все указатели - прямо в отображенный файл и живут, пока он открыт.
+class MeshFile
+{
+public:
+    static const std::uint32_t MAGIC = 0x48534D47; // 'GMSH'
+    static const std::uint32_t VERSION = 2;
+
+    // Проверяет заголовок и что все блоки помещаются в файл; ошибки - в std::cout
+    bool Open(const std::string& path);
+    void Close();
+
+    bool IsOpen() const
+    {
+        return header != nullptr;
+    }
+
+    const MeshFileHeader& Header() const
+    {
+        return *header;
+    }
+
+    const VertexLayout& Layout() const
+    {
+        return layout;
+    }
+
+    const MeshFileSubmesh* Submeshes() const;
+
+    bool IsEncoded() const
+    {
+        return header->Encoding == MESH_FILE_ENCODING_CODEC;
+    }
+
+    // При IsEncoded - сжатые блоки размером VerticesSize и IndicesSize для MeshCodec::Decode*
+    const void* Vertices() const;
+    const void* Indices() const;
+
+    // Офлайн-запись: вершины уже в формате layout, индексы упаковываются в 16 бит, если вершин не больше 65536.
+    // compress - сжать MeshCodec
+    static bool Write(const std::string& path, const VertexLayout& layout, const void* vertices, size_t vertexCount,
+        const std::vector<std::uint32_t>& indices, const std::vector<MeshFileSubmesh>& submeshes, bool compress = false);
+
+private:
+    MappedFile file;
+    const MeshFileHeader* header = nullptr;
+    VertexLayout layout;
+};
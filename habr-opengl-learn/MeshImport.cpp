@@ -0,0 +1,1011 @@
+#include "MeshImport.h"
+#include "MappedFile.h"
+#include "MeshFile.h"
+#include "MeshIndexer.h"
+#include "MeshOptimizer.h"
+#include "ThreadPool.h"
+#include "VertexQuantizer.h"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+static bool ReadFile(const std::string& path, std::string& data)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cout << "ERROR::MESH_IMPORT::CANNOT_READ " << path << std::endl;
+        return false;
+    }
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+static std::string Directory(const std::string& path)
+{
+    const size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+static std::string Extension(const std::string& path)
+{
+    const size_t dot = path.find_last_of('.');
+    std::string extension = dot == std::string::npos ? std::string() : path.substr(dot);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(std::tolower(c)); });
+    return extension;
+}
+
+// Нормали по граням для вершин, у которых их нет (нулевая нормаль)
+static void GenerateMissingNormals(ImportedMesh& mesh)
+{
+    const size_t stride = ImportedMesh::FLOATS_PER_VERTEX;
+    std::vector<bool> missing(mesh.VertexCount());
+    for (size_t v = 0; v < missing.size(); ++v) {
+        const GLfloat* n = &mesh.Vertices[v * stride + ImportedMesh::NORMAL_OFFSET];
+        missing[v] = n[0] == 0.f && n[1] == 0.f && n[2] == 0.f;
+    }
+
+    for (size_t i = 0; i + 2 < mesh.Indices.size(); i += 3) {
+        const GLfloat* p[3];
+        for (int k = 0; k < 3; ++k) {
+            p[k] = &mesh.Vertices[mesh.Indices[i + k] * stride];
+        }
+        const glm::vec3 e1(p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2]);
+        const glm::vec3 e2(p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2]);
+        // Длина векторного произведения - удвоенная площадь, большие грани весят больше
+        const glm::vec3 normal = glm::cross(e1, e2);
+        for (int k = 0; k < 3; ++k) {
+            if (missing[mesh.Indices[i + k]]) {
+                GLfloat* n = &mesh.Vertices[mesh.Indices[i + k] * stride + ImportedMesh::NORMAL_OFFSET];
+                n[0] += normal.x;
+                n[1] += normal.y;
+                n[2] += normal.z;
+            }
+        }
+    }
+
+    for (size_t v = 0; v < missing.size(); ++v) {
+        if (!missing[v]) {
+            continue;
+        }
+        GLfloat* n = &mesh.Vertices[v * stride + ImportedMesh::NORMAL_OFFSET];
+        const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length > 0.f) {
+            n[0] /= length;
+            n[1] /= length;
+            n[2] /= length;
+        }
+    }
+}
+
+// ================================= OBJ =================================
+
+// Отрицательный индекс OBJ считается от конца списка на момент строки - внутри куска это известно
+// только относительно начала куска. Такие индексы хранятся как (локальный номер - OBJ_RELATIVE_BIAS) < 0
+// и получают абсолютное значение при склейке, когда известны размеры предыдущих кусков.
+static const std::int32_t OBJ_RELATIVE_BIAS = 1 << 30;
+static const size_t OBJ_CHUNK_BYTES = 4 << 20;
+
+// Кусок файла по границам строк, разобранный одним потоком
+struct ObjChunk {
+    const char* Begin = nullptr;
+    const char* End = nullptr;
+
+    std::vector<GLfloat> Positions;
+    std::vector<GLfloat> TexCoords;
+    std::vector<GLfloat> Normals;
+    // Углы треугольников после разбиения веером: тройки (v, vt, vn), 0 - нет значения
+    std::vector<std::int32_t> Corners;
+    // Смены части (o/g/usemtl): имя и номер первого угла внутри куска
+    std::vector<std::pair<std::string, size_t>> Groups;
+
+    size_t Lines = 0;
+    // Номер строки с ошибкой внутри куска, 0 - ошибок нет
+    size_t ErrorLine = 0;
+};
+
+static const char* SkipSpaces(const char* cursor, const char* end)
+{
+    while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r')) {
+        ++cursor;
+    }
+    return cursor;
+}
+
+// Не больше count чисел до конца строки, недостающие - нули. nullptr - в строке мусор.
+static const char* ParseFloats(const char* cursor, const char* end, GLfloat* values, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        cursor = SkipSpaces(cursor, end);
+        if (cursor == end) {
+            values[i] = 0.f;
+            continue;
+        }
+        if (*cursor == '+') {
+            ++cursor;
+        }
+        const std::from_chars_result result = std::from_chars(cursor, end, values[i]);
+        if (result.ec != std::errc()) {
+            return nullptr;
+        }
+        cursor = result.ptr;
+    }
+    return cursor;
+}
+
+static const char* ParseObjIndex(const char* cursor, const char* end, size_t localCount, std::int32_t& index)
+{
+    std::int32_t value = 0;
+    const std::from_chars_result result = std::from_chars(cursor, end, value);
+    if (result.ec != std::errc() || value == 0) {
+        return nullptr;
+    }
+    index = value > 0 ? value : static_cast<std::int32_t>(localCount) + value + 1 - OBJ_RELATIVE_BIAS;
+    return result.ptr;
+}
+
+static std::string ObjName(const char* cursor, const char* end)
+{
+    cursor = SkipSpaces(cursor, end);
+    while (end > cursor && (end[-1] == ' ' || end[-1] == '\t' || end[-1] == '\r')) {
+        --end;
+    }
+    return std::string(cursor, end);
+}
+
+static bool IsObjKeyword(const char* cursor, const char* end, const char* keyword, size_t length)
+{
+    return size_t(end - cursor) > length && memcmp(cursor, keyword, length) == 0 && (cursor[length] == ' ' || cursor[length] == '\t');
+}
+
+static void ParseObjChunk(ObjChunk& chunk)
+{
+    std::vector<std::int32_t> polygon;
+    const char* lineBegin = chunk.Begin;
+    while (lineBegin < chunk.End) {
+        const char* newline = static_cast<const char*>(memchr(lineBegin, '\n', chunk.End - lineBegin));
+        const char* lineEnd = newline != nullptr ? newline : chunk.End;
+        ++chunk.Lines;
+        const char* cursor = SkipSpaces(lineBegin, lineEnd);
+        lineBegin = lineEnd + 1;
+        if (cursor == lineEnd) {
+            continue;
+        }
+
+        bool valid = true;
+        if (IsObjKeyword(cursor, lineEnd, "v", 1)) {
+            GLfloat values[3];
+            valid = ParseFloats(cursor + 2, lineEnd, values, 3) != nullptr;
+            chunk.Positions.insert(chunk.Positions.end(), values, values + 3);
+        }
+        else if (IsObjKeyword(cursor, lineEnd, "vt", 2)) {
+            GLfloat values[2];
+            valid = ParseFloats(cursor + 3, lineEnd, values, 2) != nullptr;
+            chunk.TexCoords.insert(chunk.TexCoords.end(), values, values + 2);
+        }
+        else if (IsObjKeyword(cursor, lineEnd, "vn", 2)) {
+            GLfloat values[3];
+            valid = ParseFloats(cursor + 3, lineEnd, values, 3) != nullptr;
+            chunk.Normals.insert(chunk.Normals.end(), values, values + 3);
+        }
+        else if (IsObjKeyword(cursor, lineEnd, "f", 1)) {
+            // v, v/vt, v//vn, v/vt/vn
+            polygon.clear();
+            cursor = SkipSpaces(cursor + 2, lineEnd);
+            while (valid && cursor < lineEnd) {
+                std::int32_t corner[3] = { 0, 0, 0 };
+                cursor = ParseObjIndex(cursor, lineEnd, chunk.Positions.size() / 3, corner[0]);
+                if (cursor != nullptr && cursor < lineEnd && *cursor == '/') {
+                    ++cursor;
+                    if (cursor < lineEnd && *cursor != '/') {
+                        cursor = ParseObjIndex(cursor, lineEnd, chunk.TexCoords.size() / 2, corner[1]);
+                    }
+                    if (cursor != nullptr && cursor < lineEnd && *cursor == '/') {
+                        cursor = ParseObjIndex(cursor + 1, lineEnd, chunk.Normals.size() / 3, corner[2]);
+                    }
+                }
+                valid = cursor != nullptr;
+                if (valid) {
+                    polygon.insert(polygon.end(), corner, corner + 3);
+                    cursor = SkipSpaces(cursor, lineEnd);
+                }
+            }
+            // Веер из первой вершины
+            for (size_t i = 6; valid && i < polygon.size(); i += 3) {
+                chunk.Corners.insert(chunk.Corners.end(), polygon.begin(), polygon.begin() + 3);
+                chunk.Corners.insert(chunk.Corners.end(), polygon.begin() + i - 3, polygon.begin() + i + 3);
+            }
+        }
+        else if (IsObjKeyword(cursor, lineEnd, "o", 1) || IsObjKeyword(cursor, lineEnd, "g", 1)) {
+            chunk.Groups.emplace_back(ObjName(cursor + 2, lineEnd), chunk.Corners.size() / 3);
+        }
+        else if (IsObjKeyword(cursor, lineEnd, "usemtl", 6)) {
+            chunk.Groups.emplace_back(ObjName(cursor + 7, lineEnd), chunk.Corners.size() / 3);
+        }
+
+        if (!valid) {
+            chunk.ErrorLine = chunk.Lines;
+            return;
+        }
+    }
+}
+
+// 0 - значения нет, иначе индекс должен попасть в список из total элементов
+static bool ResolveObjCorner(std::int32_t& index, size_t base, size_t total)
+{
+    if (index < 0) {
+        index += OBJ_RELATIVE_BIAS + static_cast<std::int32_t>(base);
+        return index > 0 && size_t(index) <= total;
+    }
+    return size_t(index) <= total;
+}
+
+bool MeshImport::LoadObjTriangles(const std::string& path, std::vector<GLfloat>& vertices, std::vector<ImportedMesh::Submesh>* submeshes)
+{
+    MappedFile file;
+    if (!file.Open(path)) {
+        std::cout << "ERROR::MESH_IMPORT::CANNOT_READ " << path << std::endl;
+        return false;
+    }
+
+    // Куски примерно по OBJ_CHUNK_BYTES, каждый заканчивается переводом строки
+    std::vector<ObjChunk> chunks;
+    const char* const fileEnd = file.Data() + file.Size();
+    for (const char* begin = file.Data(); begin < fileEnd;) {
+        const char* end = begin + std::min<size_t>(OBJ_CHUNK_BYTES, fileEnd - begin);
+        if (end < fileEnd) {
+            const char* newline = static_cast<const char*>(memchr(end, '\n', fileEnd - end));
+            end = newline != nullptr ? newline + 1 : fileEnd;
+        }
+        chunks.emplace_back();
+        chunks.back().Begin = begin;
+        chunks.back().End = end;
+        begin = end;
+    }
+
+    ThreadPool& pool = ThreadPool::Instance();
+    pool.ParallelFor(chunks.size(), [&chunks](size_t i) {
+        ParseObjChunk(chunks[i]);
+    });
+
+    // Смещения кусков в общих списках v/vt/vn и в выходных вершинах
+    std::vector<size_t> positionBase(chunks.size());
+    std::vector<size_t> texCoordBase(chunks.size());
+    std::vector<size_t> normalBase(chunks.size());
+    std::vector<size_t> cornerBase(chunks.size());
+    size_t lines = 0;
+    size_t positionCount = 0;
+    size_t texCoordCount = 0;
+    size_t normalCount = 0;
+    size_t cornerCount = 0;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        if (chunks[i].ErrorLine != 0) {
+            std::cout << "ERROR::MESH_IMPORT::OBJ_BAD_LINE " << path << ":" << lines + chunks[i].ErrorLine << std::endl;
+            return false;
+        }
+        lines += chunks[i].Lines;
+        positionBase[i] = positionCount;
+        texCoordBase[i] = texCoordCount;
+        normalBase[i] = normalCount;
+        cornerBase[i] = cornerCount;
+        positionCount += chunks[i].Positions.size() / 3;
+        texCoordCount += chunks[i].TexCoords.size() / 2;
+        normalCount += chunks[i].Normals.size() / 3;
+        cornerCount += chunks[i].Corners.size() / 3;
+    }
+    if (cornerCount == 0) {
+        std::cout << "ERROR::MESH_IMPORT::NO_TRIANGLES " << path << std::endl;
+        return false;
+    }
+
+    std::vector<GLfloat> positions(positionCount * 3);
+    std::vector<GLfloat> texCoords(texCoordCount * 2);
+    std::vector<GLfloat> normals(normalCount * 3);
+    pool.ParallelFor(chunks.size(), [&](size_t i) {
+        std::copy(chunks[i].Positions.begin(), chunks[i].Positions.end(), positions.begin() + positionBase[i] * 3);
+        std::copy(chunks[i].TexCoords.begin(), chunks[i].TexCoords.end(), texCoords.begin() + texCoordBase[i] * 2);
+        std::copy(chunks[i].Normals.begin(), chunks[i].Normals.end(), normals.begin() + normalBase[i] * 3);
+    });
+
+    // Углы раскрываются в вершины параллельно: место каждого куска известно заранее
+    vertices.resize(cornerCount * ImportedMesh::FLOATS_PER_VERTEX);
+    std::vector<char> badIndex(chunks.size(), 0);
+    pool.ParallelFor(chunks.size(), [&](size_t i) {
+        ObjChunk& chunk = chunks[i];
+        GLfloat* vertex = vertices.data() + cornerBase[i] * ImportedMesh::FLOATS_PER_VERTEX;
+        for (size_t c = 0; c < chunk.Corners.size(); c += 3, vertex += ImportedMesh::FLOATS_PER_VERTEX) {
+            std::int32_t* corner = &chunk.Corners[c];
+            if (!ResolveObjCorner(corner[0], positionBase[i], positionCount) || corner[0] == 0
+                || !ResolveObjCorner(corner[1], texCoordBase[i], texCoordCount)
+                || !ResolveObjCorner(corner[2], normalBase[i], normalCount)) {
+                badIndex[i] = 1;
+                return;
+            }
+            memcpy(vertex, &positions[(corner[0] - 1) * 3], 3 * sizeof(GLfloat));
+            if (corner[1] > 0) {
+                memcpy(vertex + ImportedMesh::UV_OFFSET, &texCoords[(corner[1] - 1) * 2], 2 * sizeof(GLfloat));
+            }
+            else {
+                vertex[ImportedMesh::UV_OFFSET] = vertex[ImportedMesh::UV_OFFSET + 1] = 0.f;
+            }
+            if (corner[2] > 0) {
+                memcpy(vertex + ImportedMesh::NORMAL_OFFSET, &normals[(corner[2] - 1) * 3], 3 * sizeof(GLfloat));
+            }
+            else {
+                vertex[ImportedMesh::NORMAL_OFFSET] = vertex[ImportedMesh::NORMAL_OFFSET + 1] = vertex[ImportedMesh::NORMAL_OFFSET + 2] = 0.f;
+            }
+        }
+        // Углы кусков больше не нужны - освобождаем память, пока идут остальные
+        std::vector<std::int32_t>().swap(chunk.Corners);
+    });
+    if (std::find(badIndex.begin(), badIndex.end(), 1) != badIndex.end()) {
+        std::cout << "ERROR::MESH_IMPORT::OBJ_BAD_INDEX " << path << std::endl;
+        return false;
+    }
+
+    if (submeshes != nullptr) {
+        // Пустые части (несколько o/g/usemtl подряд) сливаются со следующей
+        submeshes->clear();
+        submeshes->push_back({ "default", 0, 0 });
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            for (const auto& group : chunks[i].Groups) {
+                const std::uint32_t first = static_cast<std::uint32_t>(cornerBase[i] + group.second);
+                if (first == submeshes->back().FirstIndex) {
+                    submeshes->back().Name = group.first;
+                    continue;
+                }
+                submeshes->back().IndexCount = first - submeshes->back().FirstIndex;
+                submeshes->push_back({ group.first, first, 0 });
+            }
+        }
+        submeshes->back().IndexCount = static_cast<std::uint32_t>(cornerCount) - submeshes->back().FirstIndex;
+        if (submeshes->back().IndexCount == 0) {
+            submeshes->pop_back();
+        }
+    }
+    return true;
+}
+
+bool MeshImport::LoadObj(const std::string& path, ImportedMesh& mesh)
+{
+    std::vector<GLfloat> triangles;
+    std::vector<ImportedMesh::Submesh> submeshes;
+    if (!LoadObjTriangles(path, triangles, &submeshes)) {
+        return false;
+    }
+    // Сварка сохраняет порядок углов, поэтому диапазоны частей остаются прежними
+    IndexedMesh indexed = MeshIndexer::Build(triangles, ImportedMesh::FLOATS_PER_VERTEX);
+    std::vector<GLfloat>().swap(triangles);
+    mesh.Vertices.resize(indexed.Vertices.size() / sizeof(GLfloat));
+    memcpy(mesh.Vertices.data(), indexed.Vertices.data(), indexed.Vertices.size());
+    mesh.Indices = std::move(indexed.Indices);
+    mesh.Submeshes = std::move(submeshes);
+    GenerateMissingNormals(mesh);
+    return true;
+}
+
+// ================================= glTF =================================
+
+// Минимальный разбор JSON - ровно то, что нужно для glTF
+struct JsonValue {
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    Type Kind = Type::Null;
+    double Number = 0.0;
+    std::string String;
+    std::vector<JsonValue> Items;
+    std::vector<std::pair<std::string, JsonValue>> Members;
+
+    const JsonValue* Find(const char* key) const
+    {
+        for (const auto& member : Members) {
+            if (member.first == key) {
+                return &member.second;
+            }
+        }
+        return nullptr;
+    }
+
+    double NumberOr(const char* key, double fallback) const
+    {
+        const JsonValue* value = Find(key);
+        return value != nullptr && value->Kind == Type::Number ? value->Number : fallback;
+    }
+};
+
+class JsonParser
+{
+public:
+    JsonParser(const char* begin, const char* end)
+        : cursor(begin), end(end)
+    {
+    }
+
+    bool Parse(JsonValue& value)
+    {
+        return ParseValue(value, 0) && (SkipSpace(), cursor == end);
+    }
+
+private:
+    // Защита от переполнения стека на вредных файлах
+    static const int MAX_DEPTH = 64;
+
+    const char* cursor;
+    const char* end;
+
+    void SkipSpace()
+    {
+        while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\n' || *cursor == '\r')) {
+            ++cursor;
+        }
+    }
+
+    bool Match(const char* literal)
+    {
+        const size_t length = strlen(literal);
+        if (size_t(end - cursor) < length || strncmp(cursor, literal, length) != 0) {
+            return false;
+        }
+        cursor += length;
+        return true;
+    }
+
+    bool ParseString(std::string& out)
+    {
+        if (cursor >= end || *cursor != '"') {
+            return false;
+        }
+        ++cursor;
+        while (cursor < end && *cursor != '"') {
+            char c = *cursor++;
+            if (c == '\\') {
+                if (cursor >= end) {
+                    return false;
+                }
+                c = *cursor++;
+                switch (c) {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case 'r': c = '\r'; break;
+                case 'b': c = '\b'; break;
+                case 'f': c = '\f'; break;
+                case 'u': {
+                    // Имена в glTF почти всегда ASCII: \uXXXX за пределами ASCII заменяем на '?'
+                    if (end - cursor < 4) {
+                        return false;
+                    }
+                    const long code = std::strtol(std::string(cursor, 4).c_str(), nullptr, 16);
+                    c = code <= 0x7F ? static_cast<char>(code) : '?';
+                    cursor += 4;
+                    break;
+                }
+                default:
+                    break;
+                }
+            }
+            out.push_back(c);
+        }
+        if (cursor >= end) {
+            return false;
+        }
+        ++cursor;
+        return true;
+    }
+
+    bool ParseValue(JsonValue& value, int depth)
+    {
+        SkipSpace();
+        if (cursor >= end || depth > MAX_DEPTH) {
+            return false;
+        }
+
+        switch (*cursor) {
+        case '{': {
+            ++cursor;
+            value.Kind = JsonValue::Type::Object;
+            SkipSpace();
+            if (cursor < end && *cursor == '}') {
+                ++cursor;
+                return true;
+            }
+            while (true) {
+                SkipSpace();
+                std::pair<std::string, JsonValue> member;
+                if (!ParseString(member.first)) {
+                    return false;
+                }
+                SkipSpace();
+                if (cursor >= end || *cursor++ != ':') {
+                    return false;
+                }
+                if (!ParseValue(member.second, depth + 1)) {
+                    return false;
+                }
+                value.Members.push_back(std::move(member));
+                SkipSpace();
+                if (cursor < end && *cursor == ',') {
+                    ++cursor;
+                    continue;
+                }
+                return cursor < end && *cursor++ == '}';
+            }
+        }
+        case '[': {
+            ++cursor;
+            value.Kind = JsonValue::Type::Array;
+            SkipSpace();
+            if (cursor < end && *cursor == ']') {
+                ++cursor;
+                return true;
+            }
+            while (true) {
+                value.Items.emplace_back();
+                if (!ParseValue(value.Items.back(), depth + 1)) {
+                    return false;
+                }
+                SkipSpace();
+                if (cursor < end && *cursor == ',') {
+                    ++cursor;
+                    continue;
+                }
+                return cursor < end && *cursor++ == ']';
+            }
+        }
+        case '"':
+            value.Kind = JsonValue::Type::String;
+            return ParseString(value.String);
+        case 't':
+            value.Kind = JsonValue::Type::Bool;
+            value.Number = 1.0;
+            return Match("true");
+        case 'f':
+            value.Kind = JsonValue::Type::Bool;
+            return Match("false");
+        case 'n':
+            return Match("null");
+        default: {
+            // strtod дочитывает только до конца числа; текст JSON заканчивается '\0' в std::string
+            char* numberEnd = nullptr;
+            value.Kind = JsonValue::Type::Number;
+            value.Number = std::strtod(cursor, &numberEnd);
+            if (numberEnd == cursor || numberEnd > end) {
+                return false;
+            }
+            cursor = numberEnd;
+            return true;
+        }
+        }
+    }
+};
+
+static bool DecodeBase64(const char* text, size_t length, std::vector<std::uint8_t>& out)
+{
+    auto decode = [](char c) -> int {
+        if (c >= 'A' && c <= 'Z') return c - 'A';
+        if (c >= 'a' && c <= 'z') return c - 'a' + 26;
+        if (c >= '0' && c <= '9') return c - '0' + 52;
+        if (c == '+') return 62;
+        if (c == '/') return 63;
+        return -1;
+    };
+
+    std::uint32_t accumulator = 0;
+    int bits = 0;
+    for (size_t i = 0; i < length; ++i) {
+        if (text[i] == '=') {
+            break;
+        }
+        const int value = decode(text[i]);
+        if (value < 0) {
+            return false;
+        }
+        accumulator = (accumulator << 6) | static_cast<std::uint32_t>(value);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            out.push_back(static_cast<std::uint8_t>(accumulator >> bits));
+        }
+    }
+    return true;
+}
+
+// Константы glTF
+static const int GLTF_FLOAT = 5126;
+static const int GLTF_UNSIGNED_BYTE = 5121;
+static const int GLTF_UNSIGNED_SHORT = 5123;
+static const int GLTF_UNSIGNED_INT = 5125;
+static const int GLTF_TRIANGLES = 4;
+static const std::uint32_t GLB_MAGIC = 0x46546C67;       // 'glTF'
+static const std::uint32_t GLB_CHUNK_JSON = 0x4E4F534A;  // 'JSON'
+static const std::uint32_t GLB_CHUNK_BIN = 0x004E4942;   // 'BIN\0'
+
+struct GltfDocument {
+    JsonValue Root;
+    std::vector<std::vector<std::uint8_t>> Buffers;
+};
+
+// Элементы accessor: указатель на первый, шаг и количество. false - если accessor не помещается в буфер.
+struct GltfAccessor {
+    const std::uint8_t* Data = nullptr;
+    size_t Stride = 0;
+    size_t Count = 0;
+    int ComponentType = 0;
+    int Components = 0;
+};
+
+static int ComponentSize(int componentType)
+{
+    switch (componentType) {
+    case GLTF_UNSIGNED_BYTE: return 1;
+    case GLTF_UNSIGNED_SHORT: return 2;
+    case GLTF_UNSIGNED_INT:
+    case GLTF_FLOAT: return 4;
+    default: return 0;
+    }
+}
+
+static int ComponentCount(const std::string& type)
+{
+    if (type == "SCALAR") return 1;
+    if (type == "VEC2") return 2;
+    if (type == "VEC3") return 3;
+    if (type == "VEC4") return 4;
+    return 0;
+}
+
+static bool ResolveAccessor(const GltfDocument& document, size_t index, GltfAccessor& accessor)
+{
+    const JsonValue* accessors = document.Root.Find("accessors");
+    const JsonValue* views = document.Root.Find("bufferViews");
+    if (accessors == nullptr || views == nullptr || index >= accessors->Items.size()) {
+        return false;
+    }
+    const JsonValue& source = accessors->Items[index];
+    const JsonValue* type = source.Find("type");
+    if (source.Find("sparse") != nullptr || source.Find("bufferView") == nullptr || type == nullptr) {
+        return false;
+    }
+
+    const size_t viewIndex = static_cast<size_t>(source.NumberOr("bufferView", 0));
+    if (viewIndex >= views->Items.size()) {
+        return false;
+    }
+    const JsonValue& view = views->Items[viewIndex];
+    const size_t bufferIndex = static_cast<size_t>(view.NumberOr("buffer", 0));
+    if (bufferIndex >= document.Buffers.size()) {
+        return false;
+    }
+    const std::vector<std::uint8_t>& buffer = document.Buffers[bufferIndex];
+
+    accessor.ComponentType = static_cast<int>(source.NumberOr("componentType", 0));
+    accessor.Components = ComponentCount(type->String);
+    accessor.Count = static_cast<size_t>(source.NumberOr("count", 0));
+    const size_t elementSize = size_t(ComponentSize(accessor.ComponentType)) * accessor.Components;
+    accessor.Stride = static_cast<size_t>(view.NumberOr("byteStride", double(elementSize)));
+    const size_t offset = static_cast<size_t>(view.NumberOr("byteOffset", 0) + source.NumberOr("byteOffset", 0));
+    if (elementSize == 0 || accessor.Count == 0
+        || offset + (accessor.Count - 1) * accessor.Stride + elementSize > buffer.size()) {
+        return false;
+    }
+    accessor.Data = buffer.data() + offset;
+    return true;
+}
+
+static bool LoadGltfDocument(const std::string& path, GltfDocument& document)
+{
+    std::string data;
+    if (!ReadFile(path, data)) {
+        return false;
+    }
+
+    const char* jsonBegin = data.data();
+    const char* jsonEnd = data.data() + data.size();
+    std::vector<std::uint8_t> binaryChunk;
+    std::uint32_t magic = 0;
+    if (data.size() >= 12) {
+        memcpy(&magic, data.data(), sizeof(magic));
+    }
+    if (magic == GLB_MAGIC) {
+        // .glb: заголовок 12 байт, затем чанки (длина, тип, данные)
+        size_t offset = 12;
+        jsonBegin = jsonEnd = nullptr;
+        while (offset + 8 <= data.size()) {
+            std::uint32_t length;
+            std::uint32_t type;
+            memcpy(&length, data.data() + offset, sizeof(length));
+            memcpy(&type, data.data() + offset + 4, sizeof(type));
+            offset += 8;
+            if (offset + length > data.size()) {
+                break;
+            }
+            if (type == GLB_CHUNK_JSON) {
+                jsonBegin = data.data() + offset;
+                jsonEnd = jsonBegin + length;
+            }
+            else if (type == GLB_CHUNK_BIN) {
+                binaryChunk.assign(data.data() + offset, data.data() + offset + length);
+            }
+            offset += length;
+        }
+        if (jsonBegin == nullptr) {
+            std::cout << "ERROR::MESH_IMPORT::GLB_NO_JSON " << path << std::endl;
+            return false;
+        }
+        // Числа в конце JSON-чанка разбирает strtod - держим копию с завершающим нулем
+        data.assign(jsonBegin, jsonEnd);
+        jsonBegin = data.data();
+        jsonEnd = data.data() + data.size();
+    }
+
+    if (!JsonParser(jsonBegin, jsonEnd).Parse(document.Root) || document.Root.Kind != JsonValue::Type::Object) {
+        std::cout << "ERROR::MESH_IMPORT::GLTF_BAD_JSON " << path << std::endl;
+        return false;
+    }
+
+    const JsonValue* buffers = document.Root.Find("buffers");
+    if (buffers == nullptr) {
+        return true;
+    }
+    for (const JsonValue& buffer : buffers->Items) {
+        document.Buffers.emplace_back();
+        std::vector<std::uint8_t>& bytes = document.Buffers.back();
+        const JsonValue* uri = buffer.Find("uri");
+        if (uri == nullptr) {
+            // Буфер без uri в .glb - бинарный чанк
+            bytes = binaryChunk;
+            continue;
+        }
+        const std::string& value = uri->String;
+        if (value.compare(0, 5, "data:") == 0) {
+            const size_t comma = value.find(',');
+            if (comma == std::string::npos || value.rfind(";base64", comma) == std::string::npos
+                || !DecodeBase64(value.data() + comma + 1, value.size() - comma - 1, bytes)) {
+                std::cout << "ERROR::MESH_IMPORT::GLTF_BAD_DATA_URI " << path << std::endl;
+                return false;
+            }
+            continue;
+        }
+        std::string file;
+        if (!ReadFile(Directory(path) + value, file)) {
+            return false;
+        }
+        bytes.assign(file.begin(), file.end());
+    }
+    return true;
+}
+
+static std::uint32_t ReadIndex(const GltfAccessor& accessor, size_t i)
+{
+    const std::uint8_t* element = accessor.Data + i * accessor.Stride;
+    switch (accessor.ComponentType) {
+    case GLTF_UNSIGNED_BYTE:
+        return *element;
+    case GLTF_UNSIGNED_SHORT: {
+        std::uint16_t value;
+        memcpy(&value, element, sizeof(value));
+        return value;
+    }
+    default: {
+        std::uint32_t value;
+        memcpy(&value, element, sizeof(value));
+        return value;
+    }
+    }
+}
+
+bool MeshImport::LoadGltf(const std::string& path, ImportedMesh& mesh)
+{
+    GltfDocument document;
+    if (!LoadGltfDocument(path, document)) {
+        return false;
+    }
+
+    const JsonValue* meshes = document.Root.Find("meshes");
+    if (meshes == nullptr) {
+        std::cout << "ERROR::MESH_IMPORT::NO_TRIANGLES " << path << std::endl;
+        return false;
+    }
+
+    for (size_t m = 0; m < meshes->Items.size(); ++m) {
+        const JsonValue& source = meshes->Items[m];
+        const JsonValue* name = source.Find("name");
+        const JsonValue* primitives = source.Find("primitives");
+        if (primitives == nullptr) {
+            continue;
+        }
+
+        for (size_t p = 0; p < primitives->Items.size(); ++p) {
+            const JsonValue& primitive = primitives->Items[p];
+            const JsonValue* attributes = primitive.Find("attributes");
+            if (primitive.NumberOr("mode", GLTF_TRIANGLES) != GLTF_TRIANGLES || attributes == nullptr) {
+                std::cout << "MeshImport: skipping non-triangle primitive " << m << "/" << p << std::endl;
+                continue;
+            }
+
+            GltfAccessor positions;
+            if (attributes->Find("POSITION") == nullptr
+                || !ResolveAccessor(document, static_cast<size_t>(attributes->NumberOr("POSITION", 0)), positions)
+                || positions.ComponentType != GLTF_FLOAT || positions.Components != 3) {
+                std::cout << "ERROR::MESH_IMPORT::GLTF_BAD_ACCESSOR POSITION " << path << std::endl;
+                return false;
+            }
+            // Необязательные атрибуты в другом формате пропускаются - нормали потом посчитаются по граням
+            GltfAccessor normals;
+            const bool hasNormals = attributes->Find("NORMAL") != nullptr
+                && ResolveAccessor(document, static_cast<size_t>(attributes->NumberOr("NORMAL", 0)), normals)
+                && normals.ComponentType == GLTF_FLOAT && normals.Components == 3 && normals.Count == positions.Count;
+            GltfAccessor texCoords;
+            const bool hasTexCoords = attributes->Find("TEXCOORD_0") != nullptr
+                && ResolveAccessor(document, static_cast<size_t>(attributes->NumberOr("TEXCOORD_0", 0)), texCoords)
+                && texCoords.ComponentType == GLTF_FLOAT && texCoords.Components == 2 && texCoords.Count == positions.Count;
+
+            const std::uint32_t baseVertex = static_cast<std::uint32_t>(mesh.VertexCount());
+            for (size_t v = 0; v < positions.Count; ++v) {
+                GLfloat vertex[ImportedMesh::FLOATS_PER_VERTEX] = {};
+                memcpy(vertex, positions.Data + v * positions.Stride, 3 * sizeof(GLfloat));
+                if (hasTexCoords) {
+                    memcpy(vertex + ImportedMesh::UV_OFFSET, texCoords.Data + v * texCoords.Stride, 2 * sizeof(GLfloat));
+                }
+                if (hasNormals) {
+                    memcpy(vertex + ImportedMesh::NORMAL_OFFSET, normals.Data + v * normals.Stride, 3 * sizeof(GLfloat));
+                }
+                mesh.Vertices.insert(mesh.Vertices.end(), vertex, vertex + ImportedMesh::FLOATS_PER_VERTEX);
+            }
+
+            ImportedMesh::Submesh submesh;
+            submesh.Name = (name != nullptr ? name->String : "mesh" + std::to_string(m)) + "." + std::to_string(p);
+            submesh.FirstIndex = static_cast<std::uint32_t>(mesh.Indices.size());
+            if (primitive.Find("indices") != nullptr) {
+                GltfAccessor indices;
+                if (!ResolveAccessor(document, static_cast<size_t>(primitive.NumberOr("indices", 0)), indices)
+                    || indices.Components != 1 || indices.ComponentType == GLTF_FLOAT) {
+                    std::cout << "ERROR::MESH_IMPORT::GLTF_BAD_ACCESSOR indices " << path << std::endl;
+                    return false;
+                }
+                for (size_t i = 0; i + 2 < indices.Count; i += 3) {
+                    for (size_t k = 0; k < 3; ++k) {
+                        const std::uint32_t index = ReadIndex(indices, i + k);
+                        if (index >= positions.Count) {
+                            std::cout << "ERROR::MESH_IMPORT::GLTF_BAD_INDEX " << path << std::endl;
+                            return false;
+                        }
+                        mesh.Indices.push_back(baseVertex + index);
+                    }
+                }
+            }
+            else {
+                for (size_t i = 0; i + 2 < positions.Count; i += 3) {
+                    for (size_t k = 0; k < 3; ++k) {
+                        mesh.Indices.push_back(baseVertex + static_cast<std::uint32_t>(i + k));
+                    }
+                }
+            }
+            submesh.IndexCount = static_cast<std::uint32_t>(mesh.Indices.size() - submesh.FirstIndex);
+            if (submesh.IndexCount > 0) {
+                mesh.Submeshes.push_back(submesh);
+            }
+        }
+    }
+
+    if (mesh.Indices.empty()) {
+        std::cout << "ERROR::MESH_IMPORT::NO_TRIANGLES " << path << std::endl;
+        return false;
+    }
+    GenerateMissingNormals(mesh);
+    return true;
+}
+
+bool MeshImport::Load(const std::string& path, ImportedMesh& mesh)
+{
+    const std::string extension = Extension(path);
+    if (extension == ".obj") {
+        return LoadObj(path, mesh);
+    }
+    if (extension == ".gltf" || extension == ".glb") {
+        return LoadGltf(path, mesh);
+    }
+    std::cout << "ERROR::MESH_IMPORT::UNKNOWN_FORMAT " << path << std::endl;
+    return false;
+}
+
+static MeshFileSubmesh MakeSubmesh(const ImportedMesh& mesh, const ImportedMesh::Submesh& source)
+{
+    MeshFileSubmesh submesh = {};
+    submesh.FirstIndex = source.FirstIndex;
+    submesh.IndexCount = source.IndexCount;
+    strncpy(submesh.Name, source.Name.c_str(), sizeof(submesh.Name) - 1);
+
+    glm::vec3 low(INFINITY);
+    glm::vec3 high(-INFINITY);
+    for (std::uint32_t i = source.FirstIndex; i < source.FirstIndex + source.IndexCount; ++i) {
+        const GLfloat* p = &mesh.Vertices[mesh.Indices[i] * ImportedMesh::FLOATS_PER_VERTEX];
+        low = glm::min(low, glm::vec3(p[0], p[1], p[2]));
+        high = glm::max(high, glm::vec3(p[0], p[1], p[2]));
+    }
+    const glm::vec3 center = (low + high) * 0.5f;
+    float radius = 0.f;
+    for (std::uint32_t i = source.FirstIndex; i < source.FirstIndex + source.IndexCount; ++i) {
+        const GLfloat* p = &mesh.Vertices[mesh.Indices[i] * ImportedMesh::FLOATS_PER_VERTEX];
+        radius = std::max(radius, glm::length(glm::vec3(p[0], p[1], p[2]) - center));
+    }
+    for (int k = 0; k < 3; ++k) {
+        submesh.Center[k] = center[k];
+        submesh.BoundsMin[k] = low[k];
+        submesh.BoundsMax[k] = high[k];
+    }
+    submesh.Radius = radius;
+    return submesh;
+}
+
+bool MeshImport::Prepare(const std::string& input, PackedMesh& packed)
+{
+    ImportedMesh imported;
+    if (!Load(input, imported)) {
+        return false;
+    }
+
+    IndexedMesh mesh;
+    mesh.VertexStride = ImportedMesh::FLOATS_PER_VERTEX * sizeof(GLfloat);
+    mesh.Vertices.resize(imported.Vertices.size() * sizeof(GLfloat));
+    memcpy(mesh.Vertices.data(), imported.Vertices.data(), mesh.Vertices.size());
+    mesh.SourceVertexCount = imported.VertexCount();
+
+    // Части остаются непрерывными диапазонами: треугольники переставляются только внутри своей части,
+    // а перестановка вершин под выборку общая и порядок треугольников не меняет
+    mesh.Indices = imported.Indices;
+    const VertexCacheStats before = MeshOptimizer::AnalyzeVertexCache(mesh.Indices, mesh.VertexCount());
+    for (const ImportedMesh::Submesh& submesh : imported.Submeshes) {
+        std::vector<std::uint32_t> indices(mesh.Indices.begin() + submesh.FirstIndex, mesh.Indices.begin() + submesh.FirstIndex + submesh.IndexCount);
+        MeshOptimizer::OptimizeVertexCache(indices, mesh.VertexCount());
+        std::copy(indices.begin(), indices.end(), mesh.Indices.begin() + submesh.FirstIndex);
+    }
+    MeshOptimizer::OptimizeVertexFetch(mesh);
+    MeshOptimizeStats optimizeStats;
+    optimizeStats.Before = before;
+    optimizeStats.After = MeshOptimizer::AnalyzeVertexCache(mesh.Indices, mesh.VertexCount());
+    MeshOptimizer::PrintReport(input.c_str(), optimizeStats);
+
+    // Границы считаются по точным float, вершины уже в порядке после OptimizeVertexFetch
+    memcpy(imported.Vertices.data(), mesh.Vertices.data(), mesh.Vertices.size());
+    imported.Vertices.resize(mesh.Vertices.size() / sizeof(GLfloat));
+    imported.Indices = mesh.Indices;
+    packed.Submeshes.clear();
+    for (const ImportedMesh::Submesh& submesh : imported.Submeshes) {
+        packed.Submeshes.push_back(MakeSubmesh(imported, submesh));
+    }
+
+    // Позиции остаются float - у ассетов бывают большие координаты; нормали в 10_10_10_2.
+    // UV в 16 бит, только если все они в [0, 1], иначе повторение текстуры сломается.
+    bool uvInRange = true;
+    for (size_t v = 0; v < imported.VertexCount(); ++v) {
+        const GLfloat* uv = &imported.Vertices[v * ImportedMesh::FLOATS_PER_VERTEX + ImportedMesh::UV_OFFSET];
+        uvInRange = uvInRange && uv[0] >= 0.f && uv[0] <= 1.f && uv[1] >= 0.f && uv[1] <= 1.f;
+    }
+    packed.Layout = VertexLayout()
+        .Add(0, VertexFormat::Float3)
+        .Add(1, uvInRange ? VertexFormat::UNorm16x2 : VertexFormat::Float2)
+        .Add(2, VertexFormat::SNorm10x3);
+
+    QuantizeReport report;
+    packed.Vertices = VertexQuantizer::Convert(imported.Vertices, ImportedMesh::Layout(), packed.Layout, &report);
+    VertexQuantizer::PrintReport(input.c_str(), report);
+    packed.Indices = std::move(imported.Indices);
+    return true;
+}
+
+int MeshImport::Convert(const std::string& input, const std::string& output, bool compress)
+{
+    PackedMesh packed;
+    if (!Prepare(input, packed)) {
+        return 1;
+    }
+    if (!MeshFile::Write(output, packed.Layout, packed.Vertices.data(), packed.VertexCount(), packed.Indices, packed.Submeshes, compress)) {
+        return 1;
+    }
+    std::cout << "Converted " << input << " -> " << output << ": " << packed.VertexCount() << " vertices, "
+        << packed.Indices.size() / 3 << " triangles, " << packed.Submeshes.size() << " submeshes"
+        << (compress ? ", compressed" : "") << std::endl;
+    return 0;
+}
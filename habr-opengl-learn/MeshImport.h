@@ -0,0 +1,74 @@
+#pragma once
+#include "Common.h"
+#include "MeshFile.h"
+#include "VertexLayout.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Меш сразу после импорта, до оптимизации и упаковки: индексированные вершины по FLOATS_PER_VERTEX float -
+// позиция (3), UV (2), нормаль (3). Части (группы OBJ, примитивы glTF) - диапазоны индексов.
+struct ImportedMesh {
+    static const size_t FLOATS_PER_VERTEX = 8;
+    static const size_t UV_OFFSET = 3;
+    static const size_t NORMAL_OFFSET = 5;
+
+    struct Submesh {
+        std::string Name;
+        std::uint32_t FirstIndex = 0;
+        std::uint32_t IndexCount = 0;
+    };
+
+    std::vector<GLfloat> Vertices;
+    std::vector<std::uint32_t> Indices;
+    std::vector<Submesh> Submeshes;
+
+    size_t VertexCount() const
+    {
+        return Vertices.size() / FLOATS_PER_VERTEX;
+    }
+
+    // Формат Vertices для VertexQuantizer и MaterialWithMesh::FillIndexedBuffers
+    static VertexLayout Layout()
+    {
+        return VertexLayout().Add(0, VertexFormat::Float3).Add(1, VertexFormat::Float2).Add(2, VertexFormat::Float3);
+    }
+};
+
+// Меш, готовый к записи в .mesh: вершины оптимизированы и упакованы в Layout
+struct PackedMesh {
+    VertexLayout Layout;
+    std::vector<std::uint8_t> Vertices;
+    std::vector<std::uint32_t> Indices;
+    std::vector<MeshFileSubmesh> Submeshes;
+
+    size_t VertexCount() const
+    {
+        return Layout.Stride() == 0 ? 0 : Vertices.size() / Layout.Stride();
+    }
+};
+
+// Офлайн-импорт ассетов. Ошибки - в std::cout в виде ERROR::MESH_IMPORT::..., результат - false.
+namespace MeshImport {
+    // Wavefront OBJ без сварки: тройки вершин подряд, как их ждет FillIndexedBuffers с ImportedMesh::Layout().
+    // Файл отображается в память и режется на куски по границам строк, куски разбираются (std::from_chars)
+    // в ThreadPool и склеиваются. v/vt/vn, многоугольники разбиваются веером, o/g/usemtl начинают новую часть -
+    // ее диапазон в submeshes считается в вершинах. Без vn нормали нулевые.
+    bool LoadObjTriangles(const std::string& path, std::vector<GLfloat>& vertices, std::vector<ImportedMesh::Submesh>* submeshes = nullptr);
+
+    // То же со сваркой вершин (MeshIndexer); без vn нормали усредняются по граням.
+    bool LoadObj(const std::string& path, ImportedMesh& mesh);
+
+    // glTF 2.0 (.gltf с внешними или data: буферами и .glb): треугольные примитивы всех мешей,
+    // атрибуты POSITION, NORMAL, TEXCOORD_0 в float. Иерархия узлов и их трансформации не применяются.
+    bool LoadGltf(const std::string& path, ImportedMesh& mesh);
+
+    // По расширению: .obj, .gltf, .glb
+    bool Load(const std::string& path, ImportedMesh& mesh);
+
+    // Импорт, оптимизация порядка по частям и упаковка вершин
+    bool Prepare(const std::string& input, PackedMesh& packed);
+
+    // Prepare и запись .mesh (MeshFile); compress - сжать вершины и индексы MeshCodec
+    int Convert(const std::string& input, const std::string& output, bool compress = false);
+}
@@ -0,0 +1,78 @@
+#include "MeshIndexer.h"
+#include "Hash.h"
+#include <cstring>
+
+std::vector<std::uint8_t> IndexedMesh::PackIndices() const
+{
+    std::vector<std::uint8_t> packed(Indices.size() * IndexSize());
+    if (IndexType() == GL_UNSIGNED_SHORT) {
+        std::uint16_t* out = reinterpret_cast<std::uint16_t*>(packed.data());
+        for (size_t i = 0; i < Indices.size(); ++i) {
+            out[i] = static_cast<std::uint16_t>(Indices[i]);
+        }
+    }
+    else if (!Indices.empty()) {
+        memcpy(packed.data(), Indices.data(), packed.size());
+    }
+    return packed;
+}
+
+// Пустая ячейка таблицы сварки
+static const std::uint32_t EMPTY_SLOT = ~0u;
+
+IndexedMesh MeshIndexer::Build(const void* vertices, size_t vertexCount, size_t vertexStride)
+{
+    IndexedMesh mesh;
+    mesh.VertexStride = vertexStride;
+    mesh.SourceVertexCount = vertexCount;
+    mesh.Indices.reserve(vertexCount);
+    mesh.Vertices.reserve(vertexCount * vertexStride);
+
+    // Открытая адресация по хэшу байтов вершины, заполненность не больше половины
+    size_t capacity = 16;
+    while (capacity < vertexCount * 2) {
+        capacity *= 2;
+    }
+    const size_t mask = capacity - 1;
+    std::vector<std::uint32_t> table(capacity, EMPTY_SLOT);
+
+    const std::uint8_t* source = static_cast<const std::uint8_t*>(vertices);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        const std::uint8_t* vertex = source + i * vertexStride;
+        size_t slot = HashBytes(vertex, vertexStride) & mask;
+        for (;; slot = (slot + 1) & mask) {
+            const std::uint32_t index = table[slot];
+            if (index == EMPTY_SLOT) {
+                // Новая вершина
+                const std::uint32_t added = static_cast<std::uint32_t>(mesh.VertexCount());
+                mesh.Vertices.insert(mesh.Vertices.end(), vertex, vertex + vertexStride);
+                table[slot] = added;
+                mesh.Indices.push_back(added);
+                break;
+            }
+            if (memcmp(mesh.Vertices.data() + index * vertexStride, vertex, vertexStride) == 0) {
+                mesh.Indices.push_back(index);
+                break;
+            }
+        }
+    }
+    return mesh;
+}
+
+IndexedMesh MeshIndexer::Build(const std::vector<GLfloat>& vertices, size_t floatsPerVertex)
+{
+    return Build(vertices.data(), vertices.size() / floatsPerVertex, floatsPerVertex * sizeof(GLfloat));
+}
+
+void MeshIndexer::PrintReport(const char* name, const IndexedMesh& mesh)
+{
+    const size_t sourceBytes = mesh.SourceBytes();
+    const size_t indexedBytes = mesh.IndexedBytes();
+    std::cout << "MeshIndexer: " << name
+        << " vertices=" << mesh.SourceVertexCount << "->" << mesh.VertexCount()
+        << " (-" << (mesh.SourceVertexCount ? 100 * (mesh.SourceVertexCount - mesh.VertexCount()) / mesh.SourceVertexCount : 0) << "%)"
+        << " indices=" << mesh.Indices.size() << "x" << mesh.IndexSize() << "B"
+        << " bytes=" << sourceBytes << "->" << indexedBytes
+        << " saved=" << (sourceBytes > indexedBytes ? static_cast<long long>(sourceBytes - indexedBytes) : -static_cast<long long>(indexedBytes - sourceBytes))
+        << std::endl;
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include "Common.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Индексированная сетка: уникальные вершины + индексы треугольников.
+// Вершины хранятся байтами, формат вершины задает только шаг - индексатору он не важен.
+struct IndexedMesh {
+    std::vector<std::uint8_t> Vertices;
+    size_t VertexStride = 0;
+    std::vector<std::uint32_t> Indices;
+    // Сколько вершин было до сварки
+    size_t SourceVertexCount = 0;
+
+    size_t VertexCount() const
+    {
+        return VertexStride == 0 ? 0 : Vertices.size() / VertexStride;
+    }
+
+    // 16-битные индексы, если все вершины в них помещаются
+    GLenum IndexType() const
+    {
+        return VertexCount() <= 0x10000 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    }
+
+    size_t IndexSize() const
+    {
+        return IndexType() == GL_UNSIGNED_SHORT ? sizeof(std::uint16_t) : sizeof(std::uint32_t);
+    }
+
+    // Индексы в формате IndexType(), готовые для glBufferData
+    std::vector<std::uint8_t> PackIndices() const;
+
+    // Байты до сварки и после (вершины + индексы)
+    size_t SourceBytes() const
+    {
+        return SourceVertexCount * VertexStride;
+    }
+
+    size_t IndexedBytes() const
+    {
+        return Vertices.size() + Indices.size() * IndexSize();
+    }
+};
+
+namespace MeshIndexer {
+    // Сваривает побайтно одинаковые вершины. vertexStride - размер вершины в байтах.
+    // Вершины идут тройками, как для glDrawArrays(GL_TRIANGLES); порядок первых вхождений сохраняется.
+    IndexedMesh Build(const void* vertices, size_t vertexCount, size_t vertexStride);
+
+    // То же для массива float, как его хранят материалы
+    IndexedMesh Build(const std::vector<GLfloat>& vertices, size_t floatsPerVertex);
+
+    // Сколько вершин и байт сэкономила сварка
+    void PrintReport(const char* name, const IndexedMesh& mesh);
+}
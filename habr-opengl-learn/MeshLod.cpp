@@ -0,0 +1,91 @@
+#include "MeshLod.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+void MeshLod::ComputeBounds(const void* vertices, size_t vertexCount, size_t stride, MeshLodChain& chain, size_t positionOffset)
+{
+    chain.Center = glm::vec3(0.f);
+    chain.Radius = 0.f;
+    if (vertexCount == 0) {
+        return;
+    }
+
+    const std::uint8_t* bytes = static_cast<const std::uint8_t*>(vertices) + positionOffset;
+    glm::vec3 low(std::numeric_limits<float>::max());
+    glm::vec3 high(-std::numeric_limits<float>::max());
+    for (size_t v = 0; v < vertexCount; ++v) {
+        glm::vec3 p;
+        memcpy(&p[0], bytes + v * stride, 3 * sizeof(float));
+        low = glm::min(low, p);
+        high = glm::max(high, p);
+    }
+    chain.Center = (low + high) * 0.5f;
+    for (size_t v = 0; v < vertexCount; ++v) {
+        glm::vec3 p;
+        memcpy(&p[0], bytes + v * stride, 3 * sizeof(float));
+        chain.Radius = std::max(chain.Radius, glm::length(p - chain.Center));
+    }
+}
+
+MeshLodChain MeshLod::Build(const IndexedMesh& mesh, size_t positionOffset, unsigned maxLevels)
+{
+    MeshLodChain chain;
+    ComputeBounds(mesh.Vertices.data(), mesh.VertexCount(), mesh.VertexStride, chain, positionOffset);
+
+    maxLevels = std::min(std::max(maxLevels, 1u), MAX_LEVELS);
+    chain.Indices = mesh.Indices;
+    chain.Levels.push_back({ 0, mesh.Indices.size(), 0.f });
+
+    std::vector<std::uint32_t> previous = mesh.Indices;
+    while (chain.Levels.size() < maxLevels) {
+        const size_t target = static_cast<size_t>(previous.size() / 3 * LEVEL_RATIO) * 3;
+        float error = 0.f;
+        // Каждый уровень упрощается из предыдущего: быстрее, а ошибка квадрик накапливается
+        std::vector<std::uint32_t> indices = MeshSimplifier::Simplify(mesh, previous, target, positionOffset, &error);
+        if (indices.empty() || indices.size() > previous.size() * MIN_REDUCTION) {
+            break;
+        }
+        MeshOptimizer::OptimizeVertexCache(indices, mesh.VertexCount());
+
+        MeshLodLevel level;
+        level.FirstIndex = chain.Indices.size();
+        level.IndexCount = indices.size();
+        level.Error = std::max(error, chain.Levels.back().Error);
+        chain.Levels.push_back(level);
+        chain.Indices.insert(chain.Indices.end(), indices.begin(), indices.end());
+        previous.swap(indices);
+    }
+    return chain;
+}
+
+float MeshLod::PixelsPerUnit(float distance, float fovDegrees, float viewportHeight)
+{
+    // Высота видимой области на этом расстоянии: 2 * d * tan(fov / 2)
+    const float visibleHeight = 2.f * std::max(distance, 1e-3f) * std::tan(glm::radians(fovDegrees) * 0.5f);
+    return viewportHeight / visibleHeight;
+}
+
+unsigned MeshLod::Select(const MeshLodChain& chain, float pixelsPerUnit, float scale, float errorPixels)
+{
+    unsigned selected = 0;
+    for (unsigned i = 1; i < chain.Levels.size(); ++i) {
+        if (chain.Levels[i].Error * scale * pixelsPerUnit > errorPixels) {
+            break;
+        }
+        selected = i;
+    }
+    return selected;
+}
+
+void MeshLod::PrintReport(const char* name, const MeshLodChain& chain)
+{
+    std::cout << "MeshLod: " << name << " radius=" << chain.Radius << " levels=" << chain.Levels.size();
+    for (size_t i = 0; i < chain.Levels.size(); ++i) {
+        std::cout << " [" << i << ": triangles=" << chain.Levels[i].IndexCount / 3 << " error=" << chain.Levels[i].Error << "]";
+    }
+    std::cout << std::endl;
+}
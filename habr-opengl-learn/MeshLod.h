@@ -0,0 +1,48 @@
+#pragma once
+#include "MeshIndexer.h"
+#include "Stats.h"
+#include <vector>
+
+struct MeshLodLevel {
+    // Первый индекс уровня в MeshLodChain::Indices
+    size_t FirstIndex = 0;
+    size_t IndexCount = 0;
+    // Наибольшее отклонение от уровня 0 в единицах модели
+    float Error = 0.f;
+};
+
+// Цепочка уровней детализации над одними вершинами. Индексы всех уровней идут подряд,
+// так что вся цепочка - один участок в GeometryArena, а уровень - смещение внутри него.
+struct MeshLodChain {
+    std::vector<std::uint32_t> Indices;
+    std::vector<MeshLodLevel> Levels;
+    // Ограничивающая сфера в координатах модели
+    glm::vec3 Center = glm::vec3(0.f);
+    float Radius = 0.f;
+};
+
+namespace MeshLod {
+    const unsigned MAX_LEVELS = FrameStats::LOD_LEVELS;
+    // Каждый следующий уровень целится в половину треугольников предыдущего
+    const float LEVEL_RATIO = 0.5f;
+    // Уровень, который убрал меньше 20% треугольников, не нужен - на нем цепочка обрывается
+    const float MIN_REDUCTION = 0.8f;
+    // Допустимая ошибка на экране, в пикселях
+    const float ERROR_PIXELS = 1.f;
+
+    // Ограничивающая сфера по позициям float3 со смещением positionOffset в каждой вершине
+    void ComputeBounds(const void* vertices, size_t vertexCount, size_t stride, MeshLodChain& chain, size_t positionOffset = 0);
+
+    // Уровень 0 - индексы mesh как есть, остальные - MeshSimplifier с оптимизацией под кэш вершин
+    MeshLodChain Build(const IndexedMesh& mesh, size_t positionOffset = 0, unsigned maxLevels = MAX_LEVELS);
+
+    // Сколько пикселей по высоте экрана занимает единица длины на расстоянии distance.
+    // fovDegrees - вертикальный угол обзора (Camera::Zoom).
+    float PixelsPerUnit(float distance, float fovDegrees, float viewportHeight);
+
+    // Самый грубый уровень, ошибка которого на экране не больше errorPixels.
+    // scale - масштаб модели, если матрица модели его меняет.
+    unsigned Select(const MeshLodChain& chain, float pixelsPerUnit, float scale = 1.f, float errorPixels = ERROR_PIXELS);
+
+    void PrintReport(const char* name, const MeshLodChain& chain);
+}
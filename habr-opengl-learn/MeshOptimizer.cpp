@@ -0,0 +1,354 @@
+#include "MeshOptimizer.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+// Параметры оценки из статьи Форсайта
+static const unsigned FORSYTH_CACHE_SIZE = 32;
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRIANGLE_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+// Оценки для валентности до этого значения считаются заранее
+static const unsigned VALENCE_TABLE_SIZE = 32;
+
+static const std::uint32_t NO_TRIANGLE = ~0u;
+
+struct ForsythScores {
+    float Cache[FORSYTH_CACHE_SIZE];
+    float Valence[VALENCE_TABLE_SIZE];
+
+    ForsythScores()
+    {
+        for (unsigned i = 0; i < FORSYTH_CACHE_SIZE; ++i) {
+            // Вершины последнего треугольника получают фиксированную оценку, чтобы
+            // не выбирать треугольник, который почти целиком повторяет предыдущий
+            Cache[i] = i < 3 ? LAST_TRIANGLE_SCORE
+                : std::pow(1.f - float(i - 3) / (FORSYTH_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+        }
+        Valence[0] = 0.f;
+        for (unsigned i = 1; i < VALENCE_TABLE_SIZE; ++i) {
+            Valence[i] = VALENCE_BOOST_SCALE * std::pow(float(i), -VALENCE_BOOST_POWER);
+        }
+    }
+
+    float Vertex(int cachePosition, unsigned activeTriangles) const
+    {
+        if (activeTriangles == 0) {
+            return -1.f;
+        }
+        float score = cachePosition >= 0 ? Cache[cachePosition] : 0.f;
+        // Вершины с немногими оставшимися треугольниками стоит добить, пока они в кэше
+        score += activeTriangles < VALENCE_TABLE_SIZE ? Valence[activeTriangles]
+            : VALENCE_BOOST_SCALE * std::pow(float(activeTriangles), -VALENCE_BOOST_POWER);
+        return score;
+    }
+};
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<std::uint32_t>& indices, size_t vertexCount, unsigned cacheSize)
+{
+    VertexCacheStats stats;
+    // Меньше одного треугольника - ACMR делить не на что
+    if (indices.size() < 3 || vertexCount == 0) {
+        return stats;
+    }
+
+    // FIFO через метки времени: вершина в кэше, если с ее загрузки прошло не больше cacheSize промахов
+    std::vector<std::uint32_t> loadedAt(vertexCount, 0);
+    std::uint32_t time = cacheSize + 1;
+    size_t misses = 0;
+    for (std::uint32_t index : indices) {
+        if (time - loadedAt[index] > cacheSize) {
+            loadedAt[index] = time++;
+            ++misses;
+        }
+    }
+
+    stats.Acmr = float(misses) / float(indices.size() / 3);
+    stats.Atvr = float(misses) / float(vertexCount);
+    return stats;
+}
+
+void MeshOptimizer::OptimizeVertexCache(IndexedMesh& mesh)
+{
+    OptimizeVertexCache(mesh.Indices, mesh.VertexCount());
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<std::uint32_t>& indices, size_t vertexCount)
+{
+    static const ForsythScores scores;
+
+    const size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // Списки треугольников каждой вершины, из них вычеркиваются уже выданные
+    std::vector<std::uint32_t> activeCount(vertexCount, 0);
+    for (std::uint32_t index : indices) {
+        ++activeCount[index];
+    }
+    std::vector<std::uint32_t> firstTriangle(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        firstTriangle[v + 1] = firstTriangle[v] + activeCount[v];
+    }
+    std::vector<std::uint32_t> adjacency(indices.size());
+    std::vector<std::uint32_t> filled(vertexCount, 0);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        const std::uint32_t v = indices[i];
+        adjacency[firstTriangle[v] + filled[v]++] = static_cast<std::uint32_t>(i / 3);
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        vertexScore[v] = scores.Vertex(-1, activeCount[v]);
+    }
+
+    std::vector<float> triangleScore(triangleCount);
+    std::vector<bool> emitted(triangleCount, false);
+    std::uint32_t best = 0;
+    for (size_t t = 0; t < triangleCount; ++t) {
+        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+        if (triangleScore[t] > triangleScore[best]) {
+            best = static_cast<std::uint32_t>(t);
+        }
+    }
+
+    std::vector<std::uint32_t> cache;
+    std::vector<std::uint32_t> nextCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+    std::vector<std::uint32_t> result;
+    result.reserve(indices.size());
+    size_t cursor = 0;
+
+    for (size_t step = 0; step < triangleCount; ++step) {
+        if (best == NO_TRIANGLE) {
+            // В кэше не осталось вершин с треугольниками - берем следующий невыданный
+            while (emitted[cursor]) {
+                ++cursor;
+            }
+            best = static_cast<std::uint32_t>(cursor);
+        }
+
+        const std::uint32_t* corners = &indices[best * 3];
+        emitted[best] = true;
+        result.insert(result.end(), corners, corners + 3);
+
+        nextCache.clear();
+        for (int c = 0; c < 3; ++c) {
+            const std::uint32_t v = corners[c];
+            // Вычеркиваем треугольник из списка вершины
+            std::uint32_t* list = &adjacency[firstTriangle[v]];
+            for (std::uint32_t i = 0; i < activeCount[v]; ++i) {
+                if (list[i] == best) {
+                    list[i] = list[activeCount[v] - 1];
+                    --activeCount[v];
+                    break;
+                }
+            }
+            if (std::find(nextCache.begin(), nextCache.end(), v) == nextCache.end()) {
+                nextCache.push_back(v);
+            }
+        }
+        for (std::uint32_t v : cache) {
+            if (std::find(nextCache.begin(), nextCache.end(), v) == nextCache.end()) {
+                nextCache.push_back(v);
+            }
+        }
+
+        // Новые позиции в кэше и оценки вершин; выпавшие из кэша тоже пересчитываются
+        for (size_t i = 0; i < nextCache.size(); ++i) {
+            const std::uint32_t v = nextCache[i];
+            cachePosition[v] = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+            vertexScore[v] = scores.Vertex(cachePosition[v], activeCount[v]);
+        }
+
+        // Лучший треугольник ищется только среди соседей тронутых вершин
+        best = NO_TRIANGLE;
+        float bestScore = -1.f;
+        for (std::uint32_t v : nextCache) {
+            const std::uint32_t* list = &adjacency[firstTriangle[v]];
+            for (std::uint32_t i = 0; i < activeCount[v]; ++i) {
+                const std::uint32_t t = list[i];
+                const float score = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+                triangleScore[t] = score;
+                if (score > bestScore) {
+                    bestScore = score;
+                    best = t;
+                }
+            }
+        }
+
+        if (nextCache.size() > FORSYTH_CACHE_SIZE) {
+            nextCache.resize(FORSYTH_CACHE_SIZE);
+        }
+        cache.swap(nextCache);
+    }
+
+    indices.swap(result);
+}
+
+static void ReadPosition(const IndexedMesh& mesh, std::uint32_t vertex, size_t positionOffset, float position[3])
+{
+    memcpy(position, mesh.Vertices.data() + vertex * mesh.VertexStride + positionOffset, 3 * sizeof(float));
+}
+
+void MeshOptimizer::OptimizeOverdraw(IndexedMesh& mesh, size_t positionOffset)
+{
+    const size_t triangleCount = mesh.Indices.size() / 3;
+    if (triangleCount == 0 || mesh.VertexStride < positionOffset + 3 * sizeof(float)) {
+        return;
+    }
+
+    // Границы кластеров - треугольники, промахнувшиеся по всем трем вершинам:
+    // кэш там и так пуст, перестановка кластеров его почти не портит
+    std::vector<size_t> clusterStart;
+    {
+        std::vector<std::uint32_t> loadedAt(mesh.VertexCount(), 0);
+        std::uint32_t time = ANALYZE_CACHE_SIZE + 1;
+        for (size_t t = 0; t < triangleCount; ++t) {
+            int misses = 0;
+            for (int c = 0; c < 3; ++c) {
+                const std::uint32_t v = mesh.Indices[t * 3 + c];
+                if (time - loadedAt[v] > ANALYZE_CACHE_SIZE) {
+                    loadedAt[v] = time++;
+                    ++misses;
+                }
+            }
+            if (t == 0 || misses == 3) {
+                clusterStart.push_back(t);
+            }
+        }
+    }
+    const size_t clusterCount = clusterStart.size();
+    clusterStart.push_back(triangleCount);
+    if (clusterCount < 2) {
+        return;
+    }
+
+    // Центр сетки
+    float meshCenter[3] = { 0.f, 0.f, 0.f };
+    for (size_t v = 0; v < mesh.VertexCount(); ++v) {
+        float position[3];
+        ReadPosition(mesh, static_cast<std::uint32_t>(v), positionOffset, position);
+        for (int k = 0; k < 3; ++k) {
+            meshCenter[k] += position[k];
+        }
+    }
+    for (int k = 0; k < 3; ++k) {
+        meshCenter[k] /= float(mesh.VertexCount());
+    }
+
+    // Ключ кластера - насколько он смотрит наружу: скалярное произведение нормали
+    // кластера и направления от центра сетки к центру кластера. Внешние рисуются первыми
+    // и закрывают внутренние - меньше перерисовки.
+    std::vector<float> keys(clusterCount);
+    for (size_t cluster = 0; cluster < clusterCount; ++cluster) {
+        float center[3] = { 0.f, 0.f, 0.f };
+        float normal[3] = { 0.f, 0.f, 0.f };
+        float totalArea = 0.f;
+        for (size_t t = clusterStart[cluster]; t < clusterStart[cluster + 1]; ++t) {
+            float p[3][3];
+            for (int c = 0; c < 3; ++c) {
+                ReadPosition(mesh, mesh.Indices[t * 3 + c], positionOffset, p[c]);
+            }
+            const float e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+            const float e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+            // Ненормированная нормаль - вклад треугольника пропорционален площади
+            const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            const float area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            totalArea += area;
+            for (int k = 0; k < 3; ++k) {
+                normal[k] += n[k];
+                center[k] += area * (p[0][k] + p[1][k] + p[2][k]) / 3.f;
+            }
+        }
+        const float length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        if (length == 0.f || totalArea == 0.f) {
+            keys[cluster] = 0.f;
+            continue;
+        }
+        float key = 0.f;
+        for (int k = 0; k < 3; ++k) {
+            key += (center[k] / totalArea - meshCenter[k]) * normal[k] / length;
+        }
+        keys[cluster] = key;
+    }
+
+    std::vector<std::uint32_t> order(clusterCount);
+    for (size_t i = 0; i < clusterCount; ++i) {
+        order[i] = static_cast<std::uint32_t>(i);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](std::uint32_t a, std::uint32_t b) {
+        return keys[a] > keys[b];
+    });
+
+    std::vector<std::uint32_t> result;
+    result.reserve(mesh.Indices.size());
+    for (std::uint32_t cluster : order) {
+        result.insert(result.end(), mesh.Indices.begin() + clusterStart[cluster] * 3, mesh.Indices.begin() + clusterStart[cluster + 1] * 3);
+    }
+    mesh.Indices.swap(result);
+}
+
+void MeshOptimizer::OptimizeVertexFetch(IndexedMesh& mesh)
+{
+    const std::uint32_t UNUSED = ~0u;
+    std::vector<std::uint32_t> remap(mesh.VertexCount(), UNUSED);
+    std::vector<std::uint8_t> vertices;
+    vertices.reserve(mesh.Vertices.size());
+
+    // Вершины ложатся в буфер в порядке первого обращения - чтение идет почти подряд.
+    // Неиспользуемые вершины при этом выбрасываются.
+    std::uint32_t next = 0;
+    for (std::uint32_t& index : mesh.Indices) {
+        if (remap[index] == UNUSED) {
+            remap[index] = next++;
+            const std::uint8_t* vertex = mesh.Vertices.data() + index * mesh.VertexStride;
+            vertices.insert(vertices.end(), vertex, vertex + mesh.VertexStride);
+        }
+        index = remap[index];
+    }
+    mesh.Vertices.swap(vertices);
+}
+
+MeshOptimizeStats MeshOptimizer::Optimize(IndexedMesh& mesh, size_t positionOffset)
+{
+    MeshOptimizeStats stats;
+    const auto start = std::chrono::steady_clock::now();
+
+    stats.Before = AnalyzeVertexCache(mesh.Indices, mesh.VertexCount());
+    OptimizeVertexCache(mesh);
+    OptimizeOverdraw(mesh, positionOffset);
+    OptimizeVertexFetch(mesh);
+    stats.After = AnalyzeVertexCache(mesh.Indices, mesh.VertexCount());
+
+    stats.Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+void MeshOptimizer::OptimizeAll(const std::vector<IndexedMesh*>& meshes, size_t positionOffset, std::vector<MeshOptimizeStats>* stats)
+{
+    if (stats != nullptr) {
+        stats->assign(meshes.size(), MeshOptimizeStats());
+    }
+    ThreadPool::Instance().ParallelFor(meshes.size(), [&](size_t i) {
+        const MeshOptimizeStats result = Optimize(*meshes[i], positionOffset);
+        if (stats != nullptr) {
+            (*stats)[i] = result;
+        }
+    });
+}
+
+void MeshOptimizer::PrintReport(const char* name, const MeshOptimizeStats& stats)
+{
+    std::cout << "MeshOptimizer: " << name
+        << " ACMR=" << stats.Before.Acmr << "->" << stats.After.Acmr
+        << " ATVR=" << stats.Before.Atvr << "->" << stats.After.Atvr
+        << " time=" << stats.Milliseconds << "ms" << std::endl;
+}
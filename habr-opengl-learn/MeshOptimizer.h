@@ -0,0 +1,47 @@
+#pragma once
+#include "MeshIndexer.h"
+#include <vector>
+
+// Метрики кэша вершин после трансформации, моделируется FIFO заданного размера.
+// ACMR - промахов на треугольник (от 0.5 в идеале до 3), ATVR - промахов на вершину (в идеале 1).
+struct VertexCacheStats {
+    float Acmr = 0.f;
+    float Atvr = 0.f;
+};
+
+struct MeshOptimizeStats {
+    VertexCacheStats Before;
+    VertexCacheStats After;
+    double Milliseconds = 0.0;
+};
+
+// Оптимизация порядка треугольников и вершин индексированной сетки:
+//   1. кэш вершин - жадный алгоритм Форсайта (Linear-Speed Vertex Cache Optimisation);
+//   2. перерисовка - порядок разбивается на кластеры по границам, где кэш и так сбрасывается,
+//      кластеры сортируются снаружи внутрь (Sander et al., Fast Triangle Reordering);
+//   3. выборка вершин - вершины переставляются в порядке первого использования.
+// Работает только с CPU-данными, поэтому годится и офлайн, и при загрузке в фоновых потоках.
+namespace MeshOptimizer {
+    // Размер FIFO для метрик - типичный для современных GPU
+    const unsigned ANALYZE_CACHE_SIZE = 16;
+
+    VertexCacheStats AnalyzeVertexCache(const std::vector<std::uint32_t>& indices, size_t vertexCount, unsigned cacheSize = ANALYZE_CACHE_SIZE);
+
+    void OptimizeVertexCache(IndexedMesh& mesh);
+
+    // То же для отдельного списка индексов над вершинами сетки, например уровня LOD
+    void OptimizeVertexCache(std::vector<std::uint32_t>& indices, size_t vertexCount);
+
+    // positionOffset - смещение float3 позиции внутри вершины в байтах
+    void OptimizeOverdraw(IndexedMesh& mesh, size_t positionOffset = 0);
+
+    void OptimizeVertexFetch(IndexedMesh& mesh);
+
+    // Все три прохода по порядку
+    MeshOptimizeStats Optimize(IndexedMesh& mesh, size_t positionOffset = 0);
+
+    // Каждая сетка - отдельная задача в ThreadPool. stats, если задан, заполняется по сеткам.
+    void OptimizeAll(const std::vector<IndexedMesh*>& meshes, size_t positionOffset = 0, std::vector<MeshOptimizeStats>* stats = nullptr);
+
+    void PrintReport(const char* name, const MeshOptimizeStats& stats);
+}
@@ -0,0 +1,301 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+// Треугольник после стягивания не должен повернуться сильнее, чем на ~75 градусов
+static const float MAX_NORMAL_ROTATION_COS = 0.25f;
+
+// Симметричная матрица 4x4 квадрики: A (3x3), b, c и суммарный вес (площадь)
+struct Quadric {
+    double A00 = 0, A11 = 0, A22 = 0, A01 = 0, A02 = 0, A12 = 0;
+    double B0 = 0, B1 = 0, B2 = 0;
+    double C = 0;
+    double Weight = 0;
+
+    void AddPlane(const double normal[3], double distance, double weight)
+    {
+        A00 += weight * normal[0] * normal[0];
+        A11 += weight * normal[1] * normal[1];
+        A22 += weight * normal[2] * normal[2];
+        A01 += weight * normal[0] * normal[1];
+        A02 += weight * normal[0] * normal[2];
+        A12 += weight * normal[1] * normal[2];
+        B0 += weight * normal[0] * distance;
+        B1 += weight * normal[1] * distance;
+        B2 += weight * normal[2] * distance;
+        C += weight * distance * distance;
+        Weight += weight;
+    }
+
+    void Add(const Quadric& other)
+    {
+        A00 += other.A00; A11 += other.A11; A22 += other.A22;
+        A01 += other.A01; A02 += other.A02; A12 += other.A12;
+        B0 += other.B0; B1 += other.B1; B2 += other.B2;
+        C += other.C;
+        Weight += other.Weight;
+    }
+
+    // Взвешенная сумма квадратов расстояний до плоскостей
+    double Evaluate(const float p[3]) const
+    {
+        const double x = p[0], y = p[1], z = p[2];
+        const double value = A00 * x * x + A11 * y * y + A22 * z * z
+            + 2 * (A01 * x * y + A02 * x * z + A12 * y * z)
+            + 2 * (B0 * x + B1 * y + B2 * z) + C;
+        return std::max(value, 0.0);
+    }
+};
+
+struct Collapse {
+    std::uint32_t From;
+    std::uint32_t To;
+    // Квадрат расстояния, уже нормированный на площадь
+    float Error;
+};
+
+static void Cross(const float a[3], const float b[3], const float c[3], float normal[3])
+{
+    const float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+    const float e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+    normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+static float Dot(const float a[3], const float b[3])
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+// Одинаковые позиции -> одна "позиционная" вершина, по ней ищутся швы и границы
+static std::vector<std::uint32_t> BuildPositionRemap(const std::vector<float>& positions, size_t vertexCount)
+{
+    struct PositionHash {
+        size_t operator()(const std::array<std::uint32_t, 3>& p) const
+        {
+            return (p[0] * 73856093u) ^ (p[1] * 19349663u) ^ (p[2] * 83492791u);
+        }
+    };
+
+    std::unordered_map<std::array<std::uint32_t, 3>, std::uint32_t, PositionHash> first;
+    first.reserve(vertexCount);
+    std::vector<std::uint32_t> remap(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        std::array<std::uint32_t, 3> key;
+        memcpy(key.data(), &positions[v * 3], sizeof(key));
+        remap[v] = first.emplace(key, static_cast<std::uint32_t>(v)).first->second;
+    }
+    return remap;
+}
+
+// Вершины, которые нельзя двигать: шов или открытая граница
+static std::vector<bool> FindLockedVertices(const std::vector<std::uint32_t>& indices, const std::vector<std::uint32_t>& positionRemap)
+{
+    const size_t vertexCount = positionRemap.size();
+    std::vector<bool> locked(vertexCount, false);
+
+    std::vector<std::uint32_t> wedges(vertexCount, 0);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        ++wedges[positionRemap[v]];
+    }
+
+    // Ребро открытое, если нет встречного ребра того же места поверхности
+    std::unordered_map<std::uint64_t, std::uint32_t> edges;
+    edges.reserve(indices.size());
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        for (int e = 0; e < 3; ++e) {
+            const std::uint64_t a = positionRemap[indices[i + e]];
+            const std::uint64_t b = positionRemap[indices[i + (e + 1) % 3]];
+            ++edges[(a << 32) | b];
+        }
+    }
+
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        for (int e = 0; e < 3; ++e) {
+            const std::uint32_t va = indices[i + e];
+            const std::uint32_t vb = indices[i + (e + 1) % 3];
+            const std::uint64_t a = positionRemap[va];
+            const std::uint64_t b = positionRemap[vb];
+            if (edges.find((b << 32) | a) == edges.end()) {
+                locked[va] = true;
+                locked[vb] = true;
+            }
+        }
+    }
+
+    for (size_t v = 0; v < vertexCount; ++v) {
+        if (wedges[positionRemap[v]] > 1) {
+            locked[v] = true;
+        }
+    }
+    return locked;
+}
+
+// Не переворачивает ли стягивание from -> to треугольники вокруг from
+static bool IsCollapseValid(const std::vector<std::uint32_t>& indices, const std::vector<std::uint32_t>& firstTriangle,
+    const std::vector<std::uint32_t>& adjacency, const std::vector<float>& positions, std::uint32_t from, std::uint32_t to)
+{
+    for (std::uint32_t k = firstTriangle[from]; k < firstTriangle[from + 1]; ++k) {
+        const std::uint32_t* triangle = &indices[adjacency[k] * 3];
+        if (triangle[0] == to || triangle[1] == to || triangle[2] == to) {
+            // Этот треугольник исчезнет
+            continue;
+        }
+
+        const float* before[3];
+        const float* after[3];
+        for (int i = 0; i < 3; ++i) {
+            before[i] = &positions[triangle[i] * 3];
+            after[i] = triangle[i] == from ? &positions[to * 3] : before[i];
+        }
+        float normalBefore[3];
+        float normalAfter[3];
+        Cross(before[0], before[1], before[2], normalBefore);
+        Cross(after[0], after[1], after[2], normalAfter);
+        const float lengths = std::sqrt(Dot(normalBefore, normalBefore) * Dot(normalAfter, normalAfter));
+        if (Dot(normalBefore, normalAfter) <= MAX_NORMAL_ROTATION_COS * lengths) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<std::uint32_t> MeshSimplifier::Simplify(const IndexedMesh& mesh, const std::vector<std::uint32_t>& indices, size_t targetIndexCount,
+    size_t positionOffset, float* error)
+{
+    std::vector<std::uint32_t> result = indices;
+    float maxError = 0.f;
+    const size_t vertexCount = mesh.VertexCount();
+    if (vertexCount == 0 || mesh.VertexStride < positionOffset + 3 * sizeof(float) || result.size() <= targetIndexCount) {
+        if (error != nullptr) {
+            *error = 0.f;
+        }
+        return result;
+    }
+
+    std::vector<float> positions(vertexCount * 3);
+    for (size_t v = 0; v < vertexCount; ++v) {
+        memcpy(&positions[v * 3], mesh.Vertices.data() + v * mesh.VertexStride + positionOffset, 3 * sizeof(float));
+    }
+
+    const std::vector<std::uint32_t> positionRemap = BuildPositionRemap(positions, vertexCount);
+    const std::vector<bool> locked = FindLockedVertices(result, positionRemap);
+
+    // Плоскость каждого треугольника с весом по площади - в квадрики его вершин
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < result.size(); i += 3) {
+        float normal[3];
+        Cross(&positions[result[i] * 3], &positions[result[i + 1] * 3], &positions[result[i + 2] * 3], normal);
+        const double length = std::sqrt(double(Dot(normal, normal)));
+        if (length == 0.0) {
+            continue;
+        }
+        const double unit[3] = { normal[0] / length, normal[1] / length, normal[2] / length };
+        const float* p = &positions[result[i] * 3];
+        const double distance = -(unit[0] * p[0] + unit[1] * p[1] + unit[2] * p[2]);
+        for (int k = 0; k < 3; ++k) {
+            quadrics[result[i + k]].AddPlane(unit, distance, length * 0.5);
+        }
+    }
+
+    std::vector<std::uint32_t> remap(vertexCount);
+    std::vector<std::uint32_t> firstTriangle(vertexCount + 1);
+    std::vector<std::uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<bool> touched(vertexCount);
+
+    // Проходы: ребра сортируются по ошибке, дешевые стягиваются, пока не наберется нужное число треугольников.
+    // Вершина участвует не больше чем в одном стягивании за проход - соседние стягивания не мешают друг другу.
+    while (result.size() > targetIndexCount) {
+        std::fill(firstTriangle.begin(), firstTriangle.end(), 0);
+        for (std::uint32_t index : result) {
+            ++firstTriangle[index + 1];
+        }
+        for (size_t v = 0; v < vertexCount; ++v) {
+            firstTriangle[v + 1] += firstTriangle[v];
+        }
+        adjacency.resize(result.size());
+        std::vector<std::uint32_t> filled(firstTriangle.begin(), firstTriangle.end() - 1);
+        for (size_t i = 0; i < result.size(); ++i) {
+            adjacency[filled[result[i]]++] = static_cast<std::uint32_t>(i / 3);
+        }
+
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i += 3) {
+            for (int e = 0; e < 3; ++e) {
+                const std::uint32_t a = result[i + e];
+                const std::uint32_t b = result[i + (e + 1) % 3];
+                for (int direction = 0; direction < 2; ++direction) {
+                    const std::uint32_t from = direction == 0 ? a : b;
+                    const std::uint32_t to = direction == 0 ? b : a;
+                    if (locked[from]) {
+                        continue;
+                    }
+                    Quadric merged = quadrics[from];
+                    merged.Add(quadrics[to]);
+                    const double cost = merged.Weight > 0 ? merged.Evaluate(&positions[to * 3]) / merged.Weight : 0.0;
+                    collapses.push_back({ from, to, static_cast<float>(cost) });
+                }
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+            return a.Error < b.Error;
+        });
+
+        for (size_t v = 0; v < vertexCount; ++v) {
+            remap[v] = static_cast<std::uint32_t>(v);
+        }
+        std::fill(touched.begin(), touched.end(), false);
+
+        // Каждое стягивание убирает примерно два треугольника
+        const size_t trianglesToRemove = (result.size() - targetIndexCount) / 3;
+        size_t removed = 0;
+        for (const Collapse& collapse : collapses) {
+            if (removed >= trianglesToRemove) {
+                break;
+            }
+            if (touched[collapse.From] || touched[collapse.To]) {
+                continue;
+            }
+            if (!IsCollapseValid(result, firstTriangle, adjacency, positions, collapse.From, collapse.To)) {
+                continue;
+            }
+
+            remap[collapse.From] = collapse.To;
+            quadrics[collapse.To].Add(quadrics[collapse.From]);
+            maxError = std::max(maxError, collapse.Error);
+            // Все соседи from меняют треугольники - до конца прохода их не трогаем
+            for (std::uint32_t k = firstTriangle[collapse.From]; k < firstTriangle[collapse.From + 1]; ++k) {
+                const std::uint32_t* triangle = &result[adjacency[k] * 3];
+                touched[triangle[0]] = touched[triangle[1]] = touched[triangle[2]] = true;
+            }
+            removed += 2;
+        }
+        if (removed == 0) {
+            break;
+        }
+
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            const std::uint32_t a = remap[result[i]];
+            const std::uint32_t b = remap[result[i + 1]];
+            const std::uint32_t c = remap[result[i + 2]];
+            if (a == b || b == c || a == c) {
+                continue;
+            }
+            result[write++] = a;
+            result[write++] = b;
+            result[write++] = c;
+        }
+        result.resize(write);
+    }
+
+    if (error != nullptr) {
+        *error = std::sqrt(maxError);
+    }
+    return result;
+}
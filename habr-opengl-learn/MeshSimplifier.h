@@ -0,0 +1,16 @@
+#pragma once
+#include "MeshIndexer.h"
+#include <vector>
+
+// Упрощение сетки стягиванием ребер по квадрикам ошибки (Garland, Heckbert - Surface Simplification
+// Using Quadric Error Metrics). Вершина стягивается в соседнюю существующую вершину, новых вершин
+// не появляется: все уровни LOD ссылаются на один и тот же массив вершин.
+// Вершины на открытой границе и на швах (одна позиция - несколько вершин с разными UV) не двигаются,
+// так что у сетки, где все вершины на швах (куб), упрощать нечего.
+namespace MeshSimplifier {
+    // indices - треугольники над вершинами mesh, targetIndexCount - сколько индексов оставить.
+    // Результат может быть больше цели, если дальше упрощать нельзя без переворота треугольников.
+    // error, если задан, - наибольшее отклонение от исходной поверхности в единицах позиции.
+    std::vector<std::uint32_t> Simplify(const IndexedMesh& mesh, const std::vector<std::uint32_t>& indices, size_t targetIndexCount,
+        size_t positionOffset = 0, float* error = nullptr);
+}
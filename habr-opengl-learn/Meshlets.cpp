@@ -0,0 +1,253 @@
+#include "Meshlets.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+static const std::uint8_t NOT_IN_MESHLET = 0xFF;
+
+static void ReadPosition(const IndexedMesh& mesh, std::uint32_t vertex, size_t positionOffset, float position[3])
+{
+    memcpy(position, mesh.Vertices.data() + vertex * mesh.VertexStride + positionOffset, 3 * sizeof(float));
+}
+
+// Сфера и конус нормалей законченного кластера
+static void ComputeBounds(const IndexedMesh& mesh, size_t positionOffset, MeshletMesh& result, const Meshlet& meshlet)
+{
+    float low[3] = { INFINITY, INFINITY, INFINITY };
+    float high[3] = { -INFINITY, -INFINITY, -INFINITY };
+    for (std::uint32_t i = 0; i < meshlet.VertexCount; ++i) {
+        float p[3];
+        ReadPosition(mesh, result.Vertices[meshlet.VertexOffset + i], positionOffset, p);
+        for (int k = 0; k < 3; ++k) {
+            low[k] = std::min(low[k], p[k]);
+            high[k] = std::max(high[k], p[k]);
+        }
+    }
+    const float center[3] = { (low[0] + high[0]) * 0.5f, (low[1] + high[1]) * 0.5f, (low[2] + high[2]) * 0.5f };
+    float radius = 0.f;
+    for (std::uint32_t i = 0; i < meshlet.VertexCount; ++i) {
+        float p[3];
+        ReadPosition(mesh, result.Vertices[meshlet.VertexOffset + i], positionOffset, p);
+        const float d[3] = { p[0] - center[0], p[1] - center[1], p[2] - center[2] };
+        radius = std::max(radius, std::sqrt(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]));
+    }
+
+    // Ось конуса - средняя нормаль, угол - по самой отклоненной
+    std::vector<float> normals;
+    normals.reserve(meshlet.TriangleCount * 3);
+    float axis[3] = { 0.f, 0.f, 0.f };
+    for (std::uint32_t t = 0; t < meshlet.TriangleCount; ++t) {
+        float p[3][3];
+        for (int k = 0; k < 3; ++k) {
+            const std::uint8_t local = result.Triangles[(meshlet.TriangleOffset + t) * 3 + k];
+            ReadPosition(mesh, result.Vertices[meshlet.VertexOffset + local], positionOffset, p[k]);
+        }
+        const float e1[3] = { p[1][0] - p[0][0], p[1][1] - p[0][1], p[1][2] - p[0][2] };
+        const float e2[3] = { p[2][0] - p[0][0], p[2][1] - p[0][1], p[2][2] - p[0][2] };
+        float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+        const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        if (length == 0.f) {
+            continue;
+        }
+        for (int k = 0; k < 3; ++k) {
+            n[k] /= length;
+            axis[k] += n[k];
+            normals.push_back(n[k]);
+        }
+    }
+
+    float cutoff = 1.f;
+    const float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    if (axisLength > 0.f && !normals.empty()) {
+        for (float& a : axis) {
+            a /= axisLength;
+        }
+        float minDot = 1.f;
+        for (size_t i = 0; i < normals.size(); i += 3) {
+            minDot = std::min(minDot, normals[i] * axis[0] + normals[i + 1] * axis[1] + normals[i + 2] * axis[2]);
+        }
+        // Конус шире полусферы не отсекает ничего; иначе cutoff = sin угла раствора
+        cutoff = minDot <= 0.f ? 1.f : std::sqrt(1.f - minDot * minDot);
+    }
+
+    result.CenterX.push_back(center[0]);
+    result.CenterY.push_back(center[1]);
+    result.CenterZ.push_back(center[2]);
+    result.Radius.push_back(radius);
+    result.ConeX.push_back(axis[0]);
+    result.ConeY.push_back(axis[1]);
+    result.ConeZ.push_back(axis[2]);
+    result.ConeCutoff.push_back(cutoff);
+}
+
+MeshletMesh MeshletBuilder::Build(const IndexedMesh& mesh, size_t positionOffset)
+{
+    MeshletMesh result;
+    const size_t vertexCount = mesh.VertexCount();
+    if (mesh.Indices.empty() || mesh.VertexStride < positionOffset + 3 * sizeof(float)) {
+        return result;
+    }
+
+    // Номер вершины внутри текущего кластера
+    std::vector<std::uint8_t> localIndex(vertexCount, NOT_IN_MESHLET);
+    Meshlet meshlet;
+
+    auto finish = [&]() {
+        if (meshlet.TriangleCount == 0) {
+            return;
+        }
+        for (std::uint32_t i = 0; i < meshlet.VertexCount; ++i) {
+            localIndex[result.Vertices[meshlet.VertexOffset + i]] = NOT_IN_MESHLET;
+        }
+        ComputeBounds(mesh, positionOffset, result, meshlet);
+        result.Meshlets.push_back(meshlet);
+        meshlet = Meshlet();
+        meshlet.VertexOffset = static_cast<std::uint32_t>(result.Vertices.size());
+        meshlet.TriangleOffset = static_cast<std::uint32_t>(result.Triangles.size() / 3);
+    };
+
+    for (size_t i = 0; i < mesh.Indices.size(); i += 3) {
+        const std::uint32_t* triangle = &mesh.Indices[i];
+        unsigned newVertices = 0;
+        for (int k = 0; k < 3; ++k) {
+            newVertices += localIndex[triangle[k]] == NOT_IN_MESHLET ? 1 : 0;
+        }
+        if (meshlet.VertexCount + newVertices > MAX_VERTICES || meshlet.TriangleCount + 1 > MAX_TRIANGLES) {
+            finish();
+        }
+
+        for (int k = 0; k < 3; ++k) {
+            std::uint8_t& local = localIndex[triangle[k]];
+            if (local == NOT_IN_MESHLET) {
+                local = static_cast<std::uint8_t>(meshlet.VertexCount++);
+                result.Vertices.push_back(triangle[k]);
+            }
+            result.Triangles.push_back(local);
+        }
+        ++meshlet.TriangleCount;
+    }
+    finish();
+    return result;
+}
+
+void MeshletBuilder::PrintReport(const char* name, const MeshletMesh& meshlets)
+{
+    const size_t count = meshlets.Meshlets.size();
+    std::cout << "MeshletBuilder: " << name
+        << " meshlets=" << count
+        << " triangles=" << meshlets.TriangleCount()
+        << " avgVertices=" << (count ? float(meshlets.Vertices.size()) / count : 0.f)
+        << " avgTriangles=" << (count ? float(meshlets.TriangleCount()) / count : 0.f)
+        << std::endl;
+}
+
+// Плоскости пирамиды видимости из матрицы (Gribb, Hartmann), нормированные: внутри - dot >= 0
+static void ExtractFrustumPlanes(const glm::mat4& m, float planes[6][4])
+{
+    for (int i = 0; i < 3; ++i) {
+        for (int side = 0; side < 2; ++side) {
+            float* plane = planes[i * 2 + side];
+            const float sign = side == 0 ? 1.f : -1.f;
+            for (int c = 0; c < 4; ++c) {
+                // glm хранит по столбцам: m[c][r]
+                plane[c] = m[c][3] + sign * m[c][i];
+            }
+            const float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+            for (int c = 0; c < 4; ++c) {
+                plane[c] /= length;
+            }
+        }
+    }
+}
+
+MeshletCulling::Frustum::Frustum(const glm::mat4& viewProjection)
+{
+    ExtractFrustumPlanes(viewProjection, Planes);
+}
+
+bool MeshletCulling::Frustum::Contains(const glm::vec3& center, float radius) const
+{
+    for (int p = 0; p < 6; ++p) {
+        if (Planes[p][0] * center.x + Planes[p][1] * center.y + Planes[p][2] * center.z + Planes[p][3] < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void MeshletCulling::Cull(const MeshletMesh& meshlets, const glm::mat4& modelViewProjection, const glm::vec3& cameraPosition,
+    std::vector<std::uint32_t>& indices, MeshletCullStats* stats)
+{
+    const auto start = std::chrono::steady_clock::now();
+    const size_t count = meshlets.Meshlets.size();
+
+    float planes[6][4];
+    ExtractFrustumPlanes(modelViewProjection, planes);
+
+    // Первый проход - без ветвлений по SoA-массивам, результат в байтовые маски
+    std::vector<std::uint8_t> inside(count);
+    std::vector<std::uint8_t> frontFacing(count);
+    const float* cx = meshlets.CenterX.data();
+    const float* cy = meshlets.CenterY.data();
+    const float* cz = meshlets.CenterZ.data();
+    const float* r = meshlets.Radius.data();
+    const float* ax = meshlets.ConeX.data();
+    const float* ay = meshlets.ConeY.data();
+    const float* az = meshlets.ConeZ.data();
+    const float* cutoff = meshlets.ConeCutoff.data();
+    const float camX = cameraPosition.x;
+    const float camY = cameraPosition.y;
+    const float camZ = cameraPosition.z;
+    for (size_t i = 0; i < count; ++i) {
+        bool visible = true;
+        for (int p = 0; p < 6; ++p) {
+            visible &= planes[p][0] * cx[i] + planes[p][1] * cy[i] + planes[p][2] * cz[i] + planes[p][3] >= -r[i];
+        }
+        inside[i] = visible;
+
+        const float dx = cx[i] - camX;
+        const float dy = cy[i] - camY;
+        const float dz = cz[i] - camZ;
+        const float distance = std::sqrt(dx * dx + dy * dy + dz * dz);
+        frontFacing[i] = dx * ax[i] + dy * ay[i] + dz * az[i] < cutoff[i] * distance + r[i];
+    }
+
+    MeshletCullStats result;
+    result.Meshlets = count;
+    result.Triangles = meshlets.TriangleCount();
+    for (size_t i = 0; i < count; ++i) {
+        const Meshlet& meshlet = meshlets.Meshlets[i];
+        if (!frontFacing[i]) {
+            result.TrianglesBackfacing += meshlet.TriangleCount;
+            continue;
+        }
+        if (!inside[i]) {
+            result.TrianglesOutside += meshlet.TriangleCount;
+            continue;
+        }
+        ++result.MeshletsVisible;
+        result.TrianglesVisible += meshlet.TriangleCount;
+
+        const std::uint32_t* vertices = &meshlets.Vertices[meshlet.VertexOffset];
+        const std::uint8_t* triangles = &meshlets.Triangles[meshlet.TriangleOffset * 3];
+        for (std::uint32_t k = 0; k < meshlet.TriangleCount * 3; ++k) {
+            indices.push_back(vertices[triangles[k]]);
+        }
+    }
+
+    result.Milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (stats != nullptr) {
+        *stats = result;
+    }
+}
+
+void MeshletCulling::PrintReport(const char* name, const MeshletCullStats& stats)
+{
+    std::cout << "MeshletCulling: " << name
+        << " meshlets=" << stats.MeshletsVisible << "/" << stats.Meshlets
+        << " triangles=" << stats.TrianglesVisible << "/" << stats.Triangles
+        << " culled=" << 100.f * stats.CulledFraction() << "%"
+        << " (backfacing=" << stats.TrianglesBackfacing << " outside=" << stats.TrianglesOutside << ")"
+        << " time=" << stats.Milliseconds << "ms" << std::endl;
+}
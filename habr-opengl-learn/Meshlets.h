@@ -0,0 +1,79 @@
+#pragma once
+#include "MeshIndexer.h"
+#include <vector>
+
+// Кластер сетки: до MAX_VERTICES вершин и MAX_TRIANGLES треугольников.
+// Вершины - индексы в сетку, треугольники - байтовые индексы в вершины кластера.
+struct Meshlet {
+    std::uint32_t VertexOffset = 0;
+    std::uint32_t VertexCount = 0;
+    std::uint32_t TriangleOffset = 0;
+    std::uint32_t TriangleCount = 0;
+};
+
+// Кластеры сетки и их границы. Границы лежат массивами по компонентам (SoA),
+// чтобы проход отсечения читал их подряд и компилятор мог его векторизовать.
+struct MeshletMesh {
+    std::vector<Meshlet> Meshlets;
+    std::vector<std::uint32_t> Vertices;
+    std::vector<std::uint8_t> Triangles;
+
+    // Ограничивающая сфера
+    std::vector<float> CenterX, CenterY, CenterZ, Radius;
+    // Конус нормалей: кластер смотрит от камеры, если
+    //   dot(center - camera, axis) >= cutoff * |center - camera| + radius
+    // cutoff = 1 - конус слишком широкий, кластер по нормалям не отсекается
+    std::vector<float> ConeX, ConeY, ConeZ, ConeCutoff;
+
+    size_t TriangleCount() const
+    {
+        return Triangles.size() / 3;
+    }
+};
+
+struct MeshletCullStats {
+    size_t Meshlets = 0;
+    size_t MeshletsVisible = 0;
+    size_t Triangles = 0;
+    size_t TrianglesVisible = 0;
+    // Из отсеченных: сколько треугольников отброшено по конусу и по пирамиде видимости
+    size_t TrianglesBackfacing = 0;
+    size_t TrianglesOutside = 0;
+    double Milliseconds = 0.0;
+
+    float CulledFraction() const
+    {
+        return Triangles == 0 ? 0.f : 1.f - float(TrianglesVisible) / Triangles;
+    }
+};
+
+namespace MeshletBuilder {
+    const unsigned MAX_VERTICES = 64;
+    const unsigned MAX_TRIANGLES = 124;
+
+    // Треугольники идут в кластеры по порядку индексов, поэтому сетку стоит сначала прогнать
+    // через MeshOptimizer: порядок под кэш вершин дает компактные кластеры.
+    MeshletMesh Build(const IndexedMesh& mesh, size_t positionOffset = 0);
+
+    void PrintReport(const char* name, const MeshletMesh& meshlets);
+}
+
+namespace MeshletCulling {
+    // Плоскости пирамиды видимости - для проверки целых объектов по ограничивающей сфере
+    struct Frustum {
+        float Planes[6][4];
+
+        explicit Frustum(const glm::mat4& viewProjection);
+
+        // Сфера хотя бы частично внутри
+        bool Contains(const glm::vec3& center, float radius) const;
+    };
+
+    // Все в координатах модели: modelViewProjection - полная матрица отрисовки,
+    // cameraPosition - камера, переведенная в пространство модели.
+    // Индексы видимых кластеров дописываются в indices в исходной нумерации вершин - готовый поток для glDrawElements.
+    void Cull(const MeshletMesh& meshlets, const glm::mat4& modelViewProjection, const glm::vec3& cameraPosition,
+        std::vector<std::uint32_t>& indices, MeshletCullStats* stats = nullptr);
+
+    void PrintReport(const char* name, const MeshletCullStats& stats);
+}
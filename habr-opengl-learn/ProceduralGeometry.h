@@ -0,0 +1,373 @@
+#pragma once
+#include "Common.h"
+#include "MeshIndexer.h"
+#include "VertexLayout.h"
+#include "VertexQuantizer.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <map>
+#include <vector>
+
+// Процедурная геометрия вместо массивов, переписанных руками в каждом уроке.
+// Все фигуры - индексированные, без одинаковых вершин, размером около единицы с центром в начале координат.
+//
+// Фиксированные фигуры (Quad, Cube) - constexpr, массивы вершин в нужном порядке атрибутов
+// считаются при компиляции и лежат в .rdata:
+//   static constexpr auto quad = Procedural::Quad();
+//   static constexpr auto vertices = Procedural::Interleave<VertexSemantic::Position, VertexSemantic::TexCoord>(quad);
+// Фигуры с разбиением (UVSphere, Icosphere, PlaneGrid, Torus, Cylinder) получают его параметрами шаблона
+// и строятся при загрузке. Build переводит любую фигуру в заданный VertexLayout.
+
+// Смысл атрибута: чем из GeometryVertex заполнить очередной атрибут layout
+enum class VertexSemantic {
+    Position,
+    Normal,
+    TexCoord,
+    Color,
+};
+
+struct GeometryVertex {
+    float Position[3];
+    float Normal[3];
+    float TexCoord[2];
+    float Color[3];
+};
+
+template <size_t VertexCount, size_t IndexCount>
+struct FixedMesh {
+    std::array<GeometryVertex, VertexCount> Vertices;
+    std::array<std::uint32_t, IndexCount> Indices;
+};
+
+struct ProceduralMesh {
+    std::vector<GeometryVertex> Vertices;
+    std::vector<std::uint32_t> Indices;
+};
+
+namespace Procedural {
+    constexpr size_t SemanticSize(VertexSemantic semantic)
+    {
+        return semantic == VertexSemantic::TexCoord ? 2 : 3;
+    }
+
+    constexpr const float* SemanticData(const GeometryVertex& vertex, VertexSemantic semantic)
+    {
+        return semantic == VertexSemantic::Position ? vertex.Position
+            : semantic == VertexSemantic::Normal ? vertex.Normal
+            : semantic == VertexSemantic::TexCoord ? vertex.TexCoord
+            : vertex.Color;
+    }
+
+    // Квадрат в плоскости XY, лицом к +Z. Порядок вершин и цвета углов - как в уроках 16-18:
+    // верхний правый красный, нижний правый зеленый, нижний левый синий, верхний левый желтый.
+    // Треугольники те же, но против часовой стрелки.
+    constexpr FixedMesh<4, 6> Quad()
+    {
+        return FixedMesh<4, 6>{
+            { {
+                { { 0.5f, 0.5f, 0.f }, { 0.f, 0.f, 1.f }, { 1.f, 1.f }, { 1.f, 0.f, 0.f } },
+                { { 0.5f, -0.5f, 0.f }, { 0.f, 0.f, 1.f }, { 1.f, 0.f }, { 0.f, 1.f, 0.f } },
+                { { -0.5f, -0.5f, 0.f }, { 0.f, 0.f, 1.f }, { 0.f, 0.f }, { 0.f, 0.f, 1.f } },
+                { { -0.5f, 0.5f, 0.f }, { 0.f, 0.f, 1.f }, { 0.f, 1.f }, { 1.f, 1.f, 0.f } },
+            } },
+            { { 0, 3, 1, 1, 3, 2 } },
+        };
+    }
+
+    // Куб с ребром 1: по 4 вершины на грань (у граней разные нормали и UV), текстура на каждой грани целиком
+    constexpr FixedMesh<24, 36> Cube()
+    {
+        // Нормаль и оси грани: u x v = n, тогда углы (-,-) (+,-) (+,+) (-,+) идут против часовой стрелки
+        const float faces[6][3][3] = {
+            { { 1.f, 0.f, 0.f }, { 0.f, 0.f, -1.f }, { 0.f, 1.f, 0.f } },
+            { { -1.f, 0.f, 0.f }, { 0.f, 0.f, 1.f }, { 0.f, 1.f, 0.f } },
+            { { 0.f, 1.f, 0.f }, { 1.f, 0.f, 0.f }, { 0.f, 0.f, -1.f } },
+            { { 0.f, -1.f, 0.f }, { 1.f, 0.f, 0.f }, { 0.f, 0.f, 1.f } },
+            { { 0.f, 0.f, 1.f }, { 1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f } },
+            { { 0.f, 0.f, -1.f }, { -1.f, 0.f, 0.f }, { 0.f, 1.f, 0.f } },
+        };
+        const float corners[4][2] = { { -1.f, -1.f }, { 1.f, -1.f }, { 1.f, 1.f }, { -1.f, 1.f } };
+
+        FixedMesh<24, 36> mesh{};
+        for (size_t face = 0; face < 6; ++face) {
+            for (size_t corner = 0; corner < 4; ++corner) {
+                GeometryVertex& vertex = mesh.Vertices[face * 4 + corner];
+                for (size_t k = 0; k < 3; ++k) {
+                    vertex.Position[k] = 0.5f * (faces[face][0][k] + corners[corner][0] * faces[face][1][k] + corners[corner][1] * faces[face][2][k]);
+                    vertex.Normal[k] = faces[face][0][k];
+                    vertex.Color[k] = 1.f;
+                }
+                vertex.TexCoord[0] = 0.5f * (corners[corner][0] + 1.f);
+                vertex.TexCoord[1] = 0.5f * (corners[corner][1] + 1.f);
+            }
+            const std::uint32_t first = static_cast<std::uint32_t>(face * 4);
+            const std::uint32_t quad[6] = { first, first + 1, first + 2, first + 2, first + 3, first };
+            for (size_t i = 0; i < 6; ++i) {
+                mesh.Indices[face * 6 + i] = quad[i];
+            }
+        }
+        return mesh;
+    }
+
+    // Вершины фиксированной фигуры float'ами подряд в порядке Semantics - то, что ждет FillIndexedBuffers
+    // или glBufferData с шагом из тех же атрибутов
+    template <VertexSemantic... Semantics, size_t VertexCount, size_t IndexCount>
+    constexpr std::array<GLfloat, VertexCount * (SemanticSize(Semantics) + ...)> Interleave(const FixedMesh<VertexCount, IndexCount>& mesh)
+    {
+        std::array<GLfloat, VertexCount * (SemanticSize(Semantics) + ...)> vertices{};
+        size_t cursor = 0;
+        for (size_t v = 0; v < VertexCount; ++v) {
+            for (VertexSemantic semantic : { Semantics... }) {
+                const float* data = SemanticData(mesh.Vertices[v], semantic);
+                for (size_t k = 0; k < SemanticSize(semantic); ++k) {
+                    vertices[cursor++] = data[k];
+                }
+            }
+        }
+        return vertices;
+    }
+
+    namespace Detail {
+        const float PI = 3.14159265358979f;
+
+        inline GeometryVertex MakeVertex(float x, float y, float z, float nx, float ny, float nz, float u, float v)
+        {
+            return GeometryVertex{ { x, y, z }, { nx, ny, nz }, { u, v }, { 1.f, 1.f, 1.f } };
+        }
+
+        // Четырехугольники сетки (columns + 1) x (rows + 1) вершин, начиная с first
+        inline void AddGridIndices(std::vector<std::uint32_t>& indices, std::uint32_t first, unsigned columns, unsigned rows)
+        {
+            for (unsigned r = 0; r < rows; ++r) {
+                for (unsigned c = 0; c < columns; ++c) {
+                    const std::uint32_t a = first + r * (columns + 1) + c;
+                    const std::uint32_t b = a + columns + 1;
+                    const std::uint32_t quad[6] = { a, b, a + 1, a + 1, b, b + 1 };
+                    indices.insert(indices.end(), quad, quad + 6);
+                }
+            }
+        }
+    }
+
+    // Плоскость 1x1 в XZ лицом к +Y, Columns x Rows клеток
+    template <unsigned Columns, unsigned Rows>
+    ProceduralMesh PlaneGrid()
+    {
+        static_assert(Columns >= 1 && Rows >= 1, "PlaneGrid needs at least one cell");
+        ProceduralMesh mesh;
+        mesh.Vertices.reserve((Columns + 1) * (Rows + 1));
+        mesh.Indices.reserve(Columns * Rows * 6);
+        for (unsigned r = 0; r <= Rows; ++r) {
+            for (unsigned c = 0; c <= Columns; ++c) {
+                const float u = float(c) / Columns;
+                const float v = float(r) / Rows;
+                mesh.Vertices.push_back(Detail::MakeVertex(u - 0.5f, 0.f, v - 0.5f, 0.f, 1.f, 0.f, u, 1.f - v));
+            }
+        }
+        Detail::AddGridIndices(mesh.Indices, 0, Columns, Rows);
+        return mesh;
+    }
+
+    // Сфера радиуса 0.5: Segments меридианов, Rings поясов. На шве по u вершины повторяются с u = 0 и 1,
+    // у полюсов - своя вершина на каждый треугольник, чтобы UV не съезжали.
+    template <unsigned Segments, unsigned Rings>
+    ProceduralMesh UVSphere()
+    {
+        static_assert(Segments >= 3 && Rings >= 2, "UVSphere needs at least 3 segments and 2 rings");
+        ProceduralMesh mesh;
+        mesh.Vertices.reserve(2 * Segments + (Rings - 1) * (Segments + 1));
+        mesh.Indices.reserve(Segments * (Rings - 1) * 6);
+
+        for (unsigned s = 0; s < Segments; ++s) {
+            mesh.Vertices.push_back(Detail::MakeVertex(0.f, 0.5f, 0.f, 0.f, 1.f, 0.f, (s + 0.5f) / Segments, 1.f));
+        }
+        for (unsigned r = 1; r < Rings; ++r) {
+            const float theta = Detail::PI * r / Rings;
+            for (unsigned s = 0; s <= Segments; ++s) {
+                // Последняя вершина пояса - копия первой с u = 1, позиция должна совпасть бит в бит
+                const float phi = 2.f * Detail::PI * (s % Segments) / Segments;
+                const float x = std::sin(theta) * std::cos(phi);
+                const float y = std::cos(theta);
+                const float z = -std::sin(theta) * std::sin(phi);
+                mesh.Vertices.push_back(Detail::MakeVertex(0.5f * x, 0.5f * y, 0.5f * z, x, y, z, float(s) / Segments, 1.f - float(r) / Rings));
+            }
+        }
+        const std::uint32_t south = static_cast<std::uint32_t>(mesh.Vertices.size());
+        for (unsigned s = 0; s < Segments; ++s) {
+            mesh.Vertices.push_back(Detail::MakeVertex(0.f, -0.5f, 0.f, 0.f, -1.f, 0.f, (s + 0.5f) / Segments, 0.f));
+        }
+
+        const std::uint32_t firstRing = Segments;
+        const std::uint32_t lastRing = firstRing + (Rings - 2) * (Segments + 1);
+        for (unsigned s = 0; s < Segments; ++s) {
+            const std::uint32_t caps[6] = { s, firstRing + s, firstRing + s + 1, south + s, lastRing + s + 1, lastRing + s };
+            mesh.Indices.insert(mesh.Indices.end(), caps, caps + 6);
+        }
+        Detail::AddGridIndices(mesh.Indices, firstRing, Segments, Rings - 2);
+        return mesh;
+    }
+
+    // Сфера радиуса 0.5 из икосаэдра, каждый шаг Subdivisions делит треугольник на 4.
+    // Вершины распределены равномернее, чем у UVSphere; UV - сферические, без отдельных вершин на шве.
+    template <unsigned Subdivisions>
+    ProceduralMesh Icosphere()
+    {
+        static_assert(Subdivisions <= 8, "Icosphere subdivision level is too high");
+        const float t = (1.f + std::sqrt(5.f)) * 0.5f;
+        std::vector<glm::vec3> positions = {
+            { -1.f, t, 0.f }, { 1.f, t, 0.f }, { -1.f, -t, 0.f }, { 1.f, -t, 0.f },
+            { 0.f, -1.f, t }, { 0.f, 1.f, t }, { 0.f, -1.f, -t }, { 0.f, 1.f, -t },
+            { t, 0.f, -1.f }, { t, 0.f, 1.f }, { -t, 0.f, -1.f }, { -t, 0.f, 1.f },
+        };
+        std::vector<std::uint32_t> indices = {
+            0, 11, 5, 0, 5, 1, 0, 1, 7, 0, 7, 10, 0, 10, 11,
+            1, 5, 9, 5, 11, 4, 11, 10, 2, 10, 7, 6, 7, 1, 8,
+            3, 9, 4, 3, 4, 2, 3, 2, 6, 3, 6, 8, 3, 8, 9,
+            4, 9, 5, 2, 4, 11, 6, 2, 10, 8, 6, 7, 9, 8, 1,
+        };
+        for (glm::vec3& position : positions) {
+            position = glm::normalize(position);
+        }
+
+        for (unsigned level = 0; level < Subdivisions; ++level) {
+            // Середина ребра общая для двух треугольников - ищем по паре концов
+            std::map<std::uint64_t, std::uint32_t> midpoints;
+            auto midpoint = [&positions, &midpoints](std::uint32_t a, std::uint32_t b) {
+                const std::uint64_t key = (std::uint64_t(std::min(a, b)) << 32) | std::max(a, b);
+                auto found = midpoints.find(key);
+                if (found != midpoints.end()) {
+                    return found->second;
+                }
+                const std::uint32_t index = static_cast<std::uint32_t>(positions.size());
+                positions.push_back(glm::normalize(positions[a] + positions[b]));
+                midpoints.emplace(key, index);
+                return index;
+            };
+
+            std::vector<std::uint32_t> subdivided;
+            subdivided.reserve(indices.size() * 4);
+            for (size_t i = 0; i < indices.size(); i += 3) {
+                const std::uint32_t a = indices[i];
+                const std::uint32_t b = indices[i + 1];
+                const std::uint32_t c = indices[i + 2];
+                const std::uint32_t ab = midpoint(a, b);
+                const std::uint32_t bc = midpoint(b, c);
+                const std::uint32_t ca = midpoint(c, a);
+                const std::uint32_t triangles[12] = { a, ab, ca, b, bc, ab, c, ca, bc, ab, bc, ca };
+                subdivided.insert(subdivided.end(), triangles, triangles + 12);
+            }
+            indices.swap(subdivided);
+        }
+
+        ProceduralMesh mesh;
+        mesh.Vertices.reserve(positions.size());
+        for (const glm::vec3& n : positions) {
+            const float u = 0.5f + std::atan2(-n.z, n.x) / (2.f * Detail::PI);
+            const float v = 0.5f + std::asin(n.y) / Detail::PI;
+            mesh.Vertices.push_back(Detail::MakeVertex(0.5f * n.x, 0.5f * n.y, 0.5f * n.z, n.x, n.y, n.z, u, v));
+        }
+        mesh.Indices = std::move(indices);
+        return mesh;
+    }
+
+    // Тор в плоскости XZ: радиус кольца 0.35, трубки 0.15. Segments - по кольцу, Sides - по трубке.
+    template <unsigned Segments, unsigned Sides>
+    ProceduralMesh Torus()
+    {
+        static_assert(Segments >= 3 && Sides >= 3, "Torus needs at least 3 segments and 3 sides");
+        const float ringRadius = 0.35f;
+        const float tubeRadius = 0.15f;
+        ProceduralMesh mesh;
+        mesh.Vertices.reserve((Segments + 1) * (Sides + 1));
+        mesh.Indices.reserve(Segments * Sides * 6);
+        for (unsigned side = 0; side <= Sides; ++side) {
+            const float psi = 2.f * Detail::PI * (side % Sides) / Sides;
+            for (unsigned segment = 0; segment <= Segments; ++segment) {
+                const float phi = 2.f * Detail::PI * (segment % Segments) / Segments;
+                const glm::vec3 normal(std::cos(psi) * std::cos(phi), std::sin(psi), std::cos(psi) * std::sin(phi));
+                const glm::vec3 center(ringRadius * std::cos(phi), 0.f, ringRadius * std::sin(phi));
+                const glm::vec3 position = center + tubeRadius * normal;
+                mesh.Vertices.push_back(Detail::MakeVertex(position.x, position.y, position.z, normal.x, normal.y, normal.z,
+                    float(segment) / Segments, float(side) / Sides));
+            }
+        }
+        Detail::AddGridIndices(mesh.Indices, 0, Segments, Sides);
+        return mesh;
+    }
+
+    // Цилиндр радиуса 0.5 и высоты 1 вдоль Y с крышками. У крышек свои вершины - нормали другие.
+    template <unsigned Segments>
+    ProceduralMesh Cylinder()
+    {
+        static_assert(Segments >= 3, "Cylinder needs at least 3 segments");
+        ProceduralMesh mesh;
+        mesh.Vertices.reserve(4 * (Segments + 1));
+        mesh.Indices.reserve(12 * Segments);
+
+        // Боковая поверхность: снизу вверх, шов по u
+        for (unsigned row = 0; row <= 1; ++row) {
+            for (unsigned s = 0; s <= Segments; ++s) {
+                const float phi = 2.f * Detail::PI * (s % Segments) / Segments;
+                const float x = std::cos(phi);
+                const float z = std::sin(phi);
+                mesh.Vertices.push_back(Detail::MakeVertex(0.5f * x, row - 0.5f, 0.5f * z, x, 0.f, z, float(s) / Segments, float(row)));
+            }
+        }
+        Detail::AddGridIndices(mesh.Indices, 0, Segments, 1);
+
+        // Крышки: центр и обод, веером
+        for (int cap = 0; cap < 2; ++cap) {
+            const float y = cap == 0 ? 0.5f : -0.5f;
+            const float ny = cap == 0 ? 1.f : -1.f;
+            const std::uint32_t center = static_cast<std::uint32_t>(mesh.Vertices.size());
+            mesh.Vertices.push_back(Detail::MakeVertex(0.f, y, 0.f, 0.f, ny, 0.f, 0.5f, 0.5f));
+            for (unsigned s = 0; s < Segments; ++s) {
+                const float phi = 2.f * Detail::PI * s / Segments;
+                const float x = std::cos(phi);
+                const float z = -std::sin(phi);
+                mesh.Vertices.push_back(Detail::MakeVertex(0.5f * x, y, 0.5f * z, 0.f, ny, 0.f, 0.5f + 0.5f * x, 0.5f - 0.5f * z));
+            }
+            for (unsigned s = 0; s < Segments; ++s) {
+                const std::uint32_t a = center + 1 + s;
+                const std::uint32_t b = center + 1 + (s + 1) % Segments;
+                // Обход против часовой стрелки, если смотреть со стороны нормали
+                const std::uint32_t triangle[3] = { center, cap == 0 ? a : b, cap == 0 ? b : a };
+                mesh.Indices.insert(mesh.Indices.end(), triangle, triangle + 3);
+            }
+        }
+        return mesh;
+    }
+
+    // Фигура в формате layout: i-й атрибут layout заполняется semantics[i], вершины пакуются VertexQuantizer.
+    // После упаковки одинаковые вершины сливаются: например, у UVSphere только с позициями шов исчезает.
+    template <typename Mesh>
+    IndexedMesh Build(const Mesh& mesh, const VertexLayout& layout, std::initializer_list<VertexSemantic> semantics)
+    {
+        if (semantics.size() != layout.Attributes().size()) {
+            std::cout << "ERROR::PROCEDURAL::SEMANTICS_DO_NOT_MATCH_LAYOUT" << std::endl;
+            return IndexedMesh();
+        }
+        VertexLayout source;
+        const VertexFormat floatFormats[] = { VertexFormat::Float1, VertexFormat::Float2, VertexFormat::Float3 };
+        size_t attribute = 0;
+        for (VertexSemantic semantic : semantics) {
+            source.Add(layout.Attributes()[attribute++].Location, floatFormats[SemanticSize(semantic) - 1]);
+        }
+
+        // Вершины раскрываются по индексам, чтобы сварка после упаковки дала новые индексы
+        std::vector<GLfloat> floats;
+        floats.reserve(mesh.Indices.size() * source.Stride() / sizeof(GLfloat));
+        for (std::uint32_t index : mesh.Indices) {
+            for (VertexSemantic semantic : semantics) {
+                const float* data = SemanticData(mesh.Vertices[index], semantic);
+                floats.insert(floats.end(), data, data + SemanticSize(semantic));
+            }
+        }
+        const std::vector<std::uint8_t> packed = VertexQuantizer::Convert(floats, source, layout);
+        return MeshIndexer::Build(packed.data(), mesh.Indices.size(), layout.Stride());
+    }
+}
@@ -0,0 +1,81 @@
+#include "ProgramPipeline.h"
+#include "Stats.h"
+
+// Привязанный конвейер, как boundProgram в Shader.cpp
+static GLuint boundPipeline = 0;
+
+bool ProgramPipeline::IsSupported()
+{
+    return GLEW_VERSION_4_1 || GLEW_ARB_separate_shader_objects;
+}
+
+ProgramPipeline::ProgramPipeline(Shader* vertexStage, Shader* fragmentStage)
+    : vertexStage(vertexStage), fragmentStage(fragmentStage)
+{
+    glGenProgramPipelines(1, &pipeline);
+}
+
+ProgramPipeline::~ProgramPipeline()
+{
+    if (boundPipeline == pipeline)
+    {
+        boundPipeline = 0;
+    }
+    glDeleteProgramPipelines(1, &pipeline);
+}
+
+void ProgramPipeline::Use()
+{
+    // Программа из glUseProgram важнее конвейера
+    Shader::UnbindProgram();
+
+    if (vertexProgram != vertexStage->Program)
+    {
+        vertexProgram = vertexStage->Program;
+        glUseProgramStages(pipeline, GL_VERTEX_SHADER_BIT, vertexProgram);
+    }
+    if (fragmentProgram != fragmentStage->Program)
+    {
+        fragmentProgram = fragmentStage->Program;
+        glUseProgramStages(pipeline, GL_FRAGMENT_SHADER_BIT, fragmentProgram);
+    }
+
+    if (boundPipeline == pipeline)
+    {
+        ++Stats::Frame.PipelineBindsSkipped;
+        return;
+    }
+    glBindProgramPipeline(pipeline);
+    boundPipeline = pipeline;
+    ++Stats::Frame.PipelineBinds;
+}
+
+void ProgramPipeline::SetInt(ShaderParam param, GLint value)
+{
+    vertexStage->SetInt(param, value);
+    fragmentStage->SetInt(param, value);
+}
+
+void ProgramPipeline::SetFloat(ShaderParam param, GLfloat value)
+{
+    vertexStage->SetFloat(param, value);
+    fragmentStage->SetFloat(param, value);
+}
+
+void ProgramPipeline::SetVec3(ShaderParam param, const glm::vec3& value)
+{
+    vertexStage->SetVec3(param, value);
+    fragmentStage->SetVec3(param, value);
+}
+
+void ProgramPipeline::SetVec4(ShaderParam param, const glm::vec4& value)
+{
+    vertexStage->SetVec4(param, value);
+    fragmentStage->SetVec4(param, value);
+}
+
+void ProgramPipeline::SetMat4(ShaderParam param, const glm::mat4& value)
+{
+    vertexStage->SetMat4(param, value);
+    fragmentStage->SetMat4(param, value);
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include "Shader.h"
+
+// Конвейер из отдельных стадий (GL_ARB_separate_shader_objects).
+// Каждая вершинная и фрагментная стадия собирается один раз как отдельная программа
+// (см. Shader(GLenum stage, ...)) и подставляется в конвейер через glUseProgramStages.
+// V вершинных и F фрагментных шейдеров дают V + F линковок вместо V x F.
+// Стадии общие, поэтому их лучше брать через ShaderLibrary::GetPipeline.
+class ProgramPipeline
+{
+public:
+    static bool IsSupported();
+
+    ProgramPipeline(Shader* vertexStage, Shader* fragmentStage);
+    ~ProgramPipeline();
+
+    ProgramPipeline(const ProgramPipeline&) = delete;
+    ProgramPipeline& operator=(const ProgramPipeline&) = delete;
+
+    // Привязывает конвейер. Если стадию пересобрали (горячая перезагрузка), подставляет новую программу.
+    void Use();
+
+    // Обе стадии слинкованы
+    bool IsReady() const
+    {
+        return vertexStage->IsReady() && fragmentStage->IsReady();
+    }
+
+    Shader* GetVertexStage() const
+    {
+        return vertexStage;
+    }
+
+    Shader* GetFragmentStage() const
+    {
+        return fragmentStage;
+    }
+
+    // Uniform уходит в ту стадию, где он объявлен (в обе, если в обеих).
+    // Стадии делят между собой все конвейеры, так что и значение общее для них.
+    void SetInt(ShaderParam param, GLint value);
+    void SetFloat(ShaderParam param, GLfloat value);
+    void SetVec3(ShaderParam param, const glm::vec3& value);
+    void SetVec4(ShaderParam param, const glm::vec4& value);
+    void SetMat4(ShaderParam param, const glm::mat4& value);
+
+private:
+    GLuint pipeline = 0;
+    Shader* vertexStage;
+    Shader* fragmentStage;
+    // Программы, которые сейчас стоят в конвейере
+    GLuint vertexProgram = 0;
+    GLuint fragmentProgram = 0;
+};
@@ -0,0 +1,230 @@
+#include "RenderQueue.h"
+#include "FrameRing.h"
+#include "MaterialWithMesh.h"
+#include <algorithm>
+#include <cstring>
+
+static_assert(RENDER_PACKET_TEXTURES == 2, "TextureSetId packs two texture names into 64 bits");
+
+static constexpr ShaderParam ModelParam("model");
+static constexpr ShaderParam OpacityParam("opacity");
+
+// Ширина полей ключа; вместе с битом прохода - 64
+static const unsigned PROGRAM_BITS = 12;
+static const unsigned TEXTURE_BITS = 12;
+static const unsigned POOL_BITS = 8;
+static const unsigned DEPTH_BITS = 31;
+static_assert(1 + PROGRAM_BITS + TEXTURE_BITS + POOL_BITS + DEPTH_BITS == 64, "sort key must fill 64 bits");
+
+static const std::uint64_t TRANSPARENT_BIT = std::uint64_t(1) << 63;
+static const std::uint32_t DEPTH_MASK = (1u << DEPTH_BITS) - 1;
+
+static bool IsTransparent(const RenderPacket& packet)
+{
+    return packet.Opacity < 1.f;
+}
+
+// Биты неотрицательного float растут вместе с ним и умещаются в 31 бит - это и есть глубина ключа
+static std::uint32_t DepthBits(float depth)
+{
+    if (!(depth > 0.f)) {
+        return 0;
+    }
+    std::uint32_t bits;
+    memcpy(&bits, &depth, sizeof(bits));
+    return bits & DEPTH_MASK;
+}
+
+static bool UsesModelBlock(const RenderPacket& packet)
+{
+    return (packet.Material->GetShaderFeatures() & SHADER_FEATURE_MODEL_BLOCK) != 0;
+}
+
+static bool SameTextures(const RenderPacket& a, const RenderPacket& b)
+{
+    return memcmp(a.Textures, b.Textures, sizeof(a.Textures)) == 0;
+}
+
+void RenderQueue::Begin(const glm::mat4& viewMatrix)
+{
+    view = viewMatrix;
+    packets.clear();
+    keys.clear();
+}
+
+void RenderQueue::Add(const RenderPacket& packet)
+{
+    if (packet.Material == nullptr || !packet.Range.IsValid() || packet.Range.IndexCount == 0) {
+        return;
+    }
+    packets.push_back(packet);
+    keys.push_back(MakeKey(packet));
+}
+
+std::uint16_t RenderQueue::ProgramId(const RenderPacket& packet)
+{
+    // Номера больше ширины поля повторяются - сортировка хуже, но Record все равно сравнивает сами программы
+    const auto inserted = programIds.emplace(packet.Material->GetProgramKey(), static_cast<std::uint16_t>(programIds.size()));
+    return inserted.first->second & ((1u << PROGRAM_BITS) - 1);
+}
+
+std::uint16_t RenderQueue::TextureSetId(const RenderPacket& packet)
+{
+    const std::uint64_t textures = (std::uint64_t(packet.Textures[0]) << 32) | packet.Textures[1];
+    const auto inserted = textureSetIds.emplace(textures, static_cast<std::uint16_t>(textureSetIds.size()));
+    return inserted.first->second & ((1u << TEXTURE_BITS) - 1);
+}
+
+std::uint64_t RenderQueue::MakeKey(const RenderPacket& packet)
+{
+    // Расстояние по оси взгляда: камера смотрит вдоль -z пространства вида
+    const float depth = -(view * packet.Model[3]).z;
+    const std::uint64_t state = (std::uint64_t(ProgramId(packet)) << (TEXTURE_BITS + POOL_BITS))
+        | (std::uint64_t(TextureSetId(packet)) << POOL_BITS)
+        | (packet.Range.Pool & ((1u << POOL_BITS) - 1));
+
+    if (IsTransparent(packet)) {
+        return TRANSPARENT_BIT | (std::uint64_t(DEPTH_MASK - DepthBits(depth)) << (64 - 1 - DEPTH_BITS)) | state;
+    }
+    return (state << DEPTH_BITS) | DepthBits(depth);
+}
+
+void RenderQueue::Sort()
+{
+    const size_t count = keys.size();
+    order.resize(count);
+    orderScratch.resize(count);
+    keysScratch.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        order[i] = static_cast<std::uint32_t>(i);
+    }
+
+    // 8 проходов по байту, начиная с младшего. Проход устойчив, так что пакеты с равными ключами
+    // остаются в порядке Add. Байт, одинаковый у всех ключей (например, пустые старшие биты номеров), пропускается.
+    for (unsigned shift = 0; shift < 64; shift += 8) {
+        size_t counts[256] = {};
+        for (size_t i = 0; i < count; ++i) {
+            ++counts[(keys[i] >> shift) & 0xFF];
+        }
+        if (counts[(keys[0] >> shift) & 0xFF] == count) {
+            continue;
+        }
+
+        size_t offset = 0;
+        for (size_t& bucket : counts) {
+            const size_t size = bucket;
+            bucket = offset;
+            offset += size;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            const size_t at = counts[(keys[i] >> shift) & 0xFF]++;
+            keysScratch[at] = keys[i];
+            orderScratch[at] = order[i];
+        }
+        keys.swap(keysScratch);
+        order.swap(orderScratch);
+    }
+}
+
+RenderQueue::Switches RenderQueue::CountSwitches(const std::vector<RenderPacket>& packets, const std::vector<std::uint32_t>& order)
+{
+    Switches switches;
+    const RenderPacket* previous = nullptr;
+    for (std::uint32_t i : order) {
+        const RenderPacket& packet = packets[i];
+        if (previous == nullptr || previous->Material->GetProgramKey() != packet.Material->GetProgramKey()) {
+            ++switches.Programs;
+        }
+        if (previous == nullptr || !SameTextures(*previous, packet)) {
+            ++switches.Textures;
+        }
+        if (previous == nullptr || previous->Range.Pool != packet.Range.Pool) {
+            ++switches.VertexArrays;
+        }
+        previous = &packet;
+    }
+    return switches;
+}
+
+void RenderQueue::Record(CommandBuffer& commands, FrameRing* ring)
+{
+    sorted = Switches();
+    unsorted = Switches();
+    if (packets.empty()) {
+        return;
+    }
+
+    // Порядок Add - только для сравнения, считается до сортировки
+    order.resize(packets.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = static_cast<std::uint32_t>(i);
+    }
+    unsorted = CountSwitches(packets, order);
+    Sort();
+    sorted = CountSwitches(packets, order);
+
+    // Матрицы всех пакетов с блоком - одним выделением в кольце, чтобы потоки не спорили за него на каждом пакете
+    std::uint8_t* models = nullptr;
+    size_t modelsOffset = 0;
+    size_t modelStride = 0;
+    if (ring != nullptr) {
+        const size_t blockPackets = std::count_if(packets.begin(), packets.end(), UsesModelBlock);
+        modelStride = (sizeof(glm::mat4) + ring->GetUniformAlignment() - 1) & ~(ring->GetUniformAlignment() - 1);
+        if (blockPackets > 0) {
+            models = static_cast<std::uint8_t*>(ring->Allocate(blockPackets * modelStride, ring->GetUniformAlignment(), modelsOffset));
+        }
+    }
+
+    const RenderPacket* previous = nullptr;
+    bool blending = false;
+    for (std::uint32_t i : order) {
+        const RenderPacket& packet = packets[i];
+        // Без места в кольце блок остался бы от чужого объекта - такие пакеты не рисуются
+        if (UsesModelBlock(packet) && models == nullptr) {
+            continue;
+        }
+        if (!blending && IsTransparent(packet)) {
+            // Прозрачные идут после всех непрозрачных
+            commands.SetBlend(true);
+            blending = true;
+        }
+        const bool programChanged = previous == nullptr || previous->Material->GetProgramKey() != packet.Material->GetProgramKey();
+        if (programChanged) {
+            commands.UseProgram(packet.Material);
+        }
+        if (previous == nullptr || !SameTextures(*previous, packet)) {
+            std::uint32_t textures[RENDER_PACKET_TEXTURES];
+            std::copy(packet.Textures, packet.Textures + RENDER_PACKET_TEXTURES, textures);
+            commands.BindTextures(textures);
+        }
+        if (!UsesModelBlock(packet)) {
+            commands.SetMat4(ModelParam, packet.Model);
+        } else {
+            memcpy(models, &packet.Model, sizeof(glm::mat4));
+            commands.BindUniformBlock(MODEL_BLOCK_BINDING, ring->GetBuffer(), modelsOffset, sizeof(glm::mat4));
+            models += modelStride;
+            modelsOffset += modelStride;
+        }
+        // У другой программы свое значение uniform
+        if (programChanged || previous->Opacity != packet.Opacity) {
+            commands.SetFloat(OpacityParam, packet.Opacity);
+        }
+        commands.Draw(packet.Range);
+        previous = &packet;
+    }
+    if (blending) {
+        commands.SetBlend(false);
+    }
+}
+
+void RenderQueue::Submit(const std::function<void(MaterialWithMesh&)>& setupProgram, FrameRing* ring)
+{
+    commands.Reset();
+    Record(commands, ring);
+    if (ring != nullptr) {
+        ring->Flush();
+    }
+    executor.Begin();
+    executor.Execute(commands, setupProgram);
+    executor.End();
+}
@@ -0,0 +1,103 @@
+#pragma once
+#include "Common.h"
+#include "CommandBuffer.h"
+#include "GeometryArena.h"
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+class FrameRing;
+class MaterialWithMesh;
+
+// Сколько текстурных блоков задает пакет
+const unsigned RENDER_PACKET_TEXTURES = COMMAND_TEXTURE_UNITS;
+
+// Одна отрисовка для RenderQueue: программа материала, текстуры, участок арены (VAO - его пул) и model
+struct RenderPacket {
+    MaterialWithMesh* Material = nullptr;
+    // Текстуры блоков GL_TEXTURE0.., 0 - блок не нужен
+    GLuint Textures[RENDER_PACKET_TEXTURES] = {};
+    // Обычно MaterialWithMesh::GetDrawRange после SelectLod
+    GeometryRange Range;
+    glm::mat4 Model = glm::mat4(1.f);
+    // Меньше 1 - прозрачный: рисуется после непрозрачных, со смешиванием и без записи глубины
+    GLfloat Opacity = 1.f;
+};
+
+// Очередь отрисовки кадра. Пакеты от разных материалов кодируются в 64-битные ключи
+// и сортируются поразрядно (LSD, по байту за проход), затем записываются в CommandBuffer
+// без повторных привязок. Сама очередь GL не трогает, так что у каждого рабочего потока может быть своя.
+//
+// Ключ непрозрачного пакета, от старших битов: проход (0), программа, набор текстур, пул арены (VAO),
+// глубина - одинаковое состояние идет подряд, внутри него от ближних к дальним (раннее отсечение по глубине).
+// Ключ прозрачного: проход (1), глубина наоборот, программа, текстуры, пул - от дальних к ближним,
+// смешивание требует порядка важнее, чем экономия привязок.
+//
+// Номера программ и наборов текстур выдаются по первому появлению и живут между кадрами.
+// Uniform model ставится для каждого пакета, opacity - когда меняется. Материалам с SHADER_FEATURE_MODEL_BLOCK
+// model пишется в FrameRing, а в буфер идет привязка ее участка к блоку ModelBlock.
+class RenderQueue
+{
+public:
+    // Смены состояния между соседними пакетами
+    struct Switches {
+        unsigned Programs = 0;
+        unsigned Textures = 0;
+        unsigned VertexArrays = 0;
+    };
+
+    // Новый кадр: очередь пуста, глубина пакетов считается в пространстве вида view
+    void Begin(const glm::mat4& view);
+
+    void Add(const RenderPacket& packet);
+
+    // Сортирует и дописывает пакеты в commands. Смешивание, если его включили прозрачные, в конце выключается.
+    // ring - куда писать model для блока ModelBlock; без него или без места в нем такие пакеты пропускаются.
+    // Без постоянного отображения перед исполнением commands нужен ring->Flush().
+    void Record(CommandBuffer& commands, FrameRing* ring = nullptr);
+
+    // Record в свой буфер и исполнение - только в потоке контекста. setupProgram вызывается после
+    // каждой смены программы - для uniform кадра (view, projection, сэмплеры).
+    void Submit(const std::function<void(MaterialWithMesh&)>& setupProgram, FrameRing* ring = nullptr);
+
+    size_t Size() const
+    {
+        return packets.size();
+    }
+
+    // Смены в последнем Record и сколько их было бы в порядке Add - для сравнения
+    const Switches& GetSortedSwitches() const
+    {
+        return sorted;
+    }
+
+    const Switches& GetUnsortedSwitches() const
+    {
+        return unsorted;
+    }
+
+private:
+    std::uint64_t MakeKey(const RenderPacket& packet);
+    std::uint16_t ProgramId(const RenderPacket& packet);
+    std::uint16_t TextureSetId(const RenderPacket& packet);
+    void Sort();
+    static Switches CountSwitches(const std::vector<RenderPacket>& packets, const std::vector<std::uint32_t>& order);
+
+    glm::mat4 view = glm::mat4(1.f);
+    std::vector<RenderPacket> packets;
+    std::vector<std::uint64_t> keys;
+    // Номера пакетов в порядке отрисовки и буферы поразрядной сортировки
+    std::vector<std::uint32_t> order;
+    std::vector<std::uint32_t> orderScratch;
+    std::vector<std::uint64_t> keysScratch;
+
+    std::unordered_map<const void*, std::uint16_t> programIds;
+    std::unordered_map<std::uint64_t, std::uint16_t> textureSetIds;
+
+    Switches sorted;
+    Switches unsorted;
+
+    CommandBuffer commands;
+    CommandExecutor executor;
+};
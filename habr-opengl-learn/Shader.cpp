@@ -1,85 +1,246 @@
 #include "Shader.h"
+#include "MappedFile.h"
+#include "ShaderCompiler.h"
+#include "ShaderPreprocessor.h"
+#include "Stats.h"
+#include <cstring>
 
-Shader::Shader(const GLchar* vertexPath, const GLchar* fragmentPath)
-{
-    // 1. Получаем исходный код шейдера из filePath
-    std::string vertexCode;
-    std::string fragmentCode;
-    std::ifstream vShaderFile;
-    std::ifstream fShaderFile;
-    // Удостоверимся, что ifstream объекты могут выкидывать исключения
-    vShaderFile.exceptions(std::ifstream::failbit);
-    fShaderFile.exceptions(std::ifstream::failbit);
-    try
-    {
-        // Открываем файлы
-        vShaderFile.open(vertexPath);
-        fShaderFile.open(fragmentPath);
-        std::stringstream vShaderStream, fShaderStream;
-        // Считываем данные в потоки
-        vShaderStream << vShaderFile.rdbuf();
-        fShaderStream << fShaderFile.rdbuf();
-        // Закрываем файлы
-        vShaderFile.close();
-        fShaderFile.close();
-        // Преобразовываем потоки в массив GLchar
-        vertexCode = vShaderStream.str();
-        fragmentCode = fShaderStream.str();
-    }
-    catch (std::ifstream::failure e)
-    {
-        std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-    }
-    const GLchar* vShaderCode = vertexCode.c_str();
-    const GLchar* fShaderCode = fragmentCode.c_str();
-
-    // 2. Сборка шейдеров
-    GLuint vertex, fragment;
-    GLint success;
-    GLchar infoLog[512];
-
-    // Вершинный шейдер
-    vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
-    glCompileShader(vertex);
-    // Если есть ошибки - вывести их
-    glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
-    };
-
-    // Аналогично для фрагментного шейдера
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    // Если есть ошибки - вывести их
-    glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-    if (!success)
-    {
-        glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
-    };
-
-    // Шейдерная программа
-    this->Program = glCreateProgram();
-    glAttachShader(this->Program, vertex);
-    glAttachShader(this->Program, fragment);
-    glLinkProgram(this->Program);
-    //Если есть ошибки - вывести их
-    glGetProgramiv(this->Program, GL_LINK_STATUS, &success);
-    if (!success)
-    {
-        glGetProgramInfoLog(this->Program, 512, NULL, infoLog);
-        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
-    }
-
-    // Удаляем шейдеры, поскольку они уже в программу и нам больше не нужны.
-    glDeleteShader(vertex);
-    glDeleteShader(fragment);
+Shader::Shader(const GLchar* vertexPath, const GLchar* fragmentPath, ShaderCompileMode mode, unsigned features)
+{
+    this->vertexPath = vertexPath;
+    this->fragmentPath = fragmentPath;
+    this->features = features;
+    Start(mode);
+}
+
+Shader::Shader(ShaderFromSpirvTag, const GLchar* vertexPath, const GLchar* fragmentPath, ShaderCompileMode mode, unsigned features)
+{
+    this->vertexPath = vertexPath;
+    this->fragmentPath = fragmentPath;
+    this->features = features;
+    this->spirv = true;
+    Start(mode);
+}
+
+Shader::Shader(GLenum stage, const GLchar* path, ShaderCompileMode mode, unsigned features)
+{
+    if (stage == GL_VERTEX_SHADER)
+    {
+        this->vertexPath = path;
+    }
+    else
+    {
+        this->fragmentPath = path;
+    }
+    this->features = features | SHADER_FEATURE_SEPARABLE;
+    this->stage = stage;
+    Start(mode);
+}
+
+Shader::Shader(const GLchar* vertexPath, const GLchar* fragmentPath, ShaderSource&& vertexSource, ShaderSource&& fragmentSource,
+    ShaderCompileMode mode, unsigned features)
+{
+    this->vertexPath = vertexPath;
+    this->fragmentPath = fragmentPath;
+    this->features = features;
+    Start(mode, &vertexSource, &fragmentSource);
+}
+
+Shader::Shader(GLenum stage, const GLchar* path, ShaderSource&& source, ShaderCompileMode mode, unsigned features)
+{
+    this->features = features | SHADER_FEATURE_SEPARABLE;
+    this->stage = stage;
+    if (stage == GL_VERTEX_SHADER)
+    {
+        this->vertexPath = path;
+        Start(mode, &source, nullptr);
+    }
+    else
+    {
+        this->fragmentPath = path;
+        Start(mode, nullptr, &source);
+    }
+}
+
+void Shader::Start(ShaderCompileMode mode, ShaderSource* vertexSource, ShaderSource* fragmentSource)
+{
+    // Чтение исходников, кэш бинарников и сама сборка живут в ShaderCompiler
+    ShaderCompiler::Instance().Enqueue(this, vertexSource, fragmentSource);
+    if (mode == ShaderCompileMode::Immediate)
+    {
+        ShaderCompiler::Instance().Finish(this);
+    }
 }
 
+GLint Shader::GetUniformLocation(const GLchar* name) const
+{
+    ++Stats::Frame.LocationStringLookups;
+    return reflection.FindUniform(ShaderParam(name));
+}
+
+// Программа, привязанная в контексте. Контекст у нас один, поэтому хватает статической переменной.
+static GLuint boundProgram = 0;
+// Привязано неизвестно что - следующий Use() или UnbindProgram() обязательно вызовет glUseProgram
+static const GLuint UNKNOWN_PROGRAM = ~0u;
+
 void Shader::Use() 
 {
+    if (boundProgram == this->Program)
+    {
+        ++Stats::Frame.ProgramBindsSkipped;
+        return;
+    }
     glUseProgram(this->Program);
+    boundProgram = this->Program;
+    ++Stats::Frame.ProgramBinds;
+}
+
+void Shader::InvalidateBoundProgram()
+{
+    boundProgram = UNKNOWN_PROGRAM;
+}
+
+void Shader::UnbindProgram()
+{
+    if (boundProgram == 0)
+    {
+        return;
+    }
+    glUseProgram(0);
+    boundProgram = 0;
+    ++Stats::Frame.ProgramBinds;
+}
+
+void Shader::OnLinked(GLuint program, const MappedFile* vertexModule, const MappedFile* fragmentModule)
+{
+    // Новый объект программы - значения uniform в нем по умолчанию, теневые копии сбрасываем
+    if (boundProgram == this->Program)
+    {
+        boundProgram = UNKNOWN_PROGRAM;
+    }
+    this->Program = program;
+    if (vertexModule != nullptr && fragmentModule != nullptr)
+    {
+        reflection.ReflectSpirv(
+            reinterpret_cast<const std::uint32_t*>(vertexModule->Data()), vertexModule->Size() / sizeof(std::uint32_t),
+            reinterpret_cast<const std::uint32_t*>(fragmentModule->Data()), fragmentModule->Size() / sizeof(std::uint32_t));
+    }
+    else
+    {
+        reflection.Reflect(program);
+    }
+    // В GLSL 3.30 нет layout(binding), точка блока задается после линковки. Сбрасывается при пересборке.
+    const GLuint modelBlock = glGetUniformBlockIndex(program, "ModelBlock");
+    if (modelBlock != GL_INVALID_INDEX)
+    {
+        glUniformBlockBinding(program, modelBlock, MODEL_BLOCK_BINDING);
+    }
+    shadows.assign(reflection.UniformTableSize(), UniformShadow());
+}
+
+Shader::UniformShadow* Shader::UpdateShadow(ShaderParam param, const void* value, size_t size, GLint& location)
+{
+    const int slot = reflection.FindUniformSlot(param);
+    if (slot < 0)
+    {
+        return nullptr;
+    }
+
+    UniformShadow& shadow = shadows[slot];
+    if (shadow.Valid && memcmp(shadow.Value, value, size) == 0)
+    {
+        ++Stats::Frame.UniformUploadsSkipped;
+        return nullptr;
+    }
+
+    memcpy(shadow.Value, value, size);
+    shadow.Valid = true;
+    location = reflection.GetUniform(slot).Location;
+    ++Stats::Frame.UniformUploads;
+    // glUniform* работает с текущей программой. Отдельным стадиям привязка не нужна - у них glProgramUniform*.
+    if (stage == 0)
+    {
+        Use();
+    }
+    return &shadow;
+}
+
+void Shader::SetInt(ShaderParam param, GLint value)
+{
+    GLint location;
+    if (UpdateShadow(param, &value, sizeof(value), location))
+    {
+        if (stage != 0)
+        {
+            glProgramUniform1i(Program, location, value);
+        }
+        else
+        {
+            glUniform1i(location, value);
+        }
+    }
+}
+
+void Shader::SetFloat(ShaderParam param, GLfloat value)
+{
+    GLint location;
+    if (UpdateShadow(param, &value, sizeof(value), location))
+    {
+        if (stage != 0)
+        {
+            glProgramUniform1f(Program, location, value);
+        }
+        else
+        {
+            glUniform1f(location, value);
+        }
+    }
+}
+
+void Shader::SetVec3(ShaderParam param, const glm::vec3& value)
+{
+    GLint location;
+    if (UpdateShadow(param, glm::value_ptr(value), 3 * sizeof(GLfloat), location))
+    {
+        if (stage != 0)
+        {
+            glProgramUniform3fv(Program, location, 1, glm::value_ptr(value));
+        }
+        else
+        {
+            glUniform3fv(location, 1, glm::value_ptr(value));
+        }
+    }
+}
+
+void Shader::SetVec4(ShaderParam param, const glm::vec4& value)
+{
+    GLint location;
+    if (UpdateShadow(param, glm::value_ptr(value), 4 * sizeof(GLfloat), location))
+    {
+        if (stage != 0)
+        {
+            glProgramUniform4fv(Program, location, 1, glm::value_ptr(value));
+        }
+        else
+        {
+            glUniform4fv(location, 1, glm::value_ptr(value));
+        }
+    }
+}
+
+void Shader::SetMat4(ShaderParam param, const glm::mat4& value)
+{
+    GLint location;
+    if (UpdateShadow(param, glm::value_ptr(value), 16 * sizeof(GLfloat), location))
+    {
+        if (stage != 0)
+        {
+            glProgramUniformMatrix4fv(Program, location, 1, GL_FALSE, glm::value_ptr(value));
+        }
+        else
+        {
+            glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value));
+        }
+    }
 }
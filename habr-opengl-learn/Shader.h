@@ -1,20 +1,133 @@
 #pragma once
 #include "Common.h"
+#include "ShaderReflection.h"
 #include <string>
 #include <sstream>
 #include <iostream>
 #include <fstream>
+#include <vector>
+
+enum class ShaderCompileMode {
+    // Шейдер собирается прямо в конструкторе
+    Immediate,
+    // Шейдер ставится в очередь ShaderCompiler и будет готов через несколько кадров
+    Deferred
+};
+
+// Тег второго конструктора Shader: стадии берутся из предсобранных модулей SPIR-V
+struct ShaderFromSpirvTag {};
+constexpr ShaderFromSpirvTag ShaderFromSpirv{};
+
+class MappedFile;
+struct ShaderSource;
+
+// Точка привязки блока ModelBlock (SHADER_FEATURE_MODEL_BLOCK). Программы получают ее после линковки,
+// участок буфера на нее ставит FrameRing::BindUniform или команда BindUniformBlock.
+const GLuint MODEL_BLOCK_BINDING = 0;
 
 class Shader
 {
 public:
     // Идентификатор программы
-    GLuint Program;
+    GLuint Program = 0;
+
+    // Конструктор считывает и собирает шейдер. features - маска ShaderFeature, см. ShaderPreprocessor.
+    // Одинаковые перестановки лучше брать через ShaderLibrary - она не соберет их дважды.
+    Shader(const GLchar* vertexPath, const GLchar* fragmentPath, ShaderCompileMode mode = ShaderCompileMode::Immediate, unsigned features = 0);
 
-    // Конструктор считывает и собирает шейдер
-    Shader(const GLchar* vertexPath, const GLchar* fragmentPath);
+    // Сборка из SPIR-V: модули Spirv::ModulePath(path, features), см. --compile-spirv.
+    // Если драйвер не знает GL_ARB_gl_spirv, модулей нет или они не слинковались -
+    // шейдер молча собирается из тех же .glsl обычным путем.
+    Shader(ShaderFromSpirvTag, const GLchar* vertexPath, const GLchar* fragmentPath, ShaderCompileMode mode = ShaderCompileMode::Immediate, unsigned features = 0);
 
-    // Использование программы
+    // Отдельная стадия для ProgramPipeline (GL_ARB_separate_shader_objects).
+    // stage - GL_VERTEX_SHADER или GL_FRAGMENT_SHADER. Программа линкуется с GL_PROGRAM_SEPARABLE
+    // и сама не привязывается: Use() не нужен, Set* грузят uniform через glProgramUniform*.
+    Shader(GLenum stage, const GLchar* path, ShaderCompileMode mode = ShaderCompileMode::Immediate, unsigned features = 0);
+
+    // То же с уже развернутыми ShaderPreprocessor::Process(path, features) исходниками - их берет ShaderLibrary,
+    // чтобы не разворачивать файлы второй раз. Горячая перезагрузка все равно читает файлы заново.
+    Shader(const GLchar* vertexPath, const GLchar* fragmentPath, ShaderSource&& vertexSource, ShaderSource&& fragmentSource,
+        ShaderCompileMode mode, unsigned features);
+    Shader(GLenum stage, const GLchar* path, ShaderSource&& source, ShaderCompileMode mode, unsigned features);
+
+    // Использование программы. Если она уже привязана - glUseProgram не вызывается.
     void Use();
-};
 
+    // Забыть, какая программа привязана. Нужно после прямых вызовов glUseProgram в обход Shader.
+    static void InvalidateBoundProgram();
+
+    // glUseProgram(0), если привязана какая-то программа - иначе она перекрывает конвейер
+    static void UnbindProgram();
+
+    // Установка uniform с теневой копией: если значение не поменялось с прошлой загрузки,
+    // glUniform* не вызывается. Программа привязывается сама.
+    void SetInt(ShaderParam param, GLint value);
+    void SetFloat(ShaderParam param, GLfloat value);
+    void SetVec3(ShaderParam param, const glm::vec3& value);
+    void SetVec4(ShaderParam param, const glm::vec4& value);
+    void SetMat4(ShaderParam param, const glm::mat4& value);
+
+    // Программа слинкована и ей можно рисовать
+    bool IsReady() const
+    {
+        return ready;
+    }
+
+    // Стадия отдельной программы или 0 для обычной программы из двух стадий
+    GLenum GetStage() const
+    {
+        return stage;
+    }
+
+    // Позиция uniform из таблицы, собранной после линковки. Драйвер не опрашивается.
+    GLint GetUniformLocation(ShaderParam param) const
+    {
+        return reflection.FindUniform(param);
+    }
+
+    // То же по строке: имя хэшируется при каждом вызове, в цикле отрисовки лучше ShaderParam
+    GLint GetUniformLocation(const GLchar* name) const;
+
+    GLint GetAttribLocation(ShaderParam param) const
+    {
+        return reflection.FindAttribute(param);
+    }
+
+    const ShaderReflection& GetReflection() const
+    {
+        return reflection;
+    }
+
+private:
+    friend class ShaderCompiler;
+
+    // Последнее загруженное значение uniform. Хватает на mat4.
+    struct UniformShadow {
+        GLfloat Value[16];
+        bool Valid = false;
+    };
+
+    // Ячейка теневой копии для param или nullptr, если значение не поменялось (или uniform нет)
+    UniformShadow* UpdateShadow(ShaderParam param, const void* value, size_t size, GLint& location);
+
+    // Отдает шейдер ShaderCompiler и при Immediate дожидается сборки. Исходники, если есть, забирает компилятор.
+    void Start(ShaderCompileMode mode, ShaderSource* vertexSource = nullptr, ShaderSource* fragmentSource = nullptr);
+
+    // Вызывается после линковки: новая таблица uniform, старые теневые значения недействительны.
+    // Для программ из SPIR-V таблица строится по модулям.
+    void OnLinked(GLuint program, const MappedFile* vertexModule = nullptr, const MappedFile* fragmentModule = nullptr);
+
+    std::string vertexPath;
+    std::string fragmentPath;
+    unsigned features = 0;
+    // Собирать из SPIR-V. Сбрасывается, если модули не подошли.
+    bool spirv = false;
+    // Стадия отдельной программы, у нее задан только путь этой стадии
+    GLenum stage = 0;
+    bool ready = false;
+    // Растет при каждой пересборке, см. ShaderCompiler::Reload
+    unsigned generation = 0;
+    ShaderReflection reflection;
+    std::vector<UniformShadow> shadows;
+};
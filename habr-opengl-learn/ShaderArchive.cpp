@@ -0,0 +1,162 @@
+#include "ShaderArchive.h"
+#include "Hash.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// 'GLSA'
+static const std::uint32_t ARCHIVE_MAGIC = 0x41534C47;
+static const std::uint32_t ARCHIVE_VERSION = 1;
+
+struct ArchiveHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint32_t entryCount;
+    std::uint32_t reserved;
+};
+
+struct ArchiveEntry {
+    std::uint64_t nameHash;
+    std::uint32_t nameOffset;
+    std::uint32_t nameLength;
+    std::uint32_t dataOffset;
+    std::uint32_t dataLength;
+};
+
+static MappedFile archive;
+static const ArchiveEntry* entries = nullptr;
+static std::uint32_t entryCount = 0;
+
+// "./a.glsl", "a.glsl" и ".\\a.glsl" - один и тот же файл
+static std::string NormalizeName(const std::string& name)
+{
+    std::string normalized = name;
+    std::replace(normalized.begin(), normalized.end(), '\\', '/');
+    while (normalized.compare(0, 2, "./") == 0) {
+        normalized.erase(0, 2);
+    }
+    return normalized;
+}
+
+// Имя и данные каждой записи внутри файла, записи по возрастанию хэша (Find ищет делением пополам).
+// Проверяется один раз при монтировании - Find потом берет смещения как есть.
+static bool ValidEntries(const ArchiveEntry* table, std::uint32_t count, std::uint64_t size)
+{
+    for (std::uint32_t i = 0; i < count; ++i) {
+        const ArchiveEntry& entry = table[i];
+        if (std::uint64_t(entry.nameOffset) + entry.nameLength > size
+            || std::uint64_t(entry.dataOffset) + entry.dataLength > size
+            || (i > 0 && table[i - 1].nameHash > entry.nameHash)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ShaderArchive::Mount(const std::string& path)
+{
+    entries = nullptr;
+    entryCount = 0;
+    if (!archive.Open(path)) {
+        return false;
+    }
+
+    const ArchiveHeader* header = reinterpret_cast<const ArchiveHeader*>(archive.Data());
+    if (archive.Size() < sizeof(ArchiveHeader)
+        || header->magic != ARCHIVE_MAGIC
+        || header->version != ARCHIVE_VERSION
+        || archive.Size() < sizeof(ArchiveHeader) + std::uint64_t(header->entryCount) * sizeof(ArchiveEntry)
+        || !ValidEntries(reinterpret_cast<const ArchiveEntry*>(archive.Data() + sizeof(ArchiveHeader)), header->entryCount, archive.Size())) {
+        std::cout << "ERROR::SHADER_ARCHIVE::INVALID " << path << std::endl;
+        archive.Close();
+        return false;
+    }
+
+    entries = reinterpret_cast<const ArchiveEntry*>(archive.Data() + sizeof(ArchiveHeader));
+    entryCount = header->entryCount;
+    return true;
+}
+
+bool ShaderArchive::IsMounted()
+{
+    return entries != nullptr;
+}
+
+bool ShaderArchive::Find(const std::string& name, const char*& data, size_t& size)
+{
+    if (entries == nullptr) {
+        return false;
+    }
+
+    const std::string normalized = NormalizeName(name);
+    const std::uint64_t hash = HashString(normalized.c_str());
+    const ArchiveEntry* end = entries + entryCount;
+    const ArchiveEntry* entry = std::lower_bound(entries, end, hash,
+        [](const ArchiveEntry& e, std::uint64_t h) { return e.nameHash < h; });
+
+    // Коллизии хэшей маловероятны, но имя все равно сверяем
+    for (; entry != end && entry->nameHash == hash; ++entry) {
+        if (entry->nameLength == normalized.size()
+            && memcmp(archive.Data() + entry->nameOffset, normalized.data(), normalized.size()) == 0) {
+            data = archive.Data() + entry->dataOffset;
+            size = entry->dataLength;
+            return true;
+        }
+    }
+    return false;
+}
+
+int ShaderArchive::Pack(const std::string& output, const std::vector<std::string>& inputs)
+{
+    struct Input {
+        std::string name;
+        std::string data;
+        std::uint64_t hash;
+    };
+
+    std::vector<Input> files;
+    for (const std::string& path : inputs) {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            std::cout << "ERROR::SHADER_ARCHIVE::CANNOT_READ " << path << std::endl;
+            return 1;
+        }
+        Input input;
+        input.name = NormalizeName(path);
+        input.data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        input.hash = HashString(input.name.c_str());
+        files.push_back(input);
+    }
+    std::sort(files.begin(), files.end(), [](const Input& a, const Input& b) { return a.hash < b.hash; });
+
+    ArchiveHeader header = { ARCHIVE_MAGIC, ARCHIVE_VERSION, static_cast<std::uint32_t>(files.size()), 0 };
+    std::vector<ArchiveEntry> index(files.size());
+    std::uint32_t offset = static_cast<std::uint32_t>(sizeof(ArchiveHeader) + files.size() * sizeof(ArchiveEntry));
+    for (size_t i = 0; i < files.size(); ++i) {
+        index[i].nameHash = files[i].hash;
+        index[i].nameOffset = offset;
+        index[i].nameLength = static_cast<std::uint32_t>(files[i].name.size());
+        offset += index[i].nameLength;
+        index[i].dataOffset = offset;
+        index[i].dataLength = static_cast<std::uint32_t>(files[i].data.size());
+        offset += index[i].dataLength;
+    }
+
+    std::ofstream out(output, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        std::cout << "ERROR::SHADER_ARCHIVE::CANNOT_WRITE " << output << std::endl;
+        return 1;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(index.data()), index.size() * sizeof(ArchiveEntry));
+    for (const Input& input : files) {
+        out.write(input.name.data(), input.name.size());
+        out.write(input.data.data(), input.data.size());
+    }
+
+    std::cout << "Packed " << files.size() << " shaders into " << output << " (" << offset << " bytes)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Упакованный архив шейдеров: все .glsl в одном файле с индексом.
+// При старте архив отображается в память одним вызовом, дальше исходники берутся прямо из него,
+// вместо десятков open/read по отдельным файлам.
+//
+// Формат (little-endian):
+//   ArchiveHeader
+//   ArchiveEntry[entryCount], отсортированы по nameHash
+//   имена и данные, смещения считаются от начала файла
+namespace ShaderArchive {
+    // Подключает архив. Если файла нет, шейдеры читаются с диска как обычно.
+    bool Mount(const std::string& path);
+
+    bool IsMounted();
+
+    // Ищет файл в подключенном архиве. Указатель действителен, пока архив подключен.
+    bool Find(const std::string& name, const char*& data, size_t& size);
+
+    // Офлайн-упаковщик: --pack-shaders out.pak a.glsl b.glsl ...
+    int Pack(const std::string& output, const std::vector<std::string>& inputs);
+}
@@ -0,0 +1,170 @@
+#include "ShaderBinaryCache.h"
+#include "Hash.h"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <cstdio>
+
+#ifdef _WIN32
+#include <direct.h>
+#define MAKE_DIRECTORY(path) _mkdir(path)
+#else
+#include <sys/stat.h>
+#define MAKE_DIRECTORY(path) mkdir(path, 0755)
+#endif
+
+static const char* CACHE_DIRECTORY = "ShaderCache";
+// 'HSBC' - habr shader binary cache
+static const std::uint32_t CACHE_MAGIC = 0x43425348;
+static const std::uint32_t CACHE_VERSION = 1;
+
+struct CacheFileHeader {
+    std::uint32_t magic;
+    std::uint32_t version;
+    std::uint64_t key;
+    std::uint32_t format;
+    std::uint32_t size;
+};
+
+static ShaderBinaryCache::CacheStats stats;
+
+static std::string GetCachePath(std::uint64_t key)
+{
+    std::ostringstream path;
+    path << CACHE_DIRECTORY << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+    return path.str();
+}
+
+static std::string GetGLString(GLenum name)
+{
+    const GLubyte* value = glGetString(name);
+    return value ? reinterpret_cast<const char*>(value) : "";
+}
+
+bool ShaderBinaryCache::IsSupported()
+{
+    static int supported = -1;
+    if (supported < 0) {
+        GLint formats = 0;
+        if (GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary) {
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        }
+        supported = formats > 0 ? 1 : 0;
+    }
+    return supported == 1;
+}
+
+std::uint64_t ShaderBinaryCache::MakeKey(std::uint64_t vertexHash, std::uint64_t fragmentHash, const std::string& defines)
+{
+    // Строки драйвера не меняются за время работы - считаем их хэш один раз
+    static const std::uint64_t driverHash = HashString(
+        (GetGLString(GL_VENDOR) + "|" + GetGLString(GL_RENDERER) + "|" + GetGLString(GL_VERSION)).c_str()
+    );
+
+    std::uint64_t hash = HashBytes(&driverHash, sizeof(driverHash));
+    hash = HashBytes(&vertexHash, sizeof(vertexHash), hash);
+    hash = HashBytes(&fragmentHash, sizeof(fragmentHash), hash);
+    hash = HashBytes(defines.data(), defines.size(), hash);
+    return hash;
+}
+
+bool ShaderBinaryCache::Load(std::uint64_t key, GLuint program)
+{
+    const std::string path = GetCachePath(key);
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        ++stats.Misses;
+        return false;
+    }
+
+    CacheFileHeader header;
+    std::vector<char> binary;
+    bool valid = static_cast<bool>(file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+        && header.magic == CACHE_MAGIC
+        && header.version == CACHE_VERSION
+        && header.key == key
+        && header.size > 0;
+    if (valid) {
+        binary.resize(header.size);
+        valid = static_cast<bool>(file.read(binary.data(), binary.size()));
+    }
+    file.close();
+
+    GLint success = GL_FALSE;
+    if (valid) {
+        glProgramBinary(program, header.format, binary.data(), header.size);
+        glGetProgramiv(program, GL_LINK_STATUS, &success);
+    }
+
+    if (!success) {
+        // Драйвер обновился или файл битый - удаляем запись, программа соберется заново
+        ++stats.Rejected;
+        ++stats.Misses;
+        std::remove(path.c_str());
+        return false;
+    }
+
+    ++stats.Hits;
+    return true;
+}
+
+void ShaderBinaryCache::Store(std::uint64_t key, GLuint program)
+{
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return;
+    }
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &length, &format, binary.data());
+
+    // Пишем во временный файл и переименовываем только целиком записанный:
+    // оборванная запись не должна остаться в кэше под настоящим именем
+    MAKE_DIRECTORY(CACHE_DIRECTORY);
+    const std::string path = GetCachePath(key);
+    const std::string temporaryPath = path + ".tmp";
+    std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cout << "WARNING::SHADER_CACHE::CANNOT_WRITE " << temporaryPath << std::endl;
+        return;
+    }
+
+    CacheFileHeader header = { CACHE_MAGIC, CACHE_VERSION, key, format, static_cast<std::uint32_t>(length) };
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(binary.data(), length);
+    file.close();
+    if (file.fail()) {
+        std::cout << "WARNING::SHADER_CACHE::CANNOT_WRITE " << temporaryPath << std::endl;
+        std::remove(temporaryPath.c_str());
+        return;
+    }
+
+    // rename в Windows не заменяет существующий файл - старую запись убираем сами
+    std::remove(path.c_str());
+    if (std::rename(temporaryPath.c_str(), path.c_str()) != 0) {
+        std::cout << "WARNING::SHADER_CACHE::CANNOT_WRITE " << path << std::endl;
+        std::remove(temporaryPath.c_str());
+        return;
+    }
+    ++stats.Stored;
+}
+
+const ShaderBinaryCache::CacheStats& ShaderBinaryCache::GetStats()
+{
+    return stats;
+}
+
+void ShaderBinaryCache::PrintStats()
+{
+    const unsigned lookups = stats.Hits + stats.Misses;
+    std::cout << "ShaderBinaryCache: supported=" << (IsSupported() ? 1 : 0)
+        << " hits=" << stats.Hits
+        << " misses=" << stats.Misses
+        << " rejected=" << stats.Rejected
+        << " stored=" << stats.Stored
+        << " hitRate=" << (lookups ? 100.f * stats.Hits / lookups : 0.f) << "%"
+        << std::endl;
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include "Common.h"
+#include <cstdint>
+#include <string>
+
+// Дисковый кэш бинарников шейдерных программ (glGetProgramBinary/glProgramBinary).
+// Ключ - хэш исходников обоих шейдеров, дефайнов и строк драйвера (vendor/renderer/version),
+// поэтому смена драйвера или правка .glsl просто дают промах, а не битую программу.
+namespace ShaderBinaryCache {
+    struct CacheStats {
+        unsigned Hits = 0;
+        unsigned Misses = 0;
+        // Драйвер отказался принимать сохраненный бинарник
+        unsigned Rejected = 0;
+        unsigned Stored = 0;
+    };
+
+    // Поддерживает ли драйвер сохранение бинарников хотя бы в одном формате
+    bool IsSupported();
+
+    // vertexHash и fragmentHash - хэши развернутых исходников стадий
+    std::uint64_t MakeKey(std::uint64_t vertexHash, std::uint64_t fragmentHash, const std::string& defines);
+
+    // Пытается собрать program из кэша. true - программа слинкована и готова к работе.
+    bool Load(std::uint64_t key, GLuint program);
+
+    // Сохраняет бинарник успешно слинкованной программы
+    void Store(std::uint64_t key, GLuint program);
+
+    const CacheStats& GetStats();
+
+    void PrintStats();
+}
@@ -0,0 +1,413 @@
+#include "ShaderCompiler.h"
+#include "Hash.h"
+#include "ShaderBinaryCache.h"
+#include "ShaderPreprocessor.h"
+#include "ShaderTelemetry.h"
+#include "ShaderWatcher.h"
+#include "Spirv.h"
+
+// Только отдает шейдер драйверу - статус компиляции спрашиваем позже, иначе драйвер остановится на нем
+static GLuint IssueShaderCompile(GLenum type, const ShaderSource& source)
+{
+    GLuint shader = glCreateShader(type);
+    // Куски с явными длинами - драйвер читает прямо из отображенных файлов
+    glShaderSource(shader, static_cast<GLsizei>(source.Strings.size()), source.Strings.data(), source.Lengths.data());
+    glCompileShader(shader);
+    return shader;
+}
+
+// Длина лога компиляции, для телеметрии
+static size_t ShaderInfoLogLength(GLuint shader)
+{
+    GLint length = 0;
+    if (shader != 0)
+    {
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+    }
+    return static_cast<size_t>(length);
+}
+
+// Если есть ошибки - вывести их
+static void PrintCompileErrors(GLuint shader, const char* stageName, const std::string& path)
+{
+    GLint success;
+    GLchar infoLog[512];
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(shader, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::" << stageName << "::COMPILATION_FAILED " << path << "\n" << infoLog << std::endl;
+    }
+}
+
+ShaderCompiler& ShaderCompiler::Instance()
+{
+    // Создается при первом обращении, когда контекст GL уже есть
+    static ShaderCompiler compiler;
+    return compiler;
+}
+
+ShaderCompiler::ShaderCompiler()
+{
+    if (GLEW_KHR_parallel_shader_compile)
+    {
+        // 0xFFFFFFFF - драйвер сам выбирает количество потоков
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        parallel = true;
+    }
+    else if (GLEW_ARB_parallel_shader_compile)
+    {
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+        parallel = true;
+    }
+    useBinaryCache = ShaderBinaryCache::IsSupported();
+    spirvSupported = Spirv::IsSupported();
+}
+
+void ShaderCompiler::Enqueue(Shader* target, ShaderSource* vertexSource, ShaderSource* fragmentSource)
+{
+    target->ready = false;
+    Submit(target, false, vertexSource, fragmentSource);
+}
+
+void ShaderCompiler::Reload(Shader* target)
+{
+    Submit(target, true);
+}
+
+void ShaderCompiler::Submit(Shader* target, bool reload, ShaderSource* vertexSource, ShaderSource* fragmentSource)
+{
+    Job job;
+    job.target = target;
+    job.generation = ++target->generation;
+    job.reload = reload;
+    job.vertexPath = target->vertexPath;
+    job.fragmentPath = target->fragmentPath;
+
+    job.vertex = 0;
+    job.fragment = 0;
+    job.cacheKey = 0;
+
+    const std::string name = job.vertexPath.empty() ? job.fragmentPath
+        : job.fragmentPath.empty() ? job.vertexPath
+        : job.vertexPath + " + " + job.fragmentPath;
+    job.telemetry = ShaderTelemetry::Begin(name, target->features, reload);
+    ShaderTiming& timing = ShaderTelemetry::Get(job.telemetry);
+    double start = ShaderTelemetry::NowMs();
+
+    job.spirv = target->spirv && LoadSpirv(job);
+
+    std::uint64_t vertexHash;
+    std::uint64_t fragmentHash;
+    std::string defines = ShaderPreprocessor::FeatureDefines(target->features);
+    if (job.spirv)
+    {
+        vertexHash = HashBytes(job.vertexModule->Data(), job.vertexModule->Size());
+        fragmentHash = HashBytes(job.fragmentModule->Data(), job.fragmentModule->Size());
+        defines += "SPIR-V\n";
+        timing.Spirv = true;
+        timing.SourceBytes = job.vertexModule->Size() + job.fragmentModule->Size();
+    }
+    else
+    {
+        // #include и дефайны перестановки разворачиваются здесь же.
+        // Правку на диске читаем с диска, даже если подключен архив.
+        // У отдельной стадии конвейера путь второй стадии пустой.
+        // Исходник, уже развернутый в ShaderLibrary, второй раз не разворачиваем.
+        if (vertexSource != nullptr)
+        {
+            job.vertexSource = std::move(*vertexSource);
+        }
+        else if (!job.vertexPath.empty())
+        {
+            job.vertexSource = ShaderPreprocessor::Process(job.vertexPath, target->features, !reload);
+        }
+        if (fragmentSource != nullptr)
+        {
+            job.fragmentSource = std::move(*fragmentSource);
+        }
+        else if (!job.fragmentPath.empty())
+        {
+            job.fragmentSource = ShaderPreprocessor::Process(job.fragmentPath, target->features, !reload);
+        }
+        vertexHash = job.vertexSource.Hash;
+        fragmentHash = job.fragmentSource.Hash;
+        timing.SourceBytes = job.vertexSource.Size() + job.fragmentSource.Size();
+
+        // Следим за всеми файлами, включая подключенные - список мог поменяться после правки
+        for (const std::string& path : job.vertexSource.Dependencies)
+        {
+            ShaderWatcher::Instance().Watch(target, path);
+        }
+        for (const std::string& path : job.fragmentSource.Dependencies)
+        {
+            ShaderWatcher::Instance().Watch(target, path);
+        }
+    }
+
+    timing.ReadMs = ShaderTelemetry::NowMs() - start;
+
+    job.program = glCreateProgram();
+    if (target->stage != 0)
+    {
+        // Флаг нужен и до glProgramBinary, и до glLinkProgram
+        glProgramParameteri(job.program, GL_PROGRAM_SEPARABLE, GL_TRUE);
+    }
+
+    // Готовый бинарник из кэша не требует ни компиляции, ни линковки
+    if (useBinaryCache)
+    {
+        job.cacheKey = ShaderBinaryCache::MakeKey(vertexHash, fragmentHash, defines);
+        start = ShaderTelemetry::NowMs();
+        const bool hit = ShaderBinaryCache::Load(job.cacheKey, job.program);
+        timing.CacheLookupMs = ShaderTelemetry::NowMs() - start;
+        if (hit)
+        {
+            timing.CacheHit = true;
+            ShaderTelemetry::End(job.telemetry, true);
+            Adopt(job);
+            return;
+        }
+    }
+
+    queued.push_back(std::move(job));
+}
+
+bool ShaderCompiler::LoadSpirv(Job& job)
+{
+    if (!spirvSupported)
+    {
+        return false;
+    }
+
+    const std::string vertexPath = Spirv::ModulePath(job.vertexPath, job.target->features);
+    const std::string fragmentPath = Spirv::ModulePath(job.fragmentPath, job.target->features);
+    job.vertexModule = std::make_shared<MappedFile>();
+    job.fragmentModule = std::make_shared<MappedFile>();
+    job.vertexModule->Open(vertexPath);
+    job.fragmentModule->Open(fragmentPath);
+    if (!Spirv::IsValidModule(*job.vertexModule) || !Spirv::IsValidModule(*job.fragmentModule))
+    {
+        std::cout << "SHADER::SPIRV::FALLBACK no modules for " << job.vertexPath << " + " << job.fragmentPath << std::endl;
+        job.vertexModule.reset();
+        job.fragmentModule.reset();
+        return false;
+    }
+
+    // Пересобранный --compile-spirv модуль подхватывается так же, как правка .glsl
+    ShaderWatcher::Instance().Watch(job.target, vertexPath);
+    ShaderWatcher::Instance().Watch(job.target, fragmentPath);
+    return true;
+}
+
+void ShaderCompiler::Flush()
+{
+    if (queued.empty())
+    {
+        return;
+    }
+
+    // Сначала все компиляции, затем все линковки: ни одного запроса статуса между ними
+    for (Job& job : queued)
+    {
+        const double start = ShaderTelemetry::NowMs();
+        if (job.spirv)
+        {
+            job.vertex = Spirv::IssueSpecialize(GL_VERTEX_SHADER, *job.vertexModule);
+            job.fragment = Spirv::IssueSpecialize(GL_FRAGMENT_SHADER, *job.fragmentModule);
+            ShaderTelemetry::Get(job.telemetry).CompileMs += ShaderTelemetry::NowMs() - start;
+            continue;
+        }
+        if (!job.vertexPath.empty())
+        {
+            job.vertex = IssueShaderCompile(GL_VERTEX_SHADER, job.vertexSource);
+        }
+        if (!job.fragmentPath.empty())
+        {
+            job.fragment = IssueShaderCompile(GL_FRAGMENT_SHADER, job.fragmentSource);
+        }
+        ShaderTelemetry::Get(job.telemetry).CompileMs += ShaderTelemetry::NowMs() - start;
+        // glShaderSource уже скопировал текст - файлы можно отпускать
+        job.vertexSource = ShaderSource();
+        job.fragmentSource = ShaderSource();
+    }
+
+    for (Job& job : queued)
+    {
+        const double start = ShaderTelemetry::NowMs();
+        if (job.vertex != 0)
+        {
+            glAttachShader(job.program, job.vertex);
+        }
+        if (job.fragment != 0)
+        {
+            glAttachShader(job.program, job.fragment);
+        }
+        if (useBinaryCache)
+        {
+            // Просим драйвер сохранить бинарник, чтобы его можно было достать после линковки
+            glProgramParameteri(job.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        glLinkProgram(job.program);
+        ShaderTelemetry::Get(job.telemetry).LinkMs += ShaderTelemetry::NowMs() - start;
+        inFlight.push_back(std::move(job));
+    }
+
+    queued.clear();
+}
+
+void ShaderCompiler::Poll()
+{
+    Flush();
+
+    for (size_t i = 0; i < inFlight.size();)
+    {
+        if (IsComplete(inFlight[i]))
+        {
+            Complete(inFlight[i]);
+            inFlight.erase(inFlight.begin() + i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
+void ShaderCompiler::Finish(Shader* target)
+{
+    // Неудачная сборка из SPIR-V снова ставит шейдер в очередь уже как GLSL - ждем и ее
+    bool pending = true;
+    while (pending)
+    {
+        Flush();
+
+        for (size_t i = 0; i < inFlight.size();)
+        {
+            if (target == nullptr || inFlight[i].target == target)
+            {
+                // Запрос статуса сам дождется окончания линковки
+                Complete(inFlight[i]);
+                inFlight.erase(inFlight.begin() + i);
+            }
+            else
+            {
+                ++i;
+            }
+        }
+
+        pending = false;
+        for (const Job& job : queued)
+        {
+            pending = pending || target == nullptr || job.target == target;
+        }
+    }
+}
+
+bool ShaderCompiler::IsComplete(const Job& job) const
+{
+    if (!parallel)
+    {
+        // Без расширения спросить нельзя - компиляции уже отданы пачкой, просто забираем результат
+        return true;
+    }
+
+    GLint completed = GL_FALSE;
+    glGetProgramiv(job.program, GL_COMPLETION_STATUS_KHR, &completed);
+    return completed == GL_TRUE;
+}
+
+void ShaderCompiler::Complete(Job& job)
+{
+    GLint success;
+    GLchar infoLog[512];
+
+    // Без параллельной сборки запрос статуса ждет окончания компиляции и линковки
+    ShaderTiming& timing = ShaderTelemetry::Get(job.telemetry);
+    const double start = ShaderTelemetry::NowMs();
+    glGetProgramiv(job.program, GL_LINK_STATUS, &success);
+    timing.LinkMs += ShaderTelemetry::NowMs() - start;
+
+    GLint programLogLength = 0;
+    glGetProgramiv(job.program, GL_INFO_LOG_LENGTH, &programLogLength);
+    timing.InfoLogBytes = static_cast<size_t>(programLogLength) + ShaderInfoLogLength(job.vertex) + ShaderInfoLogLength(job.fragment);
+    ShaderTelemetry::End(job.telemetry, success == GL_TRUE);
+    if (!success)
+    {
+        if (job.vertex != 0)
+        {
+            PrintCompileErrors(job.vertex, "VERTEX", job.vertexPath);
+        }
+        if (job.fragment != 0)
+        {
+            PrintCompileErrors(job.fragment, "FRAGMENT", job.fragmentPath);
+        }
+        glGetProgramInfoLog(job.program, 512, NULL, infoLog);
+        std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+    }
+    else if (useBinaryCache)
+    {
+        ShaderBinaryCache::Store(job.cacheKey, job.program);
+    }
+
+    // Удаляем шейдеры, поскольку они уже в программе и нам больше не нужны.
+    if (job.vertex != 0)
+    {
+        glDetachShader(job.program, job.vertex);
+        glDeleteShader(job.vertex);
+    }
+    if (job.fragment != 0)
+    {
+        glDetachShader(job.program, job.fragment);
+        glDeleteShader(job.fragment);
+    }
+
+    if (!success && job.spirv)
+    {
+        // Драйвер не принял модули - собираем ту же программу из GLSL
+        std::cout << "SHADER::SPIRV::FALLBACK link failed for " << job.vertexPath << " + " << job.fragmentPath << std::endl;
+        glDeleteProgram(job.program);
+        job.target->spirv = false;
+        Submit(job.target, job.reload);
+        return;
+    }
+
+    if (success)
+    {
+        Adopt(job);
+    }
+    else if (job.reload)
+    {
+        // Сломанная правка не должна ронять картинку - продолжаем рисовать старой программой
+        std::cout << "SHADER::RELOAD::FAILED keeping previous program " << job.vertexPath << " + " << job.fragmentPath << std::endl;
+        glDeleteProgram(job.program);
+    }
+    else
+    {
+        job.target->Program = job.program;
+    }
+}
+
+void ShaderCompiler::Adopt(Job& job)
+{
+    Shader* target = job.target;
+    if (job.generation != target->generation)
+    {
+        // Пока собиралась эта версия, файл успели поменять еще раз
+        glDeleteProgram(job.program);
+        return;
+    }
+
+    // Подмена происходит на потоке отрисовки между кадрами, так что кадр целиком рисуется одной программой
+    const GLuint previous = target->Program;
+    target->OnLinked(job.program, job.vertexModule.get(), job.fragmentModule.get());
+    target->ready = true;
+    if (previous != 0 && previous != job.program)
+    {
+        glDeleteProgram(previous);
+    }
+    if (job.reload)
+    {
+        std::cout << "SHADER::RELOADED " << job.vertexPath << " + " << job.fragmentPath << std::endl;
+    }
+}
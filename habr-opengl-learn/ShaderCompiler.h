@@ -0,0 +1,82 @@
+#pragma once
+#include "Shader.h"
+#include "ShaderPreprocessor.h"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Пакетная сборка шейдеров.
+// Все программы сначала копятся в очереди, затем Flush() отдает драйверу все glCompileShader
+// и glLinkProgram подряд и только потом начинаются запросы статусов. С GL_KHR_parallel_shader_compile
+// драйвер собирает их в своих потоках, а Poll() из игрового цикла забирает готовые программы
+// через GL_COMPLETION_STATUS_KHR, не блокируя кадр.
+class ShaderCompiler
+{
+public:
+    static ShaderCompiler& Instance();
+
+    // Ставит шейдер в очередь. Если бинарник есть в кэше - шейдер готов сразу.
+    // Уже развернутые исходники стадий перемещаются в задачу, без них файлы читает сам компилятор.
+    void Enqueue(Shader* target, ShaderSource* vertexSource = nullptr, ShaderSource* fragmentSource = nullptr);
+
+    // Пересборка уже работающего шейдера после правки исходников.
+    // Старая программа остается в работе, пока новая не слинкуется; при ошибке она и остается.
+    void Reload(Shader* target);
+
+    // Запускает компиляцию и линковку всего, что накопилось в очереди
+    void Flush();
+
+    // Забирает готовые программы. Вызывается раз в кадр.
+    void Poll();
+
+    // Блокирующе дожидается сборки target (или всех программ, если nullptr)
+    void Finish(Shader* target = nullptr);
+
+    bool HasPendingWork() const
+    {
+        return !queued.empty() || !inFlight.empty();
+    }
+
+    // Драйвер умеет собирать шейдеры в фоне
+    bool IsParallel() const
+    {
+        return parallel;
+    }
+
+private:
+    struct Job {
+        Shader* target;
+        // Поколение шейдера на момент постановки: устаревшие сборки выбрасываются
+        unsigned generation;
+        bool reload;
+        std::string vertexPath;
+        std::string fragmentPath;
+        // Исходники нужны только до glShaderSource, после Flush отображения файлов освобождаются
+        ShaderSource vertexSource;
+        ShaderSource fragmentSource;
+        // Сборка из SPIR-V: модули нужны до конца линковки - по ним строится таблица uniform
+        bool spirv;
+        std::shared_ptr<MappedFile> vertexModule;
+        std::shared_ptr<MappedFile> fragmentModule;
+        std::uint64_t cacheKey;
+        GLuint vertex;
+        GLuint fragment;
+        GLuint program;
+        // Запись в ShaderTelemetry
+        size_t telemetry;
+    };
+
+    ShaderCompiler();
+
+    void Submit(Shader* target, bool reload, ShaderSource* vertexSource = nullptr, ShaderSource* fragmentSource = nullptr);
+    bool LoadSpirv(Job& job);
+    bool IsComplete(const Job& job) const;
+    void Complete(Job& job);
+    void Adopt(Job& job);
+
+    std::vector<Job> queued;
+    std::vector<Job> inFlight;
+    bool parallel = false;
+    bool useBinaryCache = false;
+    bool spirvSupported = false;
+};
@@ -0,0 +1,78 @@
+#include "ShaderLibrary.h"
+#include "Hash.h"
+#include <algorithm>
+#include <utility>
+
+static std::map<std::uint64_t, Shader*> shaders;
+static std::map<std::uint64_t, Shader*> stages;
+static std::map<std::pair<Shader*, Shader*>, ProgramPipeline*> pipelines;
+static unsigned requests = 0;
+
+Shader* ShaderLibrary::Get(const GLchar* vertexPath, const GLchar* fragmentPath, unsigned features, ShaderCompileMode mode)
+{
+    ++requests;
+
+    // Развернутые исходники уходят в компилятор - второй раз файлы не читаются
+    ShaderSource vertex = ShaderPreprocessor::Process(vertexPath, features);
+    ShaderSource fragment = ShaderPreprocessor::Process(fragmentPath, features);
+    const std::uint64_t key = HashBytes(&fragment.Hash, sizeof(fragment.Hash), vertex.Hash);
+
+    auto found = shaders.find(key);
+    if (found != shaders.end()) {
+        return found->second;
+    }
+
+    Shader* shader = new Shader(vertexPath, fragmentPath, std::move(vertex), std::move(fragment), mode, features);
+    shaders[key] = shader;
+    return shader;
+}
+
+Shader* ShaderLibrary::GetStage(GLenum stage, const GLchar* path, unsigned features, ShaderCompileMode mode)
+{
+    features |= SHADER_FEATURE_SEPARABLE;
+    ShaderSource source = ShaderPreprocessor::Process(path, features);
+    const std::uint64_t key = HashBytes(&stage, sizeof(stage), source.Hash);
+
+    auto found = stages.find(key);
+    if (found != stages.end()) {
+        return found->second;
+    }
+
+    Shader* shader = new Shader(stage, path, std::move(source), mode, features);
+    stages[key] = shader;
+    return shader;
+}
+
+ProgramPipeline* ShaderLibrary::GetPipeline(const GLchar* vertexPath, const GLchar* fragmentPath, unsigned features, ShaderCompileMode mode)
+{
+    ++requests;
+
+    Shader* vertexStage = GetStage(GL_VERTEX_SHADER, vertexPath, features, mode);
+    Shader* fragmentStage = GetStage(GL_FRAGMENT_SHADER, fragmentPath, features, mode);
+    ProgramPipeline*& pipeline = pipelines[std::make_pair(vertexStage, fragmentStage)];
+    if (pipeline == nullptr) {
+        pipeline = new ProgramPipeline(vertexStage, fragmentStage);
+    }
+    return pipeline;
+}
+
+std::vector<Shader*> ShaderLibrary::GetPermutations(const GLchar* vertexPath, const GLchar* fragmentPath, unsigned featureMask, ShaderCompileMode mode)
+{
+    std::vector<Shader*> permutations;
+    // Перебор всех подмножеств маски: features = (features - mask) & mask
+    unsigned features = 0;
+    do {
+        Shader* shader = Get(vertexPath, fragmentPath, features, mode);
+        if (std::find(permutations.begin(), permutations.end(), shader) == permutations.end()) {
+            permutations.push_back(shader);
+        }
+        features = (features - featureMask) & featureMask;
+    } while (features != 0);
+    return permutations;
+}
+
+void ShaderLibrary::PrintStats()
+{
+    std::cout << "ShaderLibrary: requested=" << requests << " unique=" << shaders.size()
+        << " stages=" << stages.size() << " pipelines=" << pipelines.size() << std::endl;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include "ProgramPipeline.h"
+#include "Shader.h"
+#include "ShaderPreprocessor.h"
+#include <cstdint>
+#include <map>
+#include <vector>
+
+// Общий реестр программ.
+// Шейдеры идентифицируются хэшем развернутого текста обеих стадий, поэтому материалы
+// с одинаковыми файлами и перестановками получают один и тот же Shader и одну сборку.
+namespace ShaderLibrary {
+    Shader* Get(const GLchar* vertexPath, const GLchar* fragmentPath, unsigned features = SHADER_FEATURE_NONE,
+        ShaderCompileMode mode = ShaderCompileMode::Deferred);
+
+    // Все перестановки по подмножествам featureMask. Совпадающие по тексту собираются один раз.
+    std::vector<Shader*> GetPermutations(const GLchar* vertexPath, const GLchar* fragmentPath, unsigned featureMask,
+        ShaderCompileMode mode = ShaderCompileMode::Deferred);
+
+    // Отдельная стадия для конвейера. Ключ - стадия и хэш ее развернутого текста.
+    Shader* GetStage(GLenum stage, const GLchar* path, unsigned features = SHADER_FEATURE_NONE,
+        ShaderCompileMode mode = ShaderCompileMode::Deferred);
+
+    // Конвейер из общих стадий: каждая стадия собирается один раз на все материалы,
+    // одинаковые пары стадий дают один и тот же конвейер.
+    ProgramPipeline* GetPipeline(const GLchar* vertexPath, const GLchar* fragmentPath, unsigned features = SHADER_FEATURE_NONE,
+        ShaderCompileMode mode = ShaderCompileMode::Deferred);
+
+    void PrintStats();
+}
@@ -0,0 +1,243 @@
+#include "ShaderPreprocessor.h"
+#include "ShaderArchive.h"
+#include "Hash.h"
+#include <cstring>
+#include <iostream>
+
+static const char* FEATURE_NAMES[SHADER_FEATURE_COUNT] = {
+    "VERTEX_COLOR",
+    "TWO_TEXTURES",
+    "SEPARABLE",
+    "INSTANCED",
+    "MODEL_BLOCK",
+};
+
+// Ограничение на глубину #include, чтобы циклические подключения не уводили в бесконечность
+static const int MAX_INCLUDE_DEPTH = 16;
+
+static unsigned archiveReads = 0;
+static unsigned fileMaps = 0;
+
+size_t ShaderSource::Size() const
+{
+    size_t size = 0;
+    for (int length : Lengths) {
+        size += length;
+    }
+    return size;
+}
+
+std::string ShaderSource::Join() const
+{
+    std::string code;
+    code.reserve(Size());
+    for (size_t i = 0; i < Strings.size(); ++i) {
+        code.append(Strings[i], Lengths[i]);
+    }
+    return code;
+}
+
+struct ShaderSourceBuilder {
+    ShaderSource& source;
+    bool allowArchive;
+    // Позиция куска, перед которым вставляются дефайны (сразу за #version)
+    size_t definesAt = 0;
+
+    void Append(const char* data, size_t size)
+    {
+        if (size > 0) {
+            source.Strings.push_back(data);
+            source.Lengths.push_back(static_cast<int>(size));
+        }
+    }
+
+    void AppendGenerated(const std::string& text)
+    {
+        source.generated.push_back(text);
+        Append(source.generated.back().data(), text.size());
+    }
+
+    void InsertGenerated(size_t at, const std::string& text)
+    {
+        source.generated.push_back(text);
+        source.Strings.insert(source.Strings.begin() + at, source.generated.back().data());
+        source.Lengths.insert(source.Lengths.begin() + at, static_cast<int>(text.size()));
+    }
+
+    bool Load(const std::string& path, const char*& data, size_t& size)
+    {
+        if (allowArchive && ShaderArchive::Find(path, data, size)) {
+            ++archiveReads;
+            return true;
+        }
+        std::shared_ptr<MappedFile> file = std::make_shared<MappedFile>();
+        if (!file->Open(path)) {
+            return false;
+        }
+        ++fileMaps;
+        data = file->Data();
+        size = file->Size();
+        source.files.push_back(file);
+        return true;
+    }
+
+    void Expand(const std::string& path, int depth);
+};
+
+static std::string DirectoryOf(const std::string& path)
+{
+    const size_t slash = path.find_last_of("/\\");
+    return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+}
+
+static const char* SkipSpaces(const char* begin, const char* end)
+{
+    while (begin < end && (*begin == ' ' || *begin == '\t')) {
+        ++begin;
+    }
+    return begin;
+}
+
+// Строка вида: #include "file.glsl" (пробелы допустимы). Возвращает имя файла.
+static bool ParseInclude(const char* begin, const char* end, std::string& file)
+{
+    begin = SkipSpaces(begin, end);
+    if (begin == end || *begin != '#') {
+        return false;
+    }
+    begin = SkipSpaces(begin + 1, end);
+    if (end - begin < 7 || memcmp(begin, "include", 7) != 0) {
+        return false;
+    }
+    const char* open = static_cast<const char*>(memchr(begin + 7, '"', end - begin - 7));
+    const char* close = open ? static_cast<const char*>(memchr(open + 1, '"', end - open - 1)) : nullptr;
+    if (close == nullptr) {
+        return false;
+    }
+    file.assign(open + 1, close);
+    return true;
+}
+
+static bool IsVersionLine(const char* begin, const char* end)
+{
+    begin = SkipSpaces(begin, end);
+    return end - begin >= 8 && memcmp(begin, "#version", 8) == 0;
+}
+
+void ShaderSourceBuilder::Expand(const std::string& path, int depth)
+{
+    const char* data = nullptr;
+    size_t size = 0;
+    if (depth > MAX_INCLUDE_DEPTH || !Load(path, data, size)) {
+        std::cout << "ERROR::SHADER::PREPROCESSOR::CANNOT_INCLUDE " << path << std::endl;
+        return;
+    }
+
+    // Номер файла попадает в #line, так что ошибки драйвера указывают на настоящий файл
+    const size_t fileIndex = source.Dependencies.size();
+    source.Dependencies.push_back(path);
+    if (depth > 0) {
+        AppendGenerated("#line 1 " + std::to_string(fileIndex) + "\n");
+    }
+
+    const char* end = data + size;
+    const char* run = data;
+    int lineNumber = 0;
+    for (const char* line = data; line < end;) {
+        const char* newline = static_cast<const char*>(memchr(line, '\n', end - line));
+        const char* lineEnd = newline ? newline : end;
+        const char* next = newline ? newline + 1 : end;
+        ++lineNumber;
+
+        std::string include;
+        if (depth == 0 && lineNumber == 1 && IsVersionLine(line, lineEnd)) {
+            // Отдельный кусок для #version, дефайны потом встанут сразу за ним
+            Append(run, next - run);
+            if (!newline) {
+                AppendGenerated("\n");
+            }
+            definesAt = source.Strings.size();
+            run = next;
+        } else if (ParseInclude(line, lineEnd, include)) {
+            Append(run, line - run);
+            Expand(DirectoryOf(path) + include, depth + 1);
+            AppendGenerated("#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n");
+            run = next;
+        }
+        line = next;
+    }
+    Append(run, end - run);
+    if (size > 0 && data[size - 1] != '\n') {
+        AppendGenerated("\n");
+    }
+}
+
+const char* ShaderPreprocessor::FeatureName(unsigned featureIndex)
+{
+    return featureIndex < SHADER_FEATURE_COUNT ? FEATURE_NAMES[featureIndex] : "";
+}
+
+std::string ShaderPreprocessor::FeatureDefines(unsigned features)
+{
+    std::string defines;
+    for (unsigned i = 0; i < SHADER_FEATURE_COUNT; ++i) {
+        if (features & (1u << i)) {
+            defines += "#define ";
+            defines += FEATURE_NAMES[i];
+            defines += '\n';
+        }
+    }
+    return defines;
+}
+
+static bool Mentions(const ShaderSource& source, const char* name)
+{
+    const size_t length = strlen(name);
+    for (size_t i = 0; i < source.Strings.size(); ++i) {
+        const char* begin = source.Strings[i];
+        const char* end = begin + source.Lengths[i];
+        for (const char* at = begin; end - at >= static_cast<ptrdiff_t>(length); ++at) {
+            at = static_cast<const char*>(memchr(at, name[0], end - at));
+            if (at == nullptr || end - at < static_cast<ptrdiff_t>(length)) {
+                break;
+            }
+            if (memcmp(at, name, length) == 0) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+ShaderSource ShaderPreprocessor::Process(const std::string& path, unsigned features, bool allowArchive)
+{
+    ShaderSource source;
+    ShaderSourceBuilder builder = { source, allowArchive };
+    builder.Expand(path, 0);
+
+    // Отбрасываем возможности, о которых шейдер не знает
+    unsigned used = 0;
+    for (unsigned i = 0; i < SHADER_FEATURE_COUNT; ++i) {
+        if ((features & (1u << i)) && Mentions(source, FEATURE_NAMES[i])) {
+            used |= 1u << i;
+        }
+    }
+
+    // #version обязан быть первой директивой - дефайны идут сразу за ним
+    if (used != 0) {
+        builder.InsertGenerated(builder.definesAt,
+            FeatureDefines(used) + "#line " + std::to_string(builder.definesAt == 0 ? 1 : 2) + " 0\n");
+    }
+
+    std::uint64_t hash = FNV_OFFSET_BASIS;
+    for (size_t i = 0; i < source.Strings.size(); ++i) {
+        hash = HashBytes(source.Strings[i], source.Lengths[i], hash);
+    }
+    source.Hash = hash;
+    return source;
+}
+
+void ShaderPreprocessor::PrintStats()
+{
+    std::cout << "ShaderPreprocessor: archiveReads=" << archiveReads << " fileMaps=" << fileMaps << std::endl;
+}
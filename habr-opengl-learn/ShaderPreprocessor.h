@@ -0,0 +1,70 @@
+#pragma once
+#include "MappedFile.h"
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Возможности шейдера, из которых собираются перестановки.
+// Каждый бит превращается в #define с именем из ShaderPreprocessor::FeatureName.
+enum ShaderFeature : unsigned {
+    SHADER_FEATURE_NONE = 0,
+    // У вершин есть цвет (layout location = 1), с одной текстурой он тонирует результат
+    SHADER_FEATURE_VERTEX_COLOR = 1 << 0,
+    // Смешивание ourTexture1 и ourTexture2 по uniform alpha
+    SHADER_FEATURE_TWO_TEXTURES = 1 << 1,
+    // Отдельная стадия ProgramPipeline. Ставится сама, вручную задавать не нужно.
+    SHADER_FEATURE_SEPARABLE = 1 << 2,
+    // Модель из атрибутов экземпляра (InstanceTransform) поверх uniform model, см. GeometryArena::DrawInstanced
+    SHADER_FEATURE_INSTANCED = 1 << 3,
+    // model из блока ModelBlock (точка привязки MODEL_BLOCK_BINDING), а не из uniform - см. FrameRing
+    SHADER_FEATURE_MODEL_BLOCK = 1 << 4,
+
+    SHADER_FEATURE_COUNT = 5
+};
+
+// Развернутый исходник одной стадии в виде кусков для glShaderSource(count, strings, lengths).
+// Куски указывают прямо в отображенные в память файлы (или архив), сам текст не копируется.
+// Отображения живут, пока жив ShaderSource, поэтому он только перемещается.
+struct ShaderSource {
+    std::vector<const char*> Strings;
+    std::vector<int> Lengths;
+    // Сам файл и все, что он подключил через #include - за ними следит ShaderWatcher
+    std::vector<std::string> Dependencies;
+    std::uint64_t Hash = 0;
+
+    ShaderSource() = default;
+    ShaderSource(ShaderSource&&) = default;
+    ShaderSource& operator=(ShaderSource&&) = default;
+    ShaderSource(const ShaderSource&) = delete;
+    ShaderSource& operator=(const ShaderSource&) = delete;
+
+    size_t Size() const;
+
+    // Склеенный текст - только для отладки и вывода ошибок
+    std::string Join() const;
+
+private:
+    friend struct ShaderSourceBuilder;
+
+    // deque не двигает элементы при добавлении, указатели в Strings остаются верными
+    std::deque<std::string> generated;
+    std::vector<std::shared_ptr<MappedFile>> files;
+};
+
+// Разворачивает #include "file" (путь относительно подключающего файла) и добавляет
+// #define для включенных возможностей сразу после #version.
+// Дефайн добавляется, только если исходник упоминает его имя - так перестановки, которые
+// шейдер не различает, дают одинаковый текст и собираются один раз (см. ShaderLibrary).
+namespace ShaderPreprocessor {
+    const char* FeatureName(unsigned featureIndex);
+
+    // Строка дефайнов для маски, для ключа кэша и отладочного вывода
+    std::string FeatureDefines(unsigned features);
+
+    // allowArchive = false читает файлы с диска в обход ShaderArchive - так делает горячая перезагрузка
+    ShaderSource Process(const std::string& path, unsigned features, bool allowArchive = true);
+
+    void PrintStats();
+}
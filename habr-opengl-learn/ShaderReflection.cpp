@@ -0,0 +1,198 @@
+#include "ShaderReflection.h"
+#include "Stats.h"
+#include <cstring>
+#include <string>
+
+// Для массива драйвер отдает имя вида "weights[0]" - в таблицу кладем "weights".
+// Убирается только "[0]" в конце: у массива структур каждый элемент - свой uniform ("lights[1].color"),
+// и индексы внутри имени нужны, чтобы ключи не совпали.
+static void StripArraySuffix(std::string& name)
+{
+    static const char SUFFIX[] = "[0]";
+    const size_t suffixLength = sizeof(SUFFIX) - 1;
+    if (name.size() > suffixLength && name.compare(name.size() - suffixLength, suffixLength, SUFFIX) == 0) {
+        name.resize(name.size() - suffixLength);
+    }
+}
+
+void ShaderReflection::Allocate(std::vector<Entry>& table, GLint count)
+{
+    // Степень двойки и заполненность не больше половины - пробы остаются короткими
+    size_t capacity = 4;
+    while (capacity < static_cast<size_t>(count) * 2) {
+        capacity *= 2;
+    }
+    table.assign(capacity, Entry());
+}
+
+void ShaderReflection::Insert(std::vector<Entry>& table, const Entry& entry)
+{
+    const size_t mask = table.size() - 1;
+    size_t i = entry.Hash & mask;
+    while (table[i].Hash != 0 && table[i].Hash != entry.Hash) {
+        i = (i + 1) & mask;
+    }
+    table[i] = entry;
+}
+
+void ShaderReflection::Clear()
+{
+    uniforms.clear();
+    attributes.clear();
+    uniformCount = 0;
+    attributeCount = 0;
+}
+
+// Переменная модуля SPIR-V: все, что нужно знать о ней для таблицы
+struct SpirvVariable {
+    std::string Name;
+    GLint Location = -1;
+    std::uint32_t StorageClass = ~0u;
+    bool BuiltIn = false;
+};
+
+// Опкоды и константы из спецификации SPIR-V, которые нам нужны
+static const std::uint32_t SPIRV_OP_NAME = 5;
+static const std::uint32_t SPIRV_OP_VARIABLE = 59;
+static const std::uint32_t SPIRV_OP_DECORATE = 71;
+static const std::uint32_t SPIRV_DECORATION_BUILTIN = 11;
+static const std::uint32_t SPIRV_DECORATION_LOCATION = 30;
+static const std::uint32_t SPIRV_STORAGE_UNIFORM_CONSTANT = 0;
+static const std::uint32_t SPIRV_STORAGE_INPUT = 1;
+static const size_t SPIRV_HEADER_WORDS = 5;
+
+// Проходит по инструкциям модуля и собирает переменные, индекс - id результата
+static std::vector<SpirvVariable> ParseSpirv(const std::uint32_t* words, size_t count)
+{
+    std::vector<SpirvVariable> variables;
+    if (count < SPIRV_HEADER_WORDS) {
+        return variables;
+    }
+    // Четвертое слово заголовка - верхняя граница id
+    variables.resize(words[3]);
+
+    for (size_t i = SPIRV_HEADER_WORDS; i < count;) {
+        const std::uint32_t length = words[i] >> 16;
+        const std::uint32_t opcode = words[i] & 0xFFFF;
+        if (length == 0 || i + length > count) {
+            break;
+        }
+        const std::uint32_t* op = words + i;
+        if (length >= 2 && op[1] < variables.size()) {
+            if (opcode == SPIRV_OP_NAME && length >= 3) {
+                // Строка в нуль-терминированных словах, ограничиваем длиной инструкции
+                const char* name = reinterpret_cast<const char*>(op + 2);
+                variables[op[1]].Name.assign(name, strnlen(name, (length - 2) * sizeof(std::uint32_t)));
+            }
+            else if (opcode == SPIRV_OP_DECORATE && length >= 3) {
+                if (op[2] == SPIRV_DECORATION_LOCATION && length >= 4) {
+                    variables[op[1]].Location = static_cast<GLint>(op[3]);
+                }
+                else if (op[2] == SPIRV_DECORATION_BUILTIN) {
+                    variables[op[1]].BuiltIn = true;
+                }
+            }
+        }
+        if (opcode == SPIRV_OP_VARIABLE && length >= 4 && op[2] < variables.size()) {
+            variables[op[2]].StorageClass = op[3];
+        }
+        i += length;
+    }
+    return variables;
+}
+
+void ShaderReflection::ReflectSpirv(const std::uint32_t* vertexWords, size_t vertexCount, const std::uint32_t* fragmentWords, size_t fragmentCount)
+{
+    Clear();
+
+    const std::vector<SpirvVariable> vertex = ParseSpirv(vertexWords, vertexCount);
+    const std::vector<SpirvVariable> fragment = ParseSpirv(fragmentWords, fragmentCount);
+
+    std::vector<Entry> foundUniforms;
+    std::vector<Entry> foundAttributes;
+    for (const std::vector<SpirvVariable>* stage : { &vertex, &fragment }) {
+        for (const SpirvVariable& variable : *stage) {
+            if (variable.Name.empty() || variable.Location < 0 || variable.BuiltIn) {
+                continue;
+            }
+            Entry entry;
+            entry.Hash = HashString(variable.Name.c_str());
+            entry.Location = variable.Location;
+            entry.Size = 1;
+            if (variable.StorageClass == SPIRV_STORAGE_UNIFORM_CONSTANT) {
+                foundUniforms.push_back(entry);
+            }
+            // Входы фрагментного шейдера - это varying, а не атрибуты
+            else if (variable.StorageClass == SPIRV_STORAGE_INPUT && stage == &vertex) {
+                foundAttributes.push_back(entry);
+            }
+        }
+    }
+
+    // Uniform, объявленный в обеих стадиях, попадает в таблицу один раз
+    Allocate(uniforms, static_cast<GLint>(foundUniforms.size()));
+    for (const Entry& entry : foundUniforms) {
+        if (FindSlot(uniforms, entry.Hash) < 0) {
+            Insert(uniforms, entry);
+            ++uniformCount;
+        }
+    }
+    Allocate(attributes, static_cast<GLint>(foundAttributes.size()));
+    for (const Entry& entry : foundAttributes) {
+        Insert(attributes, entry);
+        ++attributeCount;
+    }
+}
+
+void ShaderReflection::Reflect(GLuint program)
+{
+    Clear();
+
+    GLint count = 0;
+    GLint maxLength = 0;
+    std::vector<GLchar> buffer;
+
+    // Uniform-переменные
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    Allocate(uniforms, count);
+    buffer.resize(maxLength + 1);
+    for (GLint i = 0; i < count; ++i) {
+        GLsizei length = 0;
+        Entry entry;
+        glGetActiveUniform(program, i, static_cast<GLsizei>(buffer.size()), &length, &entry.Size, &entry.Type, buffer.data());
+        std::string name(buffer.data(), length);
+        entry.Location = glGetUniformLocation(program, name.c_str());
+        ++Stats::Frame.LocationQueries;
+        // Uniform из блоков не имеют позиции
+        if (entry.Location < 0) {
+            continue;
+        }
+        StripArraySuffix(name);
+        entry.Hash = HashString(name.c_str());
+        Insert(uniforms, entry);
+        ++uniformCount;
+    }
+
+    // Вершинные атрибуты
+    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+    Allocate(attributes, count);
+    buffer.resize(maxLength + 1);
+    for (GLint i = 0; i < count; ++i) {
+        GLsizei length = 0;
+        Entry entry;
+        glGetActiveAttrib(program, i, static_cast<GLsizei>(buffer.size()), &length, &entry.Size, &entry.Type, buffer.data());
+        std::string name(buffer.data(), length);
+        entry.Location = glGetAttribLocation(program, name.c_str());
+        ++Stats::Frame.LocationQueries;
+        // Встроенные gl_VertexID и подобные позиции не имеют
+        if (entry.Location < 0) {
+            continue;
+        }
+        StripArraySuffix(name);
+        entry.Hash = HashString(name.c_str());
+        Insert(attributes, entry);
+        ++attributeCount;
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include "Common.h"
+#include "Hash.h"
+#include <cstdint>
+#include <vector>
+
+// Имя uniform/attribute в виде хэша. Конструктор constexpr, поэтому
+// static constexpr ShaderParam ModelParam("model"); считается при компиляции
+// и в горячем цикле не остается ни строк, ни хэширования.
+struct ShaderParam {
+    std::uint64_t Hash;
+
+    constexpr explicit ShaderParam(const char* name) : Hash(HashString(name)) {}
+};
+
+// Активные uniform и attribute программы, собранные сразу после линковки.
+// Хранятся в плоской хэш-таблице с открытой адресацией: поиск - это пара сравнений целых чисел.
+class ShaderReflection
+{
+public:
+    struct Entry {
+        std::uint64_t Hash = 0;
+        GLint Location = -1;
+        GLenum Type = 0;
+        GLint Size = 0;
+    };
+
+    // Опрашивает драйвер обо всех активных uniform и attribute программы
+    void Reflect(GLuint program);
+
+    // То же для программы из SPIR-V, но по самим модулям: драйвер не обязан хранить имена
+    // (Mesa их не отдает), а glslang кладет их в OpName рядом с location.
+    // Type у таких записей не заполняется.
+    void ReflectSpirv(const std::uint32_t* vertexWords, size_t vertexCount, const std::uint32_t* fragmentWords, size_t fragmentCount);
+
+    void Clear();
+
+    GLint FindUniform(ShaderParam param) const
+    {
+        const int slot = FindSlot(uniforms, param.Hash);
+        return slot < 0 ? -1 : uniforms[slot].Location;
+    }
+
+    // Номер ячейки uniform в таблице, -1 если такого uniform нет.
+    // Нужен, чтобы держать рядом с таблицей свои данные (например, последнее значение).
+    int FindUniformSlot(ShaderParam param) const
+    {
+        return FindSlot(uniforms, param.Hash);
+    }
+
+    const Entry& GetUniform(int slot) const
+    {
+        return uniforms[slot];
+    }
+
+    size_t UniformTableSize() const
+    {
+        return uniforms.size();
+    }
+
+    GLint FindAttribute(ShaderParam param) const
+    {
+        const int slot = FindSlot(attributes, param.Hash);
+        return slot < 0 ? -1 : attributes[slot].Location;
+    }
+
+    size_t UniformCount() const
+    {
+        return uniformCount;
+    }
+
+    size_t AttributeCount() const
+    {
+        return attributeCount;
+    }
+
+private:
+    static int FindSlot(const std::vector<Entry>& table, std::uint64_t hash)
+    {
+        if (table.empty()) {
+            return -1;
+        }
+        const size_t mask = table.size() - 1;
+        for (size_t i = hash & mask;; i = (i + 1) & mask) {
+            if (table[i].Hash == hash) {
+                return static_cast<int>(i);
+            }
+            if (table[i].Hash == 0) {
+                return -1;
+            }
+        }
+    }
+
+    static void Insert(std::vector<Entry>& table, const Entry& entry);
+    static void Allocate(std::vector<Entry>& table, GLint count);
+
+    std::vector<Entry> uniforms;
+    std::vector<Entry> attributes;
+    size_t uniformCount = 0;
+    size_t attributeCount = 0;
+};
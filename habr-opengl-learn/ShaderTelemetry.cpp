@@ -0,0 +1,158 @@
+#include "ShaderTelemetry.h"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+// deque - чтобы ссылки на записи не ломались при добавлении новых
+static std::deque<ShaderTiming> timings;
+static double budget = 0.0;
+static unsigned overBudget = 0;
+
+double ShaderTelemetry::NowMs()
+{
+    using namespace std::chrono;
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+size_t ShaderTelemetry::Begin(const std::string& name, unsigned features, bool reload)
+{
+    timings.emplace_back();
+    ShaderTiming& timing = timings.back();
+    timing.Name = name;
+    timing.Features = features;
+    timing.Reload = reload;
+    timing.StartMs = NowMs();
+    return timings.size() - 1;
+}
+
+ShaderTiming& ShaderTelemetry::Get(size_t id)
+{
+    return timings[id];
+}
+
+void ShaderTelemetry::End(size_t id, bool linked)
+{
+    ShaderTiming& timing = timings[id];
+    timing.Linked = linked;
+    timing.WallMs = NowMs() - timing.StartMs;
+
+    if (budget > 0.0 && timing.CompileMs + timing.LinkMs > budget) {
+        timing.OverBudget = true;
+        ++overBudget;
+        std::cout << "SHADER::BUDGET::EXCEEDED " << timing.Name << " compile+link="
+            << timing.CompileMs + timing.LinkMs << "ms budget=" << budget << "ms" << std::endl;
+    }
+}
+
+void ShaderTelemetry::SetBudget(double milliseconds)
+{
+    budget = milliseconds;
+}
+
+double ShaderTelemetry::GetBudget()
+{
+    return budget;
+}
+
+unsigned ShaderTelemetry::OverBudgetCount()
+{
+    return overBudget;
+}
+
+static double BuildMs(const ShaderTiming& timing)
+{
+    return timing.CompileMs + timing.LinkMs;
+}
+
+void ShaderTelemetry::PrintTable()
+{
+    std::vector<const ShaderTiming*> sorted;
+    for (const ShaderTiming& timing : timings) {
+        sorted.push_back(&timing);
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const ShaderTiming* a, const ShaderTiming* b) {
+        return BuildMs(*a) > BuildMs(*b);
+    });
+
+    double read = 0.0;
+    double lookup = 0.0;
+    double compile = 0.0;
+    double link = 0.0;
+    std::cout << "    read  lookup compile    link    wall  source   log flags program" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    for (const ShaderTiming* timing : sorted) {
+        std::cout << std::setw(8) << timing->ReadMs
+            << std::setw(8) << timing->CacheLookupMs
+            << std::setw(8) << timing->CompileMs
+            << std::setw(8) << timing->LinkMs
+            << std::setw(8) << timing->WallMs
+            << std::setw(8) << timing->SourceBytes
+            << std::setw(6) << timing->InfoLogBytes << ' '
+            << (timing->CacheHit ? 'C' : '-')
+            << (timing->Spirv ? 'S' : '-')
+            << (timing->Reload ? 'R' : '-')
+            << (timing->Linked ? '-' : 'E')
+            << (timing->OverBudget ? '!' : '-') << ' '
+            << timing->Name << " [" << timing->Features << "]" << std::endl;
+        read += timing->ReadMs;
+        lookup += timing->CacheLookupMs;
+        compile += timing->CompileMs;
+        link += timing->LinkMs;
+    }
+    std::cout << std::setw(8) << read << std::setw(8) << lookup << std::setw(8) << compile << std::setw(8) << link
+        << "  total, " << timings.size() << " programs, " << overBudget << " over budget" << std::endl;
+    std::cout << "flags: C - binary cache hit, S - SPIR-V, R - reload, E - link failed, ! - over budget" << std::endl;
+    std::cout << std::defaultfloat;
+}
+
+static void WriteJsonString(std::ostream& out, const std::string& text)
+{
+    out << '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out << '\\' << c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20) {
+            out << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec << std::setfill(' ');
+        }
+        else {
+            out << c;
+        }
+    }
+    out << '"';
+}
+
+bool ShaderTelemetry::WriteJson(const std::string& path)
+{
+    std::ofstream out(path);
+    if (!out) {
+        std::cout << "ERROR::SHADER::TELEMETRY::CANNOT_WRITE " << path << std::endl;
+        return false;
+    }
+
+    out << "{\n  \"budgetMs\": " << budget << ",\n  \"overBudget\": " << overBudget << ",\n  \"programs\": [";
+    for (size_t i = 0; i < timings.size(); ++i) {
+        const ShaderTiming& timing = timings[i];
+        out << (i == 0 ? "\n" : ",\n") << "    {\"name\": ";
+        WriteJsonString(out, timing.Name);
+        out << ", \"features\": " << timing.Features
+            << ", \"reload\": " << (timing.Reload ? "true" : "false")
+            << ", \"spirv\": " << (timing.Spirv ? "true" : "false")
+            << ", \"cacheHit\": " << (timing.CacheHit ? "true" : "false")
+            << ", \"linked\": " << (timing.Linked ? "true" : "false")
+            << ", \"overBudget\": " << (timing.OverBudget ? "true" : "false")
+            << ", \"readMs\": " << timing.ReadMs
+            << ", \"cacheLookupMs\": " << timing.CacheLookupMs
+            << ", \"compileMs\": " << timing.CompileMs
+            << ", \"linkMs\": " << timing.LinkMs
+            << ", \"wallMs\": " << timing.WallMs
+            << ", \"sourceBytes\": " << timing.SourceBytes
+            << ", \"infoLogBytes\": " << timing.InfoLogBytes << "}";
+    }
+    out << "\n  ]\n}\n";
+    return static_cast<bool>(out);
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Время сборки одной программы, по фазам. Все времена - в миллисекундах.
+// Compile и Link - время потока отрисовки внутри вызовов драйвера, включая ожидание статуса
+// линковки. При параллельной сборке (KHR_parallel_shader_compile) основная работа идет в потоках
+// драйвера, и ее видно только в Wall - от постановки в очередь до готовой программы.
+struct ShaderTiming {
+    // "vertex.glsl + fragment.glsl" или путь одной стадии конвейера
+    std::string Name;
+    unsigned Features = 0;
+    bool Reload = false;
+    bool Spirv = false;
+    bool CacheHit = false;
+    bool Linked = false;
+    bool OverBudget = false;
+
+    double ReadMs = 0.0;
+    double CacheLookupMs = 0.0;
+    double CompileMs = 0.0;
+    double LinkMs = 0.0;
+    double WallMs = 0.0;
+
+    // Развернутый исходник (или модули SPIR-V) и логи компиляции и линковки
+    size_t SourceBytes = 0;
+    size_t InfoLogBytes = 0;
+
+    // Момент постановки в очередь, для Wall
+    double StartMs = 0.0;
+};
+
+// Телеметрия сборки шейдеров: куда уходит время старта.
+// Отчет пишется в JSON при выходе и печатается таблицей по F4.
+// Программы, у которых Compile + Link больше бюджета, помечаются - на CI это видно по коду выхода.
+namespace ShaderTelemetry {
+    double NowMs();
+
+    // Новая запись, возвращает ее номер. Ссылки из Get остаются верными до конца работы.
+    size_t Begin(const std::string& name, unsigned features, bool reload);
+    ShaderTiming& Get(size_t id);
+
+    // Сборка закончилась (или взята из кэша): считает Wall и сверяет с бюджетом
+    void End(size_t id, bool linked);
+
+    // Бюджет на Compile + Link одной программы, 0 - без бюджета
+    void SetBudget(double milliseconds);
+    double GetBudget();
+    unsigned OverBudgetCount();
+
+    // Таблица по убыванию Compile + Link
+    void PrintTable();
+
+    bool WriteJson(const std::string& path);
+}
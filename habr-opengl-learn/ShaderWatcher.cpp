@@ -0,0 +1,319 @@
+#include "ShaderWatcher.h"
+#include "ShaderCompiler.h"
+#include <algorithm>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#elif defined(__linux__)
+#include <sys/inotify.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+// "shader.glsl" и "./shader.glsl" должны совпадать - приводим путь к виду каталог/имя
+static void SplitPath(const std::string& path, std::string& directory, std::string& name)
+{
+    const size_t slash = path.find_last_of("/\\");
+    if (slash == std::string::npos) {
+        directory = ".";
+        name = path;
+    } else {
+        directory = path.substr(0, slash);
+        name = path.substr(slash + 1);
+    }
+}
+
+static std::string NormalizePath(const std::string& path)
+{
+    std::string directory, name;
+    SplitPath(path, directory, name);
+    return directory + "/" + name;
+}
+
+#if defined(_WIN32)
+
+struct ShaderWatcher::Platform {
+    struct DirectoryWatch {
+        std::string directory;
+        HANDLE handle;
+        OVERLAPPED overlapped;
+        DWORD buffer[2048];
+    };
+
+    // Будит поток: либо пора выходить, либо добавился каталог
+    HANDLE wakeEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    std::vector<std::unique_ptr<DirectoryWatch>> watches;
+    bool stop = false;
+
+    ~Platform()
+    {
+        for (auto& watch : watches) {
+            CancelIo(watch->handle);
+            CloseHandle(watch->overlapped.hEvent);
+            CloseHandle(watch->handle);
+        }
+        CloseHandle(wakeEvent);
+    }
+
+    static bool Arm(DirectoryWatch& watch)
+    {
+        return ReadDirectoryChangesW(
+            watch.handle, watch.buffer, sizeof(watch.buffer), FALSE,
+            FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_FILE_NAME,
+            NULL, &watch.overlapped, NULL
+        ) != 0;
+    }
+
+    void Open(const std::string& directory)
+    {
+        std::unique_ptr<DirectoryWatch> watch(new DirectoryWatch());
+        watch->directory = directory;
+        watch->handle = CreateFileA(
+            directory.c_str(), FILE_LIST_DIRECTORY,
+            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+            OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL
+        );
+        if (watch->handle == INVALID_HANDLE_VALUE) {
+            std::cout << "WARNING::SHADER_WATCHER::CANNOT_WATCH " << directory << std::endl;
+            return;
+        }
+        watch->overlapped.hEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+        if (Arm(*watch)) {
+            watches.push_back(std::move(watch));
+        }
+    }
+};
+
+ShaderWatcher::~ShaderWatcher()
+{
+    if (thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            platform->stop = true;
+        }
+        SetEvent(platform->wakeEvent);
+        thread.join();
+    }
+}
+
+void ShaderWatcher::AddDirectory(const std::string& directory)
+{
+    // Хэндлы каталогов открывает сам поток наблюдения, здесь его только будим
+    SetEvent(platform->wakeEvent);
+}
+
+void ShaderWatcher::Run()
+{
+    size_t opened = 0;
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (platform->stop) {
+                return;
+            }
+            for (; opened < directories.size(); ++opened) {
+                platform->Open(directories[opened]);
+            }
+        }
+
+        std::vector<HANDLE> handles;
+        handles.push_back(platform->wakeEvent);
+        for (auto& watch : platform->watches) {
+            handles.push_back(watch->overlapped.hEvent);
+        }
+
+        const DWORD result = WaitForMultipleObjects(static_cast<DWORD>(handles.size()), handles.data(), FALSE, INFINITE);
+        const DWORD index = result - WAIT_OBJECT_0;
+        if (index == 0 || index >= handles.size()) {
+            continue;
+        }
+
+        Platform::DirectoryWatch& watch = *platform->watches[index - 1];
+        DWORD bytes = 0;
+        if (GetOverlappedResult(watch.handle, &watch.overlapped, &bytes, FALSE) && bytes > 0) {
+            const char* cursor = reinterpret_cast<const char*>(watch.buffer);
+            for (;;) {
+                const FILE_NOTIFY_INFORMATION* info = reinterpret_cast<const FILE_NOTIFY_INFORMATION*>(cursor);
+                char name[MAX_PATH] = {};
+                WideCharToMultiByte(CP_UTF8, 0, info->FileName, info->FileNameLength / sizeof(WCHAR), name, MAX_PATH - 1, NULL, NULL);
+                OnFileChanged(watch.directory + "/" + name);
+                if (info->NextEntryOffset == 0) {
+                    break;
+                }
+                cursor += info->NextEntryOffset;
+            }
+        }
+        Platform::Arm(watch);
+    }
+}
+
+#elif defined(__linux__)
+
+struct ShaderWatcher::Platform {
+    int inotify = inotify_init1(IN_CLOEXEC);
+    // Пишем сюда байт, чтобы разбудить poll() при выходе
+    int stopPipe[2] = { -1, -1 };
+    std::map<int, std::string> descriptors;
+
+    Platform()
+    {
+        if (pipe(stopPipe) != 0) {
+            stopPipe[0] = stopPipe[1] = -1;
+        }
+    }
+
+    ~Platform()
+    {
+        close(inotify);
+        close(stopPipe[0]);
+        close(stopPipe[1]);
+    }
+};
+
+ShaderWatcher::~ShaderWatcher()
+{
+    if (thread.joinable()) {
+        const char stop = 1;
+        if (write(platform->stopPipe[1], &stop, 1) == 1) {
+            thread.join();
+        } else {
+            thread.detach();
+        }
+    }
+}
+
+void ShaderWatcher::AddDirectory(const std::string& directory)
+{
+    // Редакторы часто сохраняют через временный файл и rename - ловим и IN_MOVED_TO
+    const int descriptor = inotify_add_watch(platform->inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (descriptor < 0) {
+        std::cout << "WARNING::SHADER_WATCHER::CANNOT_WATCH " << directory << std::endl;
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    platform->descriptors[descriptor] = directory;
+}
+
+void ShaderWatcher::Run()
+{
+    alignas(inotify_event) char buffer[4096];
+    pollfd fds[2] = {
+        { platform->inotify, POLLIN, 0 },
+        { platform->stopPipe[0], POLLIN, 0 }
+    };
+
+    for (;;) {
+        if (poll(fds, 2, -1) < 0) {
+            continue;
+        }
+        if (fds[1].revents & POLLIN) {
+            return;
+        }
+
+        const ssize_t length = read(platform->inotify, buffer, sizeof(buffer));
+        for (ssize_t offset = 0; offset < length;) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            if (event->len > 0) {
+                std::string directory;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    directory = platform->descriptors[event->wd];
+                }
+                OnFileChanged(directory + "/" + event->name);
+            }
+            offset += sizeof(inotify_event) + event->len;
+        }
+    }
+}
+
+#else
+
+struct ShaderWatcher::Platform {};
+
+ShaderWatcher::~ShaderWatcher() {}
+
+void ShaderWatcher::AddDirectory(const std::string& directory) {}
+
+void ShaderWatcher::Run() {}
+
+#endif
+
+ShaderWatcher& ShaderWatcher::Instance()
+{
+    static ShaderWatcher watcher;
+    return watcher;
+}
+
+ShaderWatcher::ShaderWatcher()
+    : platform(new Platform()), dirty(false)
+{
+}
+
+void ShaderWatcher::Watch(Shader* shader, const std::string& path)
+{
+    std::string directory, name;
+    SplitPath(path, directory, name);
+
+    std::vector<Shader*>& shaders = watched[directory + "/" + name];
+    if (std::find(shaders.begin(), shaders.end(), shader) == shaders.end()) {
+        shaders.push_back(shader);
+    }
+
+    bool added = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (std::find(directories.begin(), directories.end(), directory) == directories.end()) {
+            directories.push_back(directory);
+            added = true;
+        }
+    }
+    if (added) {
+        AddDirectory(directory);
+    }
+
+    if (!thread.joinable()) {
+        thread = std::thread(&ShaderWatcher::Run, this);
+    }
+}
+
+void ShaderWatcher::OnFileChanged(const std::string& path)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    changed.push_back(NormalizePath(path));
+    dirty.store(true, std::memory_order_release);
+}
+
+void ShaderWatcher::Poll()
+{
+    // Обычный кадр: одно атомарное чтение и выход
+    if (!dirty.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    std::vector<std::string> paths;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        paths.swap(changed);
+        dirty.store(false, std::memory_order_relaxed);
+    }
+
+    // Один шейдер может зависеть от нескольких изменившихся файлов - пересобираем его один раз
+    std::vector<Shader*> reload;
+    for (const std::string& path : paths) {
+        auto found = watched.find(path);
+        if (found == watched.end()) {
+            continue;
+        }
+        for (Shader* shader : found->second) {
+            if (std::find(reload.begin(), reload.end(), shader) == reload.end()) {
+                reload.push_back(shader);
+            }
+        }
+    }
+
+    for (Shader* shader : reload) {
+        ShaderCompiler::Instance().Reload(shader);
+    }
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include "Shader.h"
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Горячая перезагрузка шейдеров.
+// Отдельный поток ждет событий файловой системы (inotify на Linux, ReadDirectoryChangesW на Windows)
+// и только выставляет флаг. Poll() на потоке отрисовки проверяет его одним атомарным чтением,
+// так что пока файлы не трогают, кадр за это ничего не платит - никаких stat() в Update.
+class ShaderWatcher
+{
+public:
+    static ShaderWatcher& Instance();
+
+    ~ShaderWatcher();
+
+    // Следить за файлом, из которого собран shader
+    void Watch(Shader* shader, const std::string& path);
+
+    // Ставит изменившиеся шейдеры на пересборку в ShaderCompiler. Вызывается раз в кадр.
+    void Poll();
+
+private:
+    struct Platform;
+
+    ShaderWatcher();
+
+    void Run();
+    void AddDirectory(const std::string& directory);
+    // Вызывается потоком наблюдения
+    void OnFileChanged(const std::string& path);
+
+    std::unique_ptr<Platform> platform;
+    std::thread thread;
+    std::atomic<bool> dirty;
+
+    // Защищает changed и directories, которые трогают оба потока
+    std::mutex mutex;
+    std::vector<std::string> changed;
+    std::vector<std::string> directories;
+
+    // Только поток отрисовки
+    std::map<std::string, std::vector<Shader*>> watched;
+};
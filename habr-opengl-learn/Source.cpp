@@ -1,9 +1,27 @@
+#include "GeometryArena.h"
 #include "HelloCamera19.h"
+#include "ShaderArchive.h"
+#include "ShaderBinaryCache.h"
+#include "ShaderCompiler.h"
+#include "ShaderLibrary.h"
+#include "ShaderPreprocessor.h"
+#include "ShaderTelemetry.h"
+#include "ShaderWatcher.h"
+#include "Stats.h"
+#include "Tools.h"
 
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mode) {
 	if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
 		glfwSetWindowShouldClose(window, GL_TRUE);
 	}
+	// Статистика последнего кадра
+	if (key == GLFW_KEY_F3 && action == GLFW_PRESS) {
+		Stats::Print();
+	}
+	// Время сборки шейдеров по программам
+	if (key == GLFW_KEY_F4 && action == GLFW_PRESS) {
+		ShaderTelemetry::PrintTable();
+	}
 	Lesson19::KeyCallback(key, action);
 }
 
@@ -16,7 +34,17 @@ void scroll_callback(GLFWwindow* window, double xoffset, double yoffset) {
 }
 
 
-int main() {
+int main(int argc, char** argv) {
+
+	// Офлайн-инструменты (упаковка шейдеров и т.п.) работают без окна
+	RunOptions options;
+	if (!ParseRunOptions(argc, argv, options)) {
+		return RunTool(argc, argv);
+	}
+	ShaderTelemetry::SetBudget(options.ShaderBudgetMs);
+
+	// Если рядом лежит упакованный архив, шейдеры берутся из него
+	ShaderArchive::Mount("shaders.pak");
 
 	if (!glfwInit()) {
 		std::cout << "Failed to initialize GLFW system!" << std::endl;
@@ -85,12 +113,24 @@ int main() {
 	// Захватываем колесико
 	glfwSetScrollCallback(window, scroll_callback);
 
-	Lesson19::Begin();
+	// В стресс-режиме время кадра не должно упираться в vsync
+	if (options.StressCubes > 0) {
+		glfwSwapInterval(0);
+	}
+	Lesson19::Begin(options.StressCubes);
+	// Все шейдеры урока уже в очереди - отдаем их драйверу разом
+	ShaderCompiler::Instance().Flush();
 
 	while(!glfwWindowShouldClose(window))
 	{
+		Stats::BeginFrame();
 		glfwPollEvents();
 
+		// Правленые на диске шейдеры уходят на пересборку
+		ShaderWatcher::Instance().Poll();
+		// Забираем шейдеры, которые успели собраться, окно при этом уже рисуется
+		ShaderCompiler::Instance().Poll();
+
 		glClearColor(.2f, .3f, .3f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -100,9 +140,19 @@ int main() {
 		glfwSwapBuffers(window);
 	}
 
+	// Статистика кэша шейдеров - по ней проверяем hit rate на CI
+	ShaderBinaryCache::PrintStats();
+	ShaderLibrary::PrintStats();
+	ShaderPreprocessor::PrintStats();
+	GeometryArena::PrintStats();
+	Stats::Print();
+	ShaderTelemetry::WriteJson(options.ShaderReportPath);
+
+	GeometryArena::Release();
 	// @TODO: don't forget deallocate buffers
 
 	glfwTerminate();
 
-	return 0;
+	// CI ловит регрессии времени старта по коду выхода
+	return ShaderTelemetry::OverBudgetCount() > 0 ? 3 : 0;
 }
@@ -0,0 +1,96 @@
+#include "Spirv.h"
+#include "ShaderPreprocessor.h"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+#ifdef _WIN32
+#include <direct.h>
+#define MAKE_DIRECTORY(path) _mkdir(path)
+#else
+#include <sys/stat.h>
+#define MAKE_DIRECTORY(path) mkdir(path, 0755)
+#endif
+
+static const char* MODULE_DIRECTORY = "spirv";
+static const std::uint32_t SPIRV_MAGIC = 0x07230203;
+
+bool Spirv::IsSupported()
+{
+    return GLEW_VERSION_4_6 || GLEW_ARB_gl_spirv;
+}
+
+std::string Spirv::ModulePath(const std::string& glslPath, unsigned features)
+{
+    // Подкаталоги сплющиваем - все модули лежат в одной папке
+    std::string name = glslPath;
+    for (char& c : name) {
+        if (c == '/' || c == '\\') {
+            c = '_';
+        }
+    }
+
+    std::ostringstream path;
+    path << MODULE_DIRECTORY << '/' << name << '.' << std::hex << features << ".spv";
+    return path.str();
+}
+
+bool Spirv::IsValidModule(const MappedFile& module)
+{
+    if (!module.IsOpen() || module.Size() < 5 * sizeof(std::uint32_t) || module.Size() % sizeof(std::uint32_t) != 0) {
+        return false;
+    }
+    // Модули с другим порядком байт glslang не выпускает, их не поддерживаем
+    return *reinterpret_cast<const std::uint32_t*>(module.Data()) == SPIRV_MAGIC;
+}
+
+GLuint Spirv::IssueSpecialize(GLenum type, const MappedFile& module)
+{
+    GLuint shader = glCreateShader(type);
+    glShaderBinary(1, &shader, GL_SHADER_BINARY_FORMAT_SPIR_V, module.Data(), static_cast<GLsizei>(module.Size()));
+    // Константы специализации не используем - модуль берется как есть
+    if (GLEW_VERSION_4_6) {
+        glSpecializeShader(shader, "main", 0, nullptr, nullptr);
+    }
+    else {
+        glSpecializeShaderARB(shader, "main", 0, nullptr, nullptr);
+    }
+    return shader;
+}
+
+int Spirv::CompileModule(const std::string& glslPath, const char* stage, unsigned features)
+{
+    const ShaderSource source = ShaderPreprocessor::Process(glslPath, features, false);
+    if (source.Strings.empty()) {
+        return 1;
+    }
+
+    MAKE_DIRECTORY(MODULE_DIRECTORY);
+    const std::string output = ModulePath(glslPath, features);
+    // Развернутый исходник - glslang не знает наших #include
+    const std::string expanded = output + "." + stage;
+    {
+        std::ofstream file(expanded, std::ios::binary);
+        const std::string code = source.Join();
+        file.write(code.data(), code.size());
+        if (!file) {
+            std::cout << "ERROR::SPIRV::CANNOT_WRITE " << expanded << std::endl;
+            return 1;
+        }
+    }
+
+    // -G: SPIR-V для OpenGL. --aml/--amb раздают location и binding тем uniform и varying,
+    // у которых их нет в исходнике - для gl_spirv они обязательны.
+    const std::string command = std::string("glslangValidator -G -S ") + stage
+        + " --aml --amb -o \"" + output + "\" \"" + expanded + "\"";
+    const int result = std::system(command.c_str());
+    std::remove(expanded.c_str());
+    if (result != 0) {
+        std::cout << "ERROR::SPIRV::COMPILATION_FAILED " << glslPath << std::endl;
+        return 1;
+    }
+
+    std::cout << "Compiled " << glslPath << " -> " << output << std::endl;
+    return 0;
+}
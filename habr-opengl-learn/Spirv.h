@@ -0,0 +1,29 @@
+#pragma once
+#include "Common.h"
+#include "MappedFile.h"
+#include <cstdint>
+#include <string>
+
+// Предсобранные модули SPIR-V (GL_ARB_gl_spirv, ядро с OpenGL 4.6).
+// Драйверу не нужно разбирать текст GLSL - только специализировать готовый модуль.
+//
+// Модули собираются офлайн из тех же .glsl, что и обычные шейдеры:
+//   habr-opengl-learn --compile-spirv <features> <vertex.glsl> <fragment.glsl>
+// Исходник сначала проходит через ShaderPreprocessor (#include, дефайны перестановки),
+// затем через glslangValidator (должен быть в PATH). Модуль ложится в Spirv::ModulePath.
+namespace Spirv {
+    // Расширение есть у драйвера и функции загружены
+    bool IsSupported();
+
+    // Путь модуля для исходника и маски перестановки: spirv/<имя>.<маска>.spv
+    std::string ModulePath(const std::string& glslPath, unsigned features);
+
+    // Модуль похож на SPIR-V: магическое число и целое количество слов
+    bool IsValidModule(const MappedFile& module);
+
+    // glShaderBinary + glSpecializeShader. Статус проверяется как у обычной компиляции.
+    GLuint IssueSpecialize(GLenum type, const MappedFile& module);
+
+    // Офлайн-сборка одного модуля. stage - "vert" или "frag", как у glslangValidator -S.
+    int CompileModule(const std::string& glslPath, const char* stage, unsigned features);
+}
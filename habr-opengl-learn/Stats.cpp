@@ -0,0 +1,47 @@
+#include "Stats.h"
+#include <iostream>
+
+FrameStats Stats::Frame;
+FrameStats Stats::Last;
+
+void Stats::BeginFrame()
+{
+    Last = Frame;
+    Frame = FrameStats();
+}
+
+void Stats::Print()
+{
+    std::cout << "FrameStats:"
+        << " locationQueries=" << Last.LocationQueries
+        << " locationStringLookups=" << Last.LocationStringLookups
+        << " programBinds=" << Last.ProgramBinds
+        << " programBindsSkipped=" << Last.ProgramBindsSkipped
+        << " pipelineBinds=" << Last.PipelineBinds
+        << " pipelineBindsSkipped=" << Last.PipelineBindsSkipped
+        << " vertexArrayBinds=" << Last.VertexArrayBinds
+        << " vertexArrayBindsSkipped=" << Last.VertexArrayBindsSkipped
+        << " drawCalls=" << Last.DrawCalls
+        << " triangles=" << Last.Triangles
+        << " instances=" << Last.Instances
+        << " indirectCommands=" << Last.IndirectCommands
+        << " queuedPackets=" << Last.QueuedPackets
+        << " programSwitches=" << Last.ProgramSwitches
+        << " textureSwitches=" << Last.TextureSwitches
+        << " vertexArraySwitches=" << Last.VertexArraySwitches
+        << " textureBinds=" << Last.TextureBinds
+        << " textureBindsSkipped=" << Last.TextureBindsSkipped
+        << " trianglesCulled=" << Last.TrianglesCulled
+        << " lodDraws=";
+    for (unsigned i = 0; i < FrameStats::LOD_LEVELS; ++i) {
+        std::cout << (i ? "/" : "") << Last.LodDraws[i];
+    }
+    std::cout
+        << " uniformUploads=" << Last.UniformUploads
+        << " uniformUploadsSkipped=" << Last.UniformUploadsSkipped
+        << " uniformBlockBinds=" << Last.UniformBlockBinds
+        << " ringBytes=" << Last.RingBytes
+        << " ringWaitMicroseconds=" << Last.RingWaitMicroseconds
+        << " ringOverflows=" << Last.RingOverflows
+        << std::endl;
+}
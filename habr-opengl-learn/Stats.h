@@ -0,0 +1,62 @@
+#pragma once
+
+// Счетчики одного кадра. Подсистемы увеличивают поля Stats::Frame,
+// в начале кадра они переносятся в Stats::Last и обнуляются.
+struct FrameStats {
+    // Сколько уровней LOD различает статистика, см. MeshLod
+    static const unsigned LOD_LEVELS = 5;
+
+    // Запросы позиций uniform/attribute у драйвера (glGetUniformLocation, glGetAttribLocation)
+    unsigned LocationQueries = 0;
+    // Поиск позиции по строке - имя хэшируется во время работы
+    unsigned LocationStringLookups = 0;
+    // glUseProgram: вызванные и пропущенные, потому что программа уже привязана
+    unsigned ProgramBinds = 0;
+    unsigned ProgramBindsSkipped = 0;
+    // glBindProgramPipeline: вызванные и пропущенные
+    unsigned PipelineBinds = 0;
+    unsigned PipelineBindsSkipped = 0;
+    // glBindVertexArray из GeometryArena: вызванные и пропущенные
+    unsigned VertexArrayBinds = 0;
+    unsigned VertexArrayBindsSkipped = 0;
+    // Отрисовки GeometryArena и их треугольники
+    unsigned DrawCalls = 0;
+    unsigned Triangles = 0;
+    // Экземпляры, нарисованные GeometryArena::DrawInstanced и DrawBatch
+    unsigned Instances = 0;
+    // Команды внутри glMultiDrawElementsIndirect - сам вызов считается в DrawCalls один раз
+    unsigned IndirectCommands = 0;
+    // CommandExecutor (RenderQueue, буферы команд): нарисованные пакеты и смены программы,
+    // набора текстур и пула арены (VAO) между соседними
+    unsigned QueuedPackets = 0;
+    unsigned ProgramSwitches = 0;
+    unsigned TextureSwitches = 0;
+    unsigned VertexArraySwitches = 0;
+    // glBindTexture из CommandExecutor: вызванные и пропущенные, потому что текстура уже в блоке
+    unsigned TextureBinds = 0;
+    unsigned TextureBindsSkipped = 0;
+    // Треугольники, отброшенные отсечением кластеров (MeshletCulling) до отрисовки
+    unsigned TrianglesCulled = 0;
+    // Сколько отрисовок пришлось на каждый уровень LOD
+    unsigned LodDraws[LOD_LEVELS] = {};
+    // glUniform*: вызванные и пропущенные, потому что значение не поменялось
+    unsigned UniformUploads = 0;
+    unsigned UniformUploadsSkipped = 0;
+    // glBindBufferRange блока ModelBlock на участок FrameRing
+    unsigned UniformBlockBinds = 0;
+    // FrameRing: записано байт за кадр и сколько ждали забор участка, который GPU еще читал
+    unsigned RingBytes = 0;
+    unsigned RingWaitMicroseconds = 0;
+    // Выделения, которым не хватило участка кадра FrameRing: отрисовка пропущена или обошлась без этих данных
+    unsigned RingOverflows = 0;
+};
+
+namespace Stats {
+    extern FrameStats Frame;
+    extern FrameStats Last;
+
+    void BeginFrame();
+
+    // Печатает последний завершенный кадр
+    void Print();
+}
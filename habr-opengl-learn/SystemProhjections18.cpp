@@ -1,8 +1,7 @@
 #include "SystemProhjections18.h"
 #include "MaterialWithMesh.h"
+#include "ProceduralGeometry.h"
 
-static GLuint VAO;
-static GLuint EBO;
 static const GLfloat FOV = 45.f;
 static glm::vec3 cubesPositions[] = {
     glm::vec3(0.0f,  0.0f,  0.0f),
@@ -19,22 +18,17 @@ static glm::vec3 cubesPositions[] = {
 
 class TriangleWithTexMaterialAndMatrices : public MaterialWithMesh {
 protected:
-    const std::vector<GLfloat> vertices = {
-        // Позиции          // Цвета             // Текстурные координаты
-     0.5f,  0.5f, 0.0f,   1.0f, 0.0f, 0.0f,   1.0f, 1.0f,   // Верхний правый
-     0.5f, -0.5f, 0.0f,   0.0f, 1.0f, 0.0f,   1.0f, 0.0f,   // Нижний правый
-    -0.5f, -0.5f, 0.0f,   0.0f, 0.0f, 1.0f,   0.0f, 0.0f,   // Нижний левый
-    -0.5f,  0.5f, 0.0f,   1.0f, 1.0f, 0.0f,   0.0f, 1.0f    // Верхний левый
-    };
-
-    const GLuint quadIndicies[6] = {
-         0, 1, 3,   // Первый треугольник
-         1, 2, 3    // Второй треугольник
-    };
+    // Квадрат из ProceduralGeometry, позиции, цвета и текстурные координаты подряд - считается при компиляции
+    static constexpr auto quad = Procedural::Quad();
+    static constexpr auto vertices = Procedural::Interleave<VertexSemantic::Position, VertexSemantic::Color, VertexSemantic::TexCoord>(quad);
+
+    // Цвет в байтах, UV в 16 битах: 32 -> 16 байт на вершину
+    const VertexLayout layout = VertexLayout().Add(0, VertexFormat::Float3).Add(1, VertexFormat::Float3).Add(2, VertexFormat::Float2);
+    const VertexLayout packedLayout = VertexLayout().Add(0, VertexFormat::Half3).Add(1, VertexFormat::UNorm8x4).Add(2, VertexFormat::UNorm16x2);
 
 public:
     virtual void LoadShader() {
-        LoadShaderImpl("shader-1.8-vertexProjections.glsl", "shader-16-fragmentTexQuadMix.glsl");
+        LoadShaderImpl("shader-1.8-vertexProjections.glsl", "shader-fragmentTextured.glsl", SHADER_FEATURE_TWO_TEXTURES);
     }
 
     virtual void FillVerticesBuffers() {
@@ -43,22 +37,18 @@ public:
            GL_DYNAMIC_DRAW: данные будут меняться довольно часто;
            GL_STREAM_DRAW: данные будут меняться при каждой отрисовке.
          */
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), &vertices[0], GL_STATIC_DRAW);
-
-        glGenBuffers(1, &EBO);
-
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(quadIndicies), quadIndicies, GL_STATIC_DRAW);
+        FillIndexedBuffers(vertices, layout, packedLayout, quad.Indices, "quad");
     }
 
     virtual void DrawShape() override {
         /*
             Первый аргумент описывает примитив, который мы хотим отрисовать, также как и в glDrawArrays.
             Второй аргумент — это количество элементов, которое мы хотим отрисовать. Мы указали 6 индексов, поэтому мы передаем функции 6 вершин.
-            Третий аргумент — это тип данных индексов, в нашем случае — это GL_UNSIGNED_INT.
-            Последний аргумент позволяет задать нам смещение в EBO (или передать сам массив с индексами, но при использовании EBO так не делают), поэтому мы указываем просто 0.
+            Третий аргумент — это тип данных индексов, у четырех вершин хватает GL_UNSIGNED_SHORT.
+            Последний аргумент позволяет задать нам смещение в EBO (или передать сам массив с индексами, но при использовании EBO так не делают).
+            EBO общий на все меши, поэтому смещение - начало индексов квадрата, а glDrawElementsBaseVertex еще и сдвигает их на первую вершину квадрата.
         */
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+        DrawIndexed();
     }
 
     virtual void SetupVerticesData() override {
@@ -73,120 +63,24 @@ public:
             * Конфигурация атрибутов, выполненная через glVertexAttribPointer.
             * VBO ассоциированные с вершинными атрибутами с помощью glVertexAttribPointer
         */
-        glGenVertexArrays(1, &VAO);
-        // =================================   Bind Vertex array FIRST =================================
-        glBindVertexArray(VAO);
-
-        /*
-         * Создаем просто буфер типа ARRAY (с сырыми данными?) и складываем туда вертексы
-         */
-        GLuint VBO;
-        glGenBuffers(1, &VBO);
-
-        // Then...
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-        // В зависимости от фигуры - вызываем отрисовку
+        // VAO, VBO и EBO общие для всех мешей с этим packedLayout - их заводит и настраивает GeometryArena
         this->FillVerticesBuffers();
-
-        // Размечаем память в шейдере
-        /**
-            Первый аргумент описывает какой аргумент шейдера мы хотим настроить. Мы хотим специфицировать значение аргумента position, позиция которого была указана следующим образом: layout (location = 0).
-            Следующий аргумент описывает размер аргумента в шейдере. Поскольку мы использовали vec3 то мы указываем 3.
-            Третий аргумент описывает используемый тип данных. Мы указываем GL_FLOAT, поскольку vec в шейдере использует числа с плавающей точкой.
-            Четвертый аргумент указывает необходимость нормализовать входные данные. Если мы укажем GL_TRUE, то все данные будут расположены между 0 (-1 для знаковых значений) и 1. Нам нормализация не требуется, поэтому мы оставляем GL_FALSE;
-            Пятый аргумент называется шагом и описывает расстояние между наборами данных. Мы также можем указать шаг равный 0 и тогда OpenGL высчитает шаг (работает только с плотно упакованными наборами данных). Как выручить существенную пользу от этого аргумента мы рассмотрим позже.
-            Последний параметр имеет тип GLvoid* и поэтому требует такое странное приведение типов. Это смещение начала данных в буфере. У нас буфер не имеет смещения и поэтому мы указываем 0.
-        */
-        /*
-        layout(position=0),
-        vec3 = 3,
-        GLFLOAT - тк вектор с флоатами,
-        GL_FALSE - не нормализовывать,
-        8 * sizeof(GLfloat) - ШАГ (или общее кол-во данных для вершины) - шесть флоатов, тк у нас 3 на позицию + 3 на цвет,
-        (GLvoid*)0 - Смещение - 0, тк мы читаем с нуля три флоат вершины и после этого перепрыгиваем на следующий шаг: (0-12, 24-36, 48-60, ...)
-        */
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (GLvoid*)0);
-        // Явно включаем аттрибут
-        glEnableVertexAttribArray(0);
-        /*
-        * layout(position=1),
-        * ...,
-        * ...,
-        * ...,
-        * ...,
-        * (GLvoid*)(3 * sizeof(GLfloat)) - Указатель на величину отступа
-        */
-        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
-        // Явно включаем аттрибут
-        glEnableVertexAttribArray(1);
-
-
-        /*
-        * layout(position=2),
-        * vec2 = 2,
-        * ...,
-        * ...,
-        * ...,
-        * (GLvoid*)(6 * sizeof(GLfloat)) - - Указатель на величину отступа
-        */
-        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(GLfloat), (GLvoid*)(6 * sizeof(GLfloat)));
-        // Явно включаем аттрибут
-        glEnableVertexAttribArray(2);
-
-        glBindVertexArray(0);
     }
 };
 
 class FirstCubeMeshNMaterial : public MaterialWithMesh {
 protected:
-    const std::vector<GLfloat> vertices = {
-    -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
-     0.5f, -0.5f, -0.5f,  1.0f, 0.0f,
-     0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-     0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
-    -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
-
-    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-     0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-     0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
-     0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
-    -0.5f,  0.5f,  0.5f,  0.0f, 1.0f,
-    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-
-    -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-    -0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-    -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-
-     0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-     0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-     0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-     0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-     0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-     0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-
-    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-     0.5f, -0.5f, -0.5f,  1.0f, 1.0f,
-     0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-     0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-
-    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
-     0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-     0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-     0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-    -0.5f,  0.5f,  0.5f,  0.0f, 0.0f,
-    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f
-    };
+    // Куб из ProceduralGeometry: 24 вершины (по 4 на грань) и 36 индексов, считается при компиляции
+    static constexpr auto cube = Procedural::Cube();
+    static constexpr auto vertices = Procedural::Interleave<VertexSemantic::Position, VertexSemantic::TexCoord>(cube);
+
+    // Исходные float и то, что лежит в VBO: half-позиция и 16-битные UV, 20 -> 12 байт на вершину
+    const VertexLayout layout = VertexLayout().Add(0, VertexFormat::Float3).Add(1, VertexFormat::Float2);
+    const VertexLayout packedLayout = VertexLayout().Add(0, VertexFormat::Half3).Add(1, VertexFormat::UNorm16x2);
 
 public:
     virtual void LoadShader() {
-        LoadShaderImpl("shader-1.8-vertexProjections3DCube.glsl", "shader-1.8-fragment3DCube.glsl");
+        LoadShaderImpl("shader-1.8-vertexProjections3DCube.glsl", "shader-fragmentTextured.glsl", SHADER_FEATURE_TWO_TEXTURES);
     }
 
     virtual void FillVerticesBuffers() {
@@ -195,11 +89,12 @@ public:
            GL_DYNAMIC_DRAW: данные будут меняться довольно часто;
            GL_STREAM_DRAW: данные будут меняться при каждой отрисовке.
          */
-        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), &vertices[0], GL_STATIC_DRAW);
+        // Вершины уже уникальные, индексы готовые - без сварки, рисуем через glDrawElements
+        FillIndexedBuffers(vertices, layout, packedLayout, cube.Indices, "cube");
      }
 
     virtual void DrawShape() override {
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        DrawIndexed();
     }
 
     virtual void SetupVerticesData() override
@@ -215,56 +110,8 @@ public:
             * Конфигурация атрибутов, выполненная через glVertexAttribPointer.
             * VBO ассоциированные с вершинными атрибутами с помощью glVertexAttribPointer
         */
-        glGenVertexArrays(1, &VAO);
-        // =================================   Bind Vertex array FIRST =================================
-        glBindVertexArray(VAO);
-
-        /*
-         * Создаем просто буфер типа ARRAY (с сырыми данными?) и складываем туда вертексы
-         */
-        GLuint VBO;
-        glGenBuffers(1, &VBO);
-
-        // Then...
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-
-        // В зависимости от фигуры - вызываем отрисовку
+        // VAO, VBO и EBO общие для всех мешей с этим packedLayout - их заводит и настраивает GeometryArena
         this->FillVerticesBuffers();
-
-        // Размечаем память в шейдере
-        /**
-            Первый аргумент описывает какой аргумент шейдера мы хотим настроить. Мы хотим специфицировать значение аргумента position, позиция которого была указана следующим образом: layout (location = 0).
-            Следующий аргумент описывает размер аргумента в шейдере. Поскольку мы использовали vec3 то мы указываем 3.
-            Третий аргумент описывает используемый тип данных. Мы указываем GL_FLOAT, поскольку vec в шейдере использует числа с плавающей точкой.
-            Четвертый аргумент указывает необходимость нормализовать входные данные. Если мы укажем GL_TRUE, то все данные будут расположены между 0 (-1 для знаковых значений) и 1. Нам нормализация не требуется, поэтому мы оставляем GL_FALSE;
-            Пятый аргумент называется шагом и описывает расстояние между наборами данных. Мы также можем указать шаг равный 0 и тогда OpenGL высчитает шаг (работает только с плотно упакованными наборами данных). Как выручить существенную пользу от этого аргумента мы рассмотрим позже.
-            Последний параметр имеет тип GLvoid* и поэтому требует такое странное приведение типов. Это смещение начала данных в буфере. У нас буфер не имеет смещения и поэтому мы указываем 0.
-        */
-        /*
-        layout(position=0),
-        vec3 = 3,
-        GLFLOAT - тк вектор с флоатами,
-        GL_FALSE - не нормализовывать,
-        8 * sizeof(GLfloat) - ШАГ (или общее кол-во данных для вершины) - шесть флоатов, тк у нас 3 на позицию + 3 на цвет,
-        (GLvoid*)0 - Смещение - 0, тк мы читаем с нуля три флоат вершины и после этого перепрыгиваем на следующий шаг: (0-12, 24-36, 48-60, ...)
-        */
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)0);
-        // Явно включаем аттрибут
-        glEnableVertexAttribArray(0);
-
-        /*
-        * layout(position=1),
-        * vec2 = 2,
-        * ...,
-        * ...,
-        * ...,
-        * (GLvoid*)(6 * sizeof(GLfloat)) - - Указатель на величину отступа
-        */
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(GLfloat), (GLvoid*)(3 * sizeof(GLfloat)));
-        // Явно включаем аттрибут
-        glEnableVertexAttribArray(1);
-
-        glBindVertexArray(0);
     }
 };
 
@@ -363,9 +210,7 @@ static void TickFor2DCube() {
     glUniformMatrix4fv(materialWithMeshObject->GetUniformLocation("view"), 1, GL_FALSE, glm::value_ptr(view));
     glUniformMatrix4fv(materialWithMeshObject->GetUniformLocation("projection"), 1, GL_FALSE, glm::value_ptr(projection));
 
-    glBindVertexArray(VAO);
     materialWithMeshObject->DrawShape();
-    glBindVertexArray(0);
 }
 
 static void TickFor3DCube() {
@@ -409,9 +254,7 @@ static void TickFor3DCube() {
     glUniformMatrix4fv(materialWithMeshObject->GetUniformLocation("view"), 1, GL_FALSE, glm::value_ptr(view));
     glUniformMatrix4fv(materialWithMeshObject->GetUniformLocation("projection"), 1, GL_FALSE, glm::value_ptr(projection));
 
-    glBindVertexArray(VAO);
     materialWithMeshObject->DrawShape();
-    glBindVertexArray(0);
 }
 
 static GLfloat CurrentFOV = FOV;
@@ -459,7 +302,6 @@ static void TickForMany3DCubes()
     glUniformMatrix4fv(materialWithMeshObject->GetUniformLocation("view"), 1, GL_FALSE, glm::value_ptr(view));
     glUniformMatrix4fv(materialWithMeshObject->GetUniformLocation("projection"), 1, GL_FALSE, glm::value_ptr(projection));
 
-    glBindVertexArray(VAO);
     for (const glm::vec3& position : cubesPositions) {
         glm::mat4 model = glm::translate(glm::mat4(1.f), position);
         GLfloat angle = glfwGetTime() * 80.0f;
@@ -468,8 +310,6 @@ static void TickForMany3DCubes()
         
         materialWithMeshObject->DrawShape();
     }
-
-    glBindVertexArray(0);
 }
 
 
@@ -484,6 +324,10 @@ void Lesson18::Begin()
 
 void Lesson18::Update()
 {
+    if (!materialWithMeshObject->IsShaderReady()) {
+        return;
+    }
+
     GLfloat time = glfwGetTime();
     TickForMany3DCubes();
     //std::cout << " FPS IS: " << 1.f / (glfwGetTime() - time) << std::endl;
@@ -0,0 +1,96 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool& ThreadPool::Instance()
+{
+    // hardware_concurrency может вернуть 0 - тогда 0 - 1 переполнилось бы; один рабочий поток в любом случае
+    static ThreadPool pool(std::max(2u, std::thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+ThreadPool::ThreadPool(unsigned threadCount)
+{
+    for (unsigned i = 0; i < threadCount; ++i) {
+        workers.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    wakeUp.notify_one();
+}
+
+void ThreadPool::WorkerLoop()
+{
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeUp.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (tasks.empty()) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& body)
+{
+    if (count == 0) {
+        return;
+    }
+
+    // Общее состояние живет, пока его держит хоть один помощник - даже если тот
+    // добрался до очереди уже после того, как вся работа сделана
+    struct Batch {
+        std::atomic<size_t> next{ 0 };
+        std::atomic<size_t> done{ 0 };
+        size_t count = 0;
+        const std::function<void(size_t)>* body = nullptr;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+    batch->count = count;
+    batch->body = &body;
+
+    auto run = [](Batch& batch) {
+        for (size_t i = batch.next++; i < batch.count; i = batch.next++) {
+            (*batch.body)(i);
+            if (++batch.done == batch.count) {
+                std::lock_guard<std::mutex> lock(batch.mutex);
+                batch.finished.notify_all();
+            }
+        }
+    };
+
+    const size_t helpers = std::min(count - 1, workers.size());
+    for (size_t i = 0; i < helpers; ++i) {
+        Submit([batch, run] { run(*batch); });
+    }
+    run(*batch);
+
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    batch->finished.wait(lock, [&] { return batch->done == batch->count; });
+}
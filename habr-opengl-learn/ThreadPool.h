@@ -0,0 +1,43 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Пул рабочих потоков для CPU-задач, которым не нужен контекст OpenGL:
+// оптимизация сеток, разбор моделей, запись команд.
+class ThreadPool
+{
+public:
+    // Общий пул: по потоку на ядро, кроме потока отрисовки
+    static ThreadPool& Instance();
+
+    explicit ThreadPool(unsigned threadCount);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void Submit(std::function<void()> task);
+
+    // body(i) для всех i из [0, count). Вызывающий поток тоже берет задачи, поэтому
+    // вложенный ParallelFor из рабочего потока не зависнет. Возвращается, когда все готово.
+    void ParallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    unsigned ThreadCount() const
+    {
+        return static_cast<unsigned>(workers.size());
+    }
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    bool stopping = false;
+};
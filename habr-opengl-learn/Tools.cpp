@@ -0,0 +1,944 @@
+#include "Tools.h"
+#include "CommandBuffer.h"
+#include "Common.h"
+#include "MappedFile.h"
+#include "MaterialWithMesh.h"
+#include "MeshCodec.h"
+#include "MeshFile.h"
+#include "MeshImport.h"
+#include "MeshOptimizer.h"
+#include "Meshlets.h"
+#include "ProceduralGeometry.h"
+#include "RenderQueue.h"
+#include "ShaderArchive.h"
+#include "ShaderPreprocessor.h"
+#include "Spirv.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+static void PrintUsage()
+{
+    std::cout << "Usage:" << std::endl;
+    std::cout << "  habr-opengl-learn --pack-shaders <out.pak> <file.glsl>..." << std::endl;
+    std::cout << "  habr-opengl-learn --compile-spirv <features> <vertex.glsl> <fragment.glsl>" << std::endl;
+    std::cout << "  habr-opengl-learn --bench-spirv <features> <vertex.glsl> <fragment.glsl> [iterations]" << std::endl;
+    std::cout << "  habr-opengl-learn --bench-mesh-optimizer [meshes] [gridSize]" << std::endl;
+    std::cout << "  habr-opengl-learn --bench-meshlets [segments]" << std::endl;
+    std::cout << "  habr-opengl-learn --convert-mesh <model.obj|.gltf|.glb> <out.mesh> [--compress]" << std::endl;
+    std::cout << "  habr-opengl-learn --bench-obj-import [megabytes]" << std::endl;
+    std::cout << "  habr-opengl-learn --bench-mesh-codec [model.obj|.gltf|.glb]" << std::endl;
+    std::cout << "  habr-opengl-learn --bench-command-buffers [objects] [frames]" << std::endl;
+    std::cout << "  habr-opengl-learn [--shader-budget-ms <ms>] [--shader-report <file.json>] [--stress-cubes <count>]" << std::endl;
+}
+
+static unsigned ParseFeatures(const char* text)
+{
+    return static_cast<unsigned>(std::strtoul(text, nullptr, 0));
+}
+
+// Скрытое окно - только ради контекста OpenGL
+static GLFWwindow* CreateHiddenContext()
+{
+    if (!glfwInit()) {
+        std::cout << "Failed to initialize GLFW system!" << std::endl;
+        return nullptr;
+    }
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "habr-opengl-learn tool", nullptr, nullptr);
+    if (window == nullptr) {
+        std::cout << "Failed to create GLFW window" << std::endl;
+        glfwTerminate();
+        return nullptr;
+    }
+    glfwMakeContextCurrent(window);
+    glewExperimental = GL_TRUE;
+    if (glewInit() != GLEW_OK) {
+        std::cout << "Failed to initialize GLEW" << std::endl;
+        glfwTerminate();
+        return nullptr;
+    }
+    return window;
+}
+
+// Время от чтения исходников до готовой программы. Запрос GL_LINK_STATUS дожидается линковки.
+static double MeasureLink(bool spirv, unsigned features, const std::string& vertexPath, const std::string& fragmentPath, bool& linked)
+{
+    const auto start = std::chrono::steady_clock::now();
+
+    GLuint vertex;
+    GLuint fragment;
+    if (spirv) {
+        MappedFile vertexModule;
+        MappedFile fragmentModule;
+        vertexModule.Open(Spirv::ModulePath(vertexPath, features));
+        fragmentModule.Open(Spirv::ModulePath(fragmentPath, features));
+        vertex = Spirv::IssueSpecialize(GL_VERTEX_SHADER, vertexModule);
+        fragment = Spirv::IssueSpecialize(GL_FRAGMENT_SHADER, fragmentModule);
+    }
+    else {
+        const ShaderSource vertexSource = ShaderPreprocessor::Process(vertexPath, features, false);
+        const ShaderSource fragmentSource = ShaderPreprocessor::Process(fragmentPath, features, false);
+        vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(vertex, static_cast<GLsizei>(vertexSource.Strings.size()), vertexSource.Strings.data(), vertexSource.Lengths.data());
+        glCompileShader(vertex);
+        fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(fragment, static_cast<GLsizei>(fragmentSource.Strings.size()), fragmentSource.Strings.data(), fragmentSource.Lengths.data());
+        glCompileShader(fragment);
+    }
+
+    const GLuint program = glCreateProgram();
+    glAttachShader(program, vertex);
+    glAttachShader(program, fragment);
+    glLinkProgram(program);
+    GLint success = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
+
+    const auto end = std::chrono::steady_clock::now();
+
+    linked = success == GL_TRUE;
+    glDeleteShader(vertex);
+    glDeleteShader(fragment);
+    glDeleteProgram(program);
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+static void PrintTimings(const char* name, std::vector<double> times)
+{
+    const double first = times.front();
+    std::sort(times.begin(), times.end());
+    double total = 0.0;
+    for (double time : times) {
+        total += time;
+    }
+    std::cout << std::left << std::setw(8) << name << std::right << std::fixed << std::setprecision(3)
+        << std::setw(10) << first
+        << std::setw(10) << times.front()
+        << std::setw(10) << times[times.size() / 2]
+        << std::setw(10) << total / times.size() << std::endl;
+}
+
+// Сравнение холодной сборки GLSL и SPIR-V. Дисковый кэш драйвера прячет разницу,
+// под Mesa его нужно выключить: MESA_SHADER_CACHE_DISABLE=true.
+// Пути чередуются, чтобы разогрев драйвера не достался только одному из них.
+static int BenchSpirv(unsigned features, const std::string& vertexPath, const std::string& fragmentPath, int iterations)
+{
+    if (CreateHiddenContext() == nullptr) {
+        return 1;
+    }
+    std::cout << "GL_RENDERER: " << glGetString(GL_RENDERER) << std::endl;
+    std::cout << "GL_VERSION:  " << glGetString(GL_VERSION) << std::endl;
+
+    const bool spirv = Spirv::IsSupported();
+    if (!spirv) {
+        std::cout << "GL_ARB_gl_spirv is not supported, measuring GLSL only" << std::endl;
+    }
+
+    std::vector<double> glslTimes;
+    std::vector<double> spirvTimes;
+    for (int i = 0; i < iterations; ++i) {
+        bool linked = false;
+        glslTimes.push_back(MeasureLink(false, features, vertexPath, fragmentPath, linked));
+        if (!linked) {
+            std::cout << "ERROR::BENCH::GLSL_LINK_FAILED" << std::endl;
+            glfwTerminate();
+            return 1;
+        }
+        if (spirv) {
+            spirvTimes.push_back(MeasureLink(true, features, vertexPath, fragmentPath, linked));
+            if (!linked) {
+                std::cout << "ERROR::BENCH::SPIRV_LINK_FAILED (run --compile-spirv first)" << std::endl;
+                glfwTerminate();
+                return 1;
+            }
+        }
+    }
+
+    std::cout << iterations << " iterations, ms" << std::endl;
+    std::cout << "path         first       min    median      mean" << std::endl;
+    PrintTimings("GLSL", glslTimes);
+    if (spirv) {
+        PrintTimings("SPIR-V", spirvTimes);
+    }
+
+    glfwTerminate();
+    return 0;
+}
+
+// Сетка gridSize x gridSize квадов с перемешанными треугольниками - худший случай для кэша
+static IndexedMesh MakeShuffledGrid(unsigned gridSize, unsigned seed)
+{
+    IndexedMesh mesh;
+    mesh.VertexStride = 3 * sizeof(float);
+    for (unsigned y = 0; y <= gridSize; ++y) {
+        for (unsigned x = 0; x <= gridSize; ++x) {
+            const float position[3] = { float(x), float(y), 0.f };
+            const std::uint8_t* bytes = reinterpret_cast<const std::uint8_t*>(position);
+            mesh.Vertices.insert(mesh.Vertices.end(), bytes, bytes + sizeof(position));
+        }
+    }
+    mesh.SourceVertexCount = mesh.VertexCount();
+
+    std::vector<std::uint32_t> quads(gridSize * gridSize);
+    for (std::uint32_t i = 0; i < quads.size(); ++i) {
+        quads[i] = i;
+    }
+    std::shuffle(quads.begin(), quads.end(), std::mt19937(seed));
+    for (std::uint32_t quad : quads) {
+        const std::uint32_t a = quad / gridSize * (gridSize + 1) + quad % gridSize;
+        const std::uint32_t b = a + 1;
+        const std::uint32_t c = a + gridSize + 1;
+        const std::uint32_t d = c + 1;
+        const std::uint32_t triangles[6] = { a, b, c, b, d, c };
+        mesh.Indices.insert(mesh.Indices.end(), triangles, triangles + 6);
+    }
+    return mesh;
+}
+
+// Сколько стоит оптимизация при загрузке: одни и те же сетки по очереди и в ThreadPool
+static int BenchMeshOptimizer(unsigned meshCount, unsigned gridSize)
+{
+    std::vector<IndexedMesh> serial;
+    for (unsigned i = 0; i < meshCount; ++i) {
+        serial.push_back(MakeShuffledGrid(gridSize, i));
+    }
+    std::vector<IndexedMesh> parallel = serial;
+
+    auto start = std::chrono::steady_clock::now();
+    MeshOptimizeStats stats;
+    for (IndexedMesh& mesh : serial) {
+        stats = MeshOptimizer::Optimize(mesh);
+    }
+    const double serialMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<IndexedMesh*> meshes;
+    for (IndexedMesh& mesh : parallel) {
+        meshes.push_back(&mesh);
+    }
+    start = std::chrono::steady_clock::now();
+    MeshOptimizer::OptimizeAll(meshes);
+    const double parallelMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << meshCount << " meshes, " << 2 * gridSize * gridSize << " triangles each" << std::endl;
+    MeshOptimizer::PrintReport("grid", stats);
+    std::cout << "serial=" << serialMs << "ms parallel=" << parallelMs << "ms threads=" << ThreadPool::Instance().ThreadCount() + 1
+        << " speedup=" << serialMs / parallelMs << "x" << std::endl;
+    return 0;
+}
+
+static const float PI = 3.14159265358979f;
+
+// Замкнутая сфера радиуса 1: segments меридианов и segments / 2 параллелей
+static IndexedMesh MakeSphere(unsigned segments)
+{
+    const unsigned rings = std::max(2u, segments / 2);
+    IndexedMesh mesh;
+    mesh.VertexStride = 3 * sizeof(float);
+    auto addVertex = [&mesh](float x, float y, float z) {
+        const float position[3] = { x, y, z };
+        const std::uint8_t* bytes = reinterpret_cast<const std::uint8_t*>(position);
+        mesh.Vertices.insert(mesh.Vertices.end(), bytes, bytes + sizeof(position));
+    };
+
+    addVertex(0.f, 1.f, 0.f);
+    for (unsigned r = 1; r < rings; ++r) {
+        const float theta = PI * r / rings;
+        for (unsigned s = 0; s < segments; ++s) {
+            const float phi = 2.f * PI * s / segments;
+            addVertex(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+        }
+    }
+    addVertex(0.f, -1.f, 0.f);
+    mesh.SourceVertexCount = mesh.VertexCount();
+
+    const std::uint32_t south = static_cast<std::uint32_t>(mesh.VertexCount() - 1);
+    auto ring = [segments](unsigned r, unsigned s) {
+        return static_cast<std::uint32_t>(1 + (r - 1) * segments + s % segments);
+    };
+    for (unsigned s = 0; s < segments; ++s) {
+        const std::uint32_t caps[6] = { 0, ring(1, s + 1), ring(1, s), south, ring(rings - 1, s), ring(rings - 1, s + 1) };
+        mesh.Indices.insert(mesh.Indices.end(), caps, caps + 6);
+    }
+    for (unsigned r = 1; r + 1 < rings; ++r) {
+        for (unsigned s = 0; s < segments; ++s) {
+            const std::uint32_t quad[6] = { ring(r, s), ring(r, s + 1), ring(r + 1, s), ring(r, s + 1), ring(r + 1, s + 1), ring(r + 1, s) };
+            mesh.Indices.insert(mesh.Indices.end(), quad, quad + 6);
+        }
+    }
+    return mesh;
+}
+
+// Доля отсеченных треугольников сферы с нескольких точек зрения
+static int BenchMeshlets(unsigned segments)
+{
+    IndexedMesh sphere = MakeSphere(segments);
+    MeshOptimizer::Optimize(sphere);
+
+    auto start = std::chrono::steady_clock::now();
+    const MeshletMesh meshlets = MeshletBuilder::Build(sphere);
+    const double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    MeshletBuilder::PrintReport("sphere", meshlets);
+    std::cout << "build=" << buildMs << "ms" << std::endl;
+
+    // Угол в градусах, как в уроках
+    const glm::mat4 projection = glm::perspective(45.f, 800.f / 600.f, .1f, 100.f);
+    struct View {
+        const char* Name;
+        glm::vec3 Eye;
+        glm::vec3 Target;
+    };
+    const View views[] = {
+        // Вся сфера в кадре: отсекается только задняя половина
+        { "front", glm::vec3(0.f, 0.f, 4.f), glm::vec3(0.f) },
+        // Близко и вбок: часть передней половины еще и за краем кадра
+        { "close-side", glm::vec3(0.f, 0.f, 1.6f), glm::vec3(1.f, 0.f, 0.f) },
+        // Сфера за спиной
+        { "behind", glm::vec3(0.f, 0.f, 4.f), glm::vec3(0.f, 0.f, 8.f) },
+    };
+
+    std::vector<std::uint32_t> indices;
+    for (const View& view : views) {
+        const glm::mat4 viewProjection = projection * glm::lookAt(view.Eye, view.Target, glm::vec3(0.f, 1.f, 0.f));
+        MeshletCullStats stats;
+        indices.clear();
+        MeshletCulling::Cull(meshlets, viewProjection, view.Eye, indices, &stats);
+        MeshletCulling::PrintReport(view.Name, stats);
+    }
+    return 0;
+}
+
+// Синтетический OBJ: полосы сетки по OBJ_BENCH_COLUMNS вершин с v/vt/vn и треугольниками v/vt/vn,
+// пока файл не дорастет до bytes
+static const unsigned OBJ_BENCH_COLUMNS = 1024;
+
+static bool WriteSyntheticObj(const std::string& path, size_t bytes)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cout << "ERROR::BENCH::CANNOT_WRITE " << path << std::endl;
+        return false;
+    }
+
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> jitter(-0.01f, 0.01f);
+    std::vector<char> block(1 << 20);
+    char* cursor = block.data();
+    size_t written = 0;
+    auto flush = [&]() {
+        file.write(block.data(), cursor - block.data());
+        written += cursor - block.data();
+        cursor = block.data();
+    };
+    auto put = [&](const char* text) {
+        while (*text != '\0') {
+            *cursor++ = *text++;
+        }
+    };
+    auto putFloat = [&](float value) {
+        *cursor++ = ' ';
+        cursor = std::to_chars(cursor, block.data() + block.size(), value).ptr;
+    };
+    auto putInt = [&](unsigned value) {
+        cursor = std::to_chars(cursor, block.data() + block.size(), value).ptr;
+    };
+
+    for (unsigned row = 0; written < bytes; ++row) {
+        for (unsigned column = 0; column < OBJ_BENCH_COLUMNS; ++column) {
+            // Строка OBJ короче 200 байт: сбрасываем блок заранее
+            if (block.data() + block.size() - cursor < 1024) {
+                flush();
+            }
+            const float u = float(column) / (OBJ_BENCH_COLUMNS - 1);
+            put("v");
+            putFloat(u * 100.f + jitter(random));
+            putFloat(std::sin(u * 20.f + row * 0.1f) + jitter(random));
+            putFloat(row * 0.1f + jitter(random));
+            put("\nvt");
+            putFloat(u);
+            putFloat(row / 1024.f);
+            put("\nvn");
+            putFloat(0.f);
+            putFloat(1.f);
+            putFloat(jitter(random));
+            put("\n");
+        }
+        if (row == 0) {
+            continue;
+        }
+        for (unsigned column = 0; column + 1 < OBJ_BENCH_COLUMNS; ++column) {
+            if (block.data() + block.size() - cursor < 1024) {
+                flush();
+            }
+            const unsigned a = (row - 1) * OBJ_BENCH_COLUMNS + column + 1;
+            const unsigned b = row * OBJ_BENCH_COLUMNS + column + 1;
+            const unsigned quad[2][3] = { { a, b, a + 1 }, { a + 1, b, b + 1 } };
+            for (const auto& triangle : quad) {
+                put("f");
+                for (unsigned index : triangle) {
+                    for (int k = 0; k < 3; ++k) {
+                        *cursor++ = k == 0 ? ' ' : '/';
+                        putInt(index);
+                    }
+                }
+                put("\n");
+            }
+        }
+    }
+    flush();
+    return file.good();
+}
+
+// Типичный загрузчик "в лоб": std::getline и std::istringstream на каждую строку
+static bool NaiveLoadObj(const std::string& path, std::vector<GLfloat>& vertices)
+{
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return false;
+    }
+    std::vector<GLfloat> positions;
+    std::vector<GLfloat> texCoords;
+    std::vector<GLfloat> normals;
+    std::string line;
+    std::string keyword;
+    std::string token;
+    while (std::getline(file, line)) {
+        std::istringstream stream(line);
+        keyword.clear();
+        stream >> keyword;
+        if (keyword == "v" || keyword == "vn") {
+            GLfloat x = 0.f, y = 0.f, z = 0.f;
+            stream >> x >> y >> z;
+            std::vector<GLfloat>& target = keyword == "v" ? positions : normals;
+            target.insert(target.end(), { x, y, z });
+        }
+        else if (keyword == "vt") {
+            GLfloat u = 0.f, v = 0.f;
+            stream >> u >> v;
+            texCoords.insert(texCoords.end(), { u, v });
+        }
+        else if (keyword == "f") {
+            // Только треугольники v/vt/vn - другого синтетический файл не содержит
+            while (stream >> token) {
+                const size_t slash = token.find('/');
+                const size_t secondSlash = token.find('/', slash + 1);
+                const size_t v = std::stoul(token.substr(0, slash)) - 1;
+                const size_t vt = std::stoul(token.substr(slash + 1, secondSlash - slash - 1)) - 1;
+                const size_t vn = std::stoul(token.substr(secondSlash + 1)) - 1;
+                vertices.insert(vertices.end(), positions.begin() + v * 3, positions.begin() + v * 3 + 3);
+                vertices.insert(vertices.end(), texCoords.begin() + vt * 2, texCoords.begin() + vt * 2 + 2);
+                vertices.insert(vertices.end(), normals.begin() + vn * 3, normals.begin() + vn * 3 + 3);
+            }
+        }
+    }
+    return true;
+}
+
+// Пропускная способность разбора OBJ: MeshImport::LoadObjTriangles против NaiveLoadObj на одном файле
+static int BenchObjImport(size_t megabytes)
+{
+    const std::string path = "bench-import.obj";
+    if (!WriteSyntheticObj(path, megabytes << 20)) {
+        return 1;
+    }
+    MappedFile mapped;
+    mapped.Open(path);
+    const double fileMegabytes = double(mapped.Size()) / (1 << 20);
+    mapped.Close();
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<GLfloat> naive;
+    const bool naiveLoaded = NaiveLoadObj(path, naive);
+    const double naiveMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    std::vector<GLfloat> chunked;
+    const bool chunkedLoaded = MeshImport::LoadObjTriangles(path, chunked);
+    const double chunkedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::remove(path.c_str());
+
+    if (!naiveLoaded || !chunkedLoaded) {
+        std::cout << "ERROR::BENCH::OBJ_LOAD_FAILED" << std::endl;
+        return 1;
+    }
+    const bool same = naive == chunked;
+    std::cout << std::fixed << std::setprecision(1) << fileMegabytes << " MB, "
+        << chunked.size() / ImportedMesh::FLOATS_PER_VERTEX / 3 << " triangles, results " << (same ? "match" : "DIFFER") << std::endl;
+    std::cout << "istream=" << naiveMs << "ms (" << fileMegabytes * 1000.0 / naiveMs << " MB/s)"
+        << " chunked=" << chunkedMs << "ms (" << fileMegabytes * 1000.0 / chunkedMs << " MB/s)"
+        << " threads=" << ThreadPool::Instance().ThreadCount() + 1 << " speedup=" << naiveMs / chunkedMs << "x" << std::endl;
+    return same ? 0 : 1;
+}
+
+// Жадный LZ77 с блочным форматом LZ4 - ориентир по размеру для --bench-mesh-codec. Совпадения ищутся
+// по одной хеш-таблице без ускорения пропусков, так что это не эталонный LZ4: у эталона и размер,
+// и скорость распаковки свои. Скорость этого кодера не печатается.
+static const size_t LZ4_MIN_MATCH = 4;
+static const size_t LZ4_LAST_LITERALS = 5;
+static const size_t LZ4_MATCH_FIND_LIMIT = 12;
+static const size_t LZ4_MAX_OFFSET = 0xFFFF;
+
+static std::uint32_t Read32(const std::uint8_t* bytes)
+{
+    std::uint32_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+static void WriteLz77Length(std::vector<std::uint8_t>& out, size_t length)
+{
+    for (; length >= 255; length -= 255) {
+        out.push_back(255);
+    }
+    out.push_back(static_cast<std::uint8_t>(length));
+}
+
+static std::vector<std::uint8_t> GreedyLz77Compress(const void* data, size_t size)
+{
+    const std::uint8_t* source = static_cast<const std::uint8_t*>(data);
+    std::vector<std::uint8_t> out;
+    // Позиция + 1 последней последовательности с таким хешем
+    std::vector<std::uint32_t> table(1 << 16, 0);
+    size_t anchor = 0;
+
+    auto emit = [&](size_t literals, size_t offset, size_t matchLength) {
+        const size_t token = out.size();
+        out.push_back(static_cast<std::uint8_t>(std::min<size_t>(literals, 15) << 4));
+        if (literals >= 15) {
+            WriteLz77Length(out, literals - 15);
+        }
+        out.insert(out.end(), source + anchor, source + anchor + literals);
+        if (matchLength == 0) {
+            return;
+        }
+        out.push_back(static_cast<std::uint8_t>(offset));
+        out.push_back(static_cast<std::uint8_t>(offset >> 8));
+        out[token] |= static_cast<std::uint8_t>(std::min<size_t>(matchLength - LZ4_MIN_MATCH, 15));
+        if (matchLength - LZ4_MIN_MATCH >= 15) {
+            WriteLz77Length(out, matchLength - LZ4_MIN_MATCH - 15);
+        }
+    };
+
+    // Последние байты блока по формату всегда литералы
+    for (size_t position = 0; position + LZ4_MATCH_FIND_LIMIT <= size;) {
+        const std::uint32_t sequence = Read32(source + position);
+        std::uint32_t& slot = table[(sequence * 2654435761u) >> 16];
+        const size_t candidate = slot;
+        slot = static_cast<std::uint32_t>(position + 1);
+        if (candidate == 0 || position - (candidate - 1) > LZ4_MAX_OFFSET || Read32(source + candidate - 1) != sequence) {
+            ++position;
+            continue;
+        }
+        const size_t match = candidate - 1;
+        size_t length = LZ4_MIN_MATCH;
+        while (position + length < size - LZ4_LAST_LITERALS && source[match + length] == source[position + length]) {
+            ++length;
+        }
+        emit(position - anchor, position - match, length);
+        position += length;
+        anchor = position;
+    }
+    emit(size - anchor, 0, 0);
+    return out;
+}
+
+static bool GreedyLz77Decompress(const std::uint8_t* source, size_t size, std::uint8_t* destination, size_t destinationSize)
+{
+    size_t in = 0;
+    size_t out = 0;
+    auto readLength = [&](size_t& length) {
+        std::uint8_t byte = 255;
+        while (byte == 255) {
+            if (in == size) {
+                return false;
+            }
+            byte = source[in++];
+            length += byte;
+        }
+        return true;
+    };
+
+    while (in < size) {
+        const unsigned token = source[in++];
+        size_t literals = token >> 4;
+        if ((literals == 15 && !readLength(literals)) || literals > size - in || literals > destinationSize - out) {
+            return false;
+        }
+        memcpy(destination + out, source + in, literals);
+        in += literals;
+        out += literals;
+        if (in == size) {
+            break;
+        }
+
+        if (size - in < 2) {
+            return false;
+        }
+        const size_t offset = source[in] | size_t(source[in + 1]) << 8;
+        in += 2;
+        size_t length = token & 15;
+        if ((length == 15 && !readLength(length)) || offset == 0 || offset > out) {
+            return false;
+        }
+        length += LZ4_MIN_MATCH;
+        if (length > destinationSize - out) {
+            return false;
+        }
+        if (offset >= length) {
+            memcpy(destination + out, destination + out - offset, length);
+        }
+        else {
+            // Перекрытие: повтор последних offset байт
+            for (size_t i = 0; i < length; ++i) {
+                destination[out + i] = destination[out - offset + i];
+            }
+        }
+        out += length;
+    }
+    return out == destinationSize;
+}
+
+// Треугольники без учета порядка и поворота: полосы MeshCodec переставляют их внутри частей
+static std::vector<std::array<std::uint32_t, 3>> TriangleSet(const void* indices, GLenum indexType, size_t indexCount)
+{
+    std::vector<std::array<std::uint32_t, 3>> triangles;
+    auto index = [&](size_t i) -> std::uint32_t {
+        return indexType == GL_UNSIGNED_SHORT ? static_cast<const std::uint16_t*>(indices)[i] : static_cast<const std::uint32_t*>(indices)[i];
+    };
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        const std::uint32_t corners[3] = { index(i), index(i + 1), index(i + 2) };
+        const size_t first = std::min_element(corners, corners + 3) - corners;
+        triangles.push_back({ corners[first], corners[(first + 1) % 3], corners[(first + 2) % 3] });
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+// Размер и скорость распаковки одного меша: .mesh без сжатия и с MeshCodec; размер того же .mesh
+// после жадного LZ77 в формате LZ4
+static bool BenchMeshCodecOne(const char* name, const PackedMesh& mesh)
+{
+    const std::string rawPath = "bench-codec-raw.mesh";
+    const std::string codecPath = "bench-codec.mesh";
+    MeshFile raw;
+    MeshFile codec;
+    const bool opened = MeshFile::Write(rawPath, mesh.Layout, mesh.Vertices.data(), mesh.VertexCount(), mesh.Indices, mesh.Submeshes)
+        && MeshFile::Write(codecPath, mesh.Layout, mesh.Vertices.data(), mesh.VertexCount(), mesh.Indices, mesh.Submeshes, true)
+        && raw.Open(rawPath) && codec.Open(codecPath);
+    if (!opened) {
+        return false;
+    }
+
+    const MeshFileHeader& header = raw.Header();
+    const MeshFileHeader& encoded = codec.Header();
+    const size_t rawBytes = header.VerticesSize + header.IndicesSize;
+    const std::vector<std::uint8_t> lz77Vertices = GreedyLz77Compress(raw.Vertices(), header.VerticesSize);
+    const std::vector<std::uint8_t> lz77Indices = GreedyLz77Compress(raw.Indices(), header.IndicesSize);
+    const size_t codecBytes = encoded.VerticesSize + encoded.IndicesSize;
+    const size_t lz77Bytes = lz77Vertices.size() + lz77Indices.size();
+
+    std::vector<std::uint8_t> vertices(header.VerticesSize);
+    std::vector<std::uint8_t> indices(header.IndicesSize);
+    auto decodeCodec = [&](bool simd) {
+        return MeshCodec::DecodeVertices(vertices.data(), header.VertexCount, codec.Layout(), codec.Vertices(), encoded.VerticesSize, simd)
+            && MeshCodec::DecodeIndices(indices.data(), header.IndexCount, header.IndexType, header.VertexCount, codec.Indices(), encoded.IndicesSize);
+    };
+    auto decodeLz77 = [&]() {
+        return GreedyLz77Decompress(lz77Vertices.data(), lz77Vertices.size(), vertices.data(), vertices.size())
+            && GreedyLz77Decompress(lz77Indices.data(), lz77Indices.size(), indices.data(), indices.size());
+    };
+
+    // Результаты сверяются до замеров: вершины побитно, индексы - как набор треугольников
+    const auto expectedTriangles = TriangleSet(raw.Indices(), header.IndexType, header.IndexCount);
+    auto matches = [&](bool exactIndices) {
+        return memcmp(vertices.data(), raw.Vertices(), vertices.size()) == 0
+            && (exactIndices ? memcmp(indices.data(), raw.Indices(), indices.size()) == 0
+                : TriangleSet(indices.data(), header.IndexType, header.IndexCount) == expectedTriangles);
+    };
+    const bool same = decodeCodec(true) && matches(false)
+        && decodeCodec(false) && matches(false)
+        && decodeLz77() && matches(true);
+
+    // Повторы, чтобы и куб распаковывался заметное время
+    const size_t iterations = std::max<size_t>(1, (size_t(256) << 20) / std::max<size_t>(1, rawBytes));
+    auto measure = [&](auto decode) {
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            decode();
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return double(rawBytes) * iterations / seconds / 1e9;
+    };
+    const double simdRate = measure([&] { return decodeCodec(true); });
+    const double scalarRate = measure([&] { return decodeCodec(false); });
+
+    std::cout << std::fixed << std::setprecision(2) << name << ": " << header.VertexCount << " vertices x " << header.VertexStride
+        << " bytes, " << header.IndexCount / 3 << " triangles, results " << (same ? "match" : "DIFFER") << std::endl;
+    std::cout << "  size: raw=" << rawBytes << " codec=" << codecBytes << " (" << double(rawBytes) / codecBytes << "x, indices "
+        << encoded.IndicesSize * 8.0 / std::max<size_t>(1, header.IndexCount / 3) << " bits/triangle) lz77-greedy(lz4-format)=" << lz77Bytes
+        << " (" << double(rawBytes) / lz77Bytes << "x)" << std::endl;
+    std::cout << "  decode GB/s: codec-" << (MeshCodec::HasSimd() ? "sse4.1=" : "sse4.1-unavailable=") << simdRate
+        << " codec-scalar=" << scalarRate << std::endl;
+
+    raw.Close();
+    codec.Close();
+    std::remove(rawPath.c_str());
+    std::remove(codecPath.c_str());
+    return same;
+}
+
+// MeshCodec против жадного LZ77 (формат LZ4) на кубе, плотной сфере и, если указана, модели через тот же импорт, что и --convert-mesh
+static int BenchMeshCodec(const char* modelPath)
+{
+    const VertexLayout cubeLayout = VertexLayout().Add(0, VertexFormat::Half3).Add(1, VertexFormat::UNorm16x2);
+    const IndexedMesh cube = Procedural::Build(Procedural::Cube(), cubeLayout, { VertexSemantic::Position, VertexSemantic::TexCoord });
+    PackedMesh packedCube = { cubeLayout, cube.Vertices, cube.Indices, {} };
+
+    const VertexLayout sphereLayout = VertexLayout()
+        .Add(0, VertexFormat::Float3)
+        .Add(1, VertexFormat::UNorm16x2)
+        .Add(2, VertexFormat::SNorm10x3);
+    IndexedMesh sphere = Procedural::Build(Procedural::UVSphere<512, 256>(), sphereLayout,
+        { VertexSemantic::Position, VertexSemantic::TexCoord, VertexSemantic::Normal });
+    MeshOptimizer::OptimizeVertexCache(sphere);
+    MeshOptimizer::OptimizeVertexFetch(sphere);
+    PackedMesh packedSphere = { sphereLayout, sphere.Vertices, sphere.Indices, {} };
+
+    bool same = BenchMeshCodecOne("cube", packedCube);
+    same = BenchMeshCodecOne("sphere", packedSphere) && same;
+    if (modelPath != nullptr) {
+        PackedMesh model;
+        same = MeshImport::Prepare(modelPath, model) && BenchMeshCodecOne(modelPath, model) && same;
+    }
+    return same ? 0 : 1;
+}
+
+// Материал без GL для --bench-command-buffers: уровни LOD и участок-пустышка в пуле pool
+class BenchMaterial : public MaterialWithMesh
+{
+public:
+    BenchMaterial(const MeshLodChain& chain, unsigned pool)
+    {
+        lods = chain;
+        lods.Indices.clear();
+        geometry.Pool = pool;
+        geometry.IndexType = GL_UNSIGNED_INT;
+    }
+
+    virtual void DrawShape() override {}
+    virtual void FillVerticesBuffers() override {}
+    virtual void LoadShader() override {}
+};
+
+static size_t CountDraws(const std::vector<CommandBuffer>& buffers)
+{
+    size_t draws = 0;
+    for (const CommandBuffer& buffer : buffers) {
+        for (const Command* command = buffer.First(); command != nullptr; command = command->Next) {
+            draws += command->Type == CommandType::Draw;
+        }
+    }
+    return draws;
+}
+
+// Запись кадра в буферы команд на 1..N потоках - то же, что режим threaded урока 19 (--stress-cubes):
+// отсечение по сфере, выбор LOD, ключи, поразрядная сортировка и матрицы в команды. GL не нужен.
+static int BenchCommandBuffers(unsigned objectCount, unsigned frames)
+{
+    IndexedMesh sphere = MakeSphere(64);
+    MeshOptimizer::Optimize(sphere);
+    const MeshLodChain chain = MeshLod::Build(sphere);
+    // Четыре материала в двух пулах арены и три набора текстур, как у кубов урока
+    std::vector<std::unique_ptr<BenchMaterial>> materials;
+    for (unsigned i = 0; i < 4; ++i) {
+        materials.push_back(std::unique_ptr<BenchMaterial>(new BenchMaterial(chain, i % 2)));
+    }
+
+    // Сетка перед камерой, как BuildStressCubes
+    const unsigned side = static_cast<unsigned>(std::ceil(std::cbrt(double(objectCount))));
+    const float half = (side - 1) * 2.f * .5f;
+    std::vector<glm::vec3> positions(objectCount);
+    for (unsigned i = 0; i < objectCount; ++i) {
+        positions[i] = glm::vec3(i % side * 2.f - half, i / side % side * 2.f - half, -5.f - i / (side * side) * 2.f);
+    }
+
+    const glm::vec3 eye(0.f, 0.f, 3.f);
+    const glm::mat4 view = glm::lookAt(eye, glm::vec3(0.f, 0.f, -5.f), glm::vec3(0.f, 1.f, 0.f));
+    const glm::mat4 projection = glm::perspective(45.f, 800.f / 600.f, .1f, 100.f);
+    const MeshletCulling::Frustum frustum(projection * view);
+
+    const unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "Command buffers: " << objectCount << " objects, " << frames << " frames, up to " << maxThreads << " threads" << std::endl;
+    std::cout << "threads    first       min    median      mean  (ms/frame)" << std::endl;
+    double singleMs = 0.0;
+    size_t singleDraws = 0;
+    bool same = true;
+    for (unsigned threads = 1; threads <= maxThreads; ++threads) {
+        // Вызывающий поток тоже берет куски в ParallelFor
+        ThreadPool pool(threads - 1);
+        std::vector<CommandBuffer> buffers(threads);
+        std::vector<RenderQueue> queues(threads);
+        auto record = [&](size_t chunk, size_t first, size_t last, CommandBuffer& commands) {
+            RenderQueue& queue = queues[chunk];
+            queue.Begin(view);
+            for (size_t i = first; i < last; ++i) {
+                RenderPacket packet;
+                packet.Material = materials[i % materials.size()].get();
+                packet.Textures[0] = i % 3 == 1 ? 2 : 1;
+                packet.Textures[1] = i % 3 == 1 ? 1 : 2;
+                packet.Model = glm::rotate(glm::translate(glm::mat4(1.f), positions[i]), 20.f * i, glm::vec3(1.f, .3f, .5f));
+                const MaterialWithMesh& material = *packet.Material;
+                if (!frustum.Contains(glm::vec3(packet.Model * glm::vec4(material.GetBoundsCenter(), 1.f)), material.GetBoundsRadius())) {
+                    continue;
+                }
+                packet.Range = material.GetDrawRange(material.ChooseLod(eye, packet.Model, 45.f, 600.f));
+                queue.Add(packet);
+            }
+            queue.Record(commands);
+        };
+
+        // Первый кадр - прогрев: блоки аллокаторов и словари очередей; в "first" он и попадает
+        std::vector<double> times;
+        for (unsigned frame = 0; frame <= frames; ++frame) {
+            const auto start = std::chrono::steady_clock::now();
+            CommandBuffer::RecordParallel(pool, buffers, objectCount, record);
+            times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        const std::string name = std::to_string(threads);
+        PrintTimings(name.c_str(), times);
+
+        size_t commands = 0;
+        size_t bytes = 0;
+        for (const CommandBuffer& buffer : buffers) {
+            commands += buffer.CommandCount();
+            bytes += buffer.Bytes();
+        }
+        std::sort(times.begin() + 1, times.end());
+        const double medianMs = times[1 + (times.size() - 1) / 2];
+        const size_t draws = CountDraws(buffers);
+        if (threads == 1) {
+            singleMs = medianMs;
+            singleDraws = draws;
+        }
+        std::cout << "         draws=" << draws << " commands=" << commands << " bytes=" << bytes
+            << " speedup=" << singleMs / medianMs << "x" << std::endl;
+        // Куски делятся по-разному, но видимых объектов столько же
+        if (draws != singleDraws) {
+            std::cout << "ERROR::BENCH::DRAW_COUNT_MISMATCH " << draws << " != " << singleDraws << std::endl;
+            same = false;
+        }
+    }
+    return same ? 0 : 1;
+}
+
+bool ParseRunOptions(int argc, char** argv, RunOptions& options)
+{
+    for (int i = 1; i < argc; i += 2) {
+        if (i + 1 >= argc) {
+            return false;
+        }
+        if (std::strcmp(argv[i], "--shader-budget-ms") == 0) {
+            options.ShaderBudgetMs = std::atof(argv[i + 1]);
+        }
+        else if (std::strcmp(argv[i], "--shader-report") == 0) {
+            options.ShaderReportPath = argv[i + 1];
+        }
+        else if (std::strcmp(argv[i], "--stress-cubes") == 0) {
+            options.StressCubes = static_cast<unsigned>(std::max(0, std::atoi(argv[i + 1])));
+        }
+        else {
+            return false;
+        }
+    }
+    return true;
+}
+
+int RunTool(int argc, char** argv)
+{
+    const char* mode = argv[1];
+
+    if (std::strcmp(mode, "--pack-shaders") == 0) {
+        if (argc < 4) {
+            PrintUsage();
+            return 1;
+        }
+        std::vector<std::string> inputs(argv + 3, argv + argc);
+        return ShaderArchive::Pack(argv[2], inputs);
+    }
+
+    if (std::strcmp(mode, "--compile-spirv") == 0) {
+        if (argc != 5) {
+            PrintUsage();
+            return 1;
+        }
+        const unsigned features = ParseFeatures(argv[2]);
+        const int vertex = Spirv::CompileModule(argv[3], "vert", features);
+        const int fragment = Spirv::CompileModule(argv[4], "frag", features);
+        return vertex != 0 ? vertex : fragment;
+    }
+
+    if (std::strcmp(mode, "--bench-spirv") == 0) {
+        if (argc != 5 && argc != 6) {
+            PrintUsage();
+            return 1;
+        }
+        const int iterations = argc == 6 ? std::max(1, std::atoi(argv[5])) : 20;
+        return BenchSpirv(ParseFeatures(argv[2]), argv[3], argv[4], iterations);
+    }
+
+    if (std::strcmp(mode, "--bench-mesh-optimizer") == 0) {
+        const unsigned meshCount = argc > 2 ? std::max(1, std::atoi(argv[2])) : 16;
+        const unsigned gridSize = argc > 3 ? std::max(1, std::atoi(argv[3])) : 128;
+        return BenchMeshOptimizer(meshCount, gridSize);
+    }
+
+    if (std::strcmp(mode, "--bench-meshlets") == 0) {
+        const unsigned segments = argc > 2 ? std::max(3, std::atoi(argv[2])) : 256;
+        return BenchMeshlets(segments);
+    }
+
+    if (std::strcmp(mode, "--convert-mesh") == 0) {
+        const bool compress = argc == 5 && std::strcmp(argv[4], "--compress") == 0;
+        if (argc != 4 && !compress) {
+            PrintUsage();
+            return 1;
+        }
+        return MeshImport::Convert(argv[2], argv[3], compress);
+    }
+
+    if (std::strcmp(mode, "--bench-obj-import") == 0) {
+        const size_t megabytes = argc > 2 ? std::max(1, std::atoi(argv[2])) : 500;
+        return BenchObjImport(megabytes);
+    }
+
+    if (std::strcmp(mode, "--bench-mesh-codec") == 0) {
+        return BenchMeshCodec(argc > 2 ? argv[2] : nullptr);
+    }
+
+    if (std::strcmp(mode, "--bench-command-buffers") == 0) {
+        const unsigned objectCount = argc > 2 ? std::max(1, std::atoi(argv[2])) : 100000;
+        const unsigned frames = argc > 3 ? std::max(1, std::atoi(argv[3])) : 30;
+        return BenchCommandBuffers(objectCount, frames);
+    }
+
+    std::cout << "ERROR::TOOLS::UNKNOWN_MODE " << mode << std::endl;
+    PrintUsage();
+    return 1;
+}
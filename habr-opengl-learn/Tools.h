@@ -0,0 +1,33 @@
+#pragma once
+#include <string>
+
+// Офлайн-режимы приложения, запускаются без основного окна:
+//   habr-opengl-learn --pack-shaders out.pak a.glsl b.glsl ...
+//   habr-opengl-learn --compile-spirv <features> <vertex.glsl> <fragment.glsl>
+//   habr-opengl-learn --bench-spirv <features> <vertex.glsl> <fragment.glsl> [iterations]
+//   habr-opengl-learn --bench-mesh-optimizer [meshes] [gridSize]
+//   habr-opengl-learn --bench-meshlets [segments]
+//   habr-opengl-learn --convert-mesh <model.obj|.gltf|.glb> <out.mesh> [--compress]
+//   habr-opengl-learn --bench-obj-import [megabytes]
+//   habr-opengl-learn --bench-mesh-codec [model.obj|.gltf|.glb]
+//   habr-opengl-learn --bench-command-buffers [objects] [frames]
+// Например, модули для урока 19:
+//   habr-opengl-learn --compile-spirv 2 shader-1.8-vertexProjections3DCube.glsl shader-fragmentTextured.glsl
+// или куб для урока 19 из OBJ:
+//   habr-opengl-learn --convert-mesh Resources/Models/cube.obj Resources/Models/cube.mesh
+// Возвращает код выхода процесса.
+int RunTool(int argc, char** argv);
+
+// Параметры обычного запуска с окном:
+//   --shader-budget-ms <ms>  пометить программы, чьи компиляция и линковка дольше; код выхода 3
+//   --shader-report <file>   куда писать JSON телеметрии шейдеров при выходе
+//   --stress-cubes <count>   урок 19 с count кубами и фигурами (например, 100000): время кадра и число отрисовок
+//                            цикла, очереди с сортировкой, очередей на потоках, instancing и multi-draw indirect
+struct RunOptions {
+    double ShaderBudgetMs = 0.0;
+    std::string ShaderReportPath = "shader-telemetry.json";
+    unsigned StressCubes = 0;
+};
+
+// true - все аргументы оказались параметрами запуска, false - это офлайн-режим для RunTool
+bool ParseRunOptions(int argc, char** argv, RunOptions& options);
@@ -0,0 +1,34 @@
+#include "VertexLayout.h"
+
+const VertexFormatInfo& GetVertexFormatInfo(VertexFormat format)
+{
+    // Порядок совпадает с VertexFormat
+    static const VertexFormatInfo FORMATS[] = {
+        { 1, GL_FLOAT, GL_FALSE, 4 },
+        { 2, GL_FLOAT, GL_FALSE, 8 },
+        { 3, GL_FLOAT, GL_FALSE, 12 },
+        { 4, GL_FLOAT, GL_FALSE, 16 },
+        { 3, GL_HALF_FLOAT, GL_FALSE, 8 },
+        { 4, GL_UNSIGNED_BYTE, GL_TRUE, 4 },
+        { 2, GL_UNSIGNED_SHORT, GL_TRUE, 4 },
+        { 4, GL_INT_2_10_10_10_REV, GL_TRUE, 4 },
+    };
+    return FORMATS[static_cast<int>(format)];
+}
+
+VertexLayout& VertexLayout::Add(GLuint location, VertexFormat format)
+{
+    attributes.push_back({ location, format, stride });
+    stride += GetVertexFormatInfo(format).Size;
+    return *this;
+}
+
+void VertexLayout::Apply() const
+{
+    for (const VertexAttribute& attribute : attributes) {
+        const VertexFormatInfo& info = GetVertexFormatInfo(attribute.Format);
+        glVertexAttribPointer(attribute.Location, info.Components, info.Type, info.Normalized,
+            static_cast<GLsizei>(stride), (GLvoid*)attribute.Offset);
+        glEnableVertexAttribArray(attribute.Location);
+    }
+}
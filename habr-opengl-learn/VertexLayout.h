@@ -0,0 +1,64 @@
+#pragma once
+#include "Common.h"
+#include <cstddef>
+#include <vector>
+
+// Форматы атрибутов вершины. Кроме float - упакованные варианты для экономии памяти и полосы:
+enum class VertexFormat {
+    Float1,
+    Float2,
+    Float3,
+    Float4,
+    // Позиция в half-float: 3 компоненты + 2 байта выравнивания, 8 байт вместо 12
+    Half3,
+    // Цвет RGBA по байту на канал, нормализованный в [0, 1]
+    UNorm8x4,
+    // UV по 16 бит, нормализованные в [0, 1]
+    UNorm16x2,
+    // Нормаль 10_10_10_2 со знаком (GL_INT_2_10_10_10_REV), нормализованная в [-1, 1]
+    SNorm10x3,
+};
+
+// Что знает о формате glVertexAttribPointer
+struct VertexFormatInfo {
+    GLint Components;
+    GLenum Type;
+    GLboolean Normalized;
+    // Размер в буфере, с выравниванием до 4 байт
+    size_t Size;
+};
+
+const VertexFormatInfo& GetVertexFormatInfo(VertexFormat format);
+
+struct VertexAttribute {
+    GLuint Location;
+    VertexFormat Format;
+    size_t Offset;
+};
+
+// Описание вершины вместо ручных glVertexAttribPointer с шагами и смещениями:
+//   static const VertexLayout layout = VertexLayout().Add(0, VertexFormat::Half3).Add(1, VertexFormat::UNorm16x2);
+//   layout.Apply();
+// Атрибуты идут подряд в порядке добавления, смещения и шаг считаются сами.
+class VertexLayout
+{
+public:
+    VertexLayout& Add(GLuint location, VertexFormat format);
+
+    size_t Stride() const
+    {
+        return stride;
+    }
+
+    const std::vector<VertexAttribute>& Attributes() const
+    {
+        return attributes;
+    }
+
+    // Настраивает и включает атрибуты. VAO и VBO должны быть привязаны.
+    void Apply() const;
+
+private:
+    std::vector<VertexAttribute> attributes;
+    size_t stride = 0;
+};
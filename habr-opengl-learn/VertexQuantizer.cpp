@@ -0,0 +1,181 @@
+#include "VertexQuantizer.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+std::uint16_t VertexQuantizer::FloatToHalf(float value)
+{
+    // Округление к ближайшему четному через сложение с магическими константами (F. Giesen)
+    const std::uint32_t F32_INFINITY = 255u << 23;
+    const std::uint32_t F16_MAX = (127u + 16u) << 23;
+    const std::uint32_t DENORM_MAGIC = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+    std::uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const std::uint32_t sign = bits & 0x80000000u;
+    bits ^= sign;
+
+    std::uint16_t half;
+    if (bits >= F16_MAX) {
+        // Бесконечность или NaN
+        half = bits > F32_INFINITY ? 0x7E00 : 0x7C00;
+    }
+    else if (bits < (113u << 23)) {
+        // Денормализованное half или ноль: мантисса выравнивается сложением с константой
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        float magic;
+        memcpy(&magic, &DENORM_MAGIC, sizeof(magic));
+        f += magic;
+        memcpy(&bits, &f, sizeof(bits));
+        half = static_cast<std::uint16_t>(bits - DENORM_MAGIC);
+    }
+    else {
+        const std::uint32_t mantissaOdd = (bits >> 13) & 1;
+        bits += (static_cast<std::uint32_t>(15 - 127) << 23) + 0xFFF;
+        bits += mantissaOdd;
+        half = static_cast<std::uint16_t>(bits >> 13);
+    }
+    return static_cast<std::uint16_t>(half | (sign >> 16));
+}
+
+float VertexQuantizer::HalfToFloat(std::uint16_t value)
+{
+    const std::uint32_t SHIFTED_EXPONENT = 0x7C00u << 13;
+    const std::uint32_t MAGIC = 113u << 23;
+
+    std::uint32_t bits = (value & 0x7FFFu) << 13;
+    const std::uint32_t exponent = SHIFTED_EXPONENT & bits;
+    bits += (127u - 15u) << 23;
+    if (exponent == SHIFTED_EXPONENT) {
+        bits += (128u - 16u) << 23;
+    }
+    else if (exponent == 0) {
+        bits += 1u << 23;
+        float f;
+        memcpy(&f, &bits, sizeof(f));
+        float magic;
+        memcpy(&magic, &MAGIC, sizeof(magic));
+        f -= magic;
+        memcpy(&bits, &f, sizeof(bits));
+    }
+    bits |= static_cast<std::uint32_t>(value & 0x8000u) << 16;
+
+    float result;
+    memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+static float Clamp(float value, float low, float high)
+{
+    return std::min(std::max(value, low), high);
+}
+
+// Упаковывает один атрибут, в decoded кладет то, что увидит шейдер
+static void Pack(VertexFormat format, const float values[4], std::uint8_t* out, float decoded[4])
+{
+    switch (format) {
+    case VertexFormat::Half3: {
+        std::uint16_t halves[4] = { 0, 0, 0, 0 };
+        for (int i = 0; i < 3; ++i) {
+            halves[i] = VertexQuantizer::FloatToHalf(values[i]);
+            decoded[i] = VertexQuantizer::HalfToFloat(halves[i]);
+        }
+        memcpy(out, halves, sizeof(halves));
+        break;
+    }
+    case VertexFormat::UNorm8x4:
+        for (int i = 0; i < 4; ++i) {
+            out[i] = static_cast<std::uint8_t>(std::lround(Clamp(values[i], 0.f, 1.f) * 255.f));
+            decoded[i] = out[i] / 255.f;
+        }
+        break;
+    case VertexFormat::UNorm16x2: {
+        std::uint16_t shorts[2];
+        for (int i = 0; i < 2; ++i) {
+            shorts[i] = static_cast<std::uint16_t>(std::lround(Clamp(values[i], 0.f, 1.f) * 65535.f));
+            decoded[i] = shorts[i] / 65535.f;
+        }
+        memcpy(out, shorts, sizeof(shorts));
+        break;
+    }
+    case VertexFormat::SNorm10x3: {
+        // Правило OpenGL 4.2+: f = max(c / 511, -1); в 3.3 было (2c + 1) / 1023, разница меньше 0.001
+        std::uint32_t packed = 0;
+        for (int i = 0; i < 3; ++i) {
+            const int component = static_cast<int>(std::lround(Clamp(values[i], -1.f, 1.f) * 511.f));
+            packed |= (static_cast<std::uint32_t>(component) & 0x3FFu) << (10 * i);
+            decoded[i] = std::max(component / 511.f, -1.f);
+        }
+        const int w = static_cast<int>(std::lround(Clamp(values[3], -1.f, 1.f)));
+        packed |= (static_cast<std::uint32_t>(w) & 0x3u) << 30;
+        decoded[3] = static_cast<float>(w);
+        memcpy(out, &packed, sizeof(packed));
+        break;
+    }
+    default: {
+        const GLint components = GetVertexFormatInfo(format).Components;
+        memcpy(out, values, components * sizeof(float));
+        memcpy(decoded, values, components * sizeof(float));
+        break;
+    }
+    }
+}
+
+std::vector<std::uint8_t> VertexQuantizer::Convert(const void* vertices, size_t vertexCount, const VertexLayout& source, const VertexLayout& target,
+    QuantizeReport* report)
+{
+    const std::vector<VertexAttribute>& sourceAttributes = source.Attributes();
+    const std::vector<VertexAttribute>& targetAttributes = target.Attributes();
+    const size_t attributeCount = std::min(sourceAttributes.size(), targetAttributes.size());
+
+    std::vector<std::uint8_t> packed(vertexCount * target.Stride(), 0);
+    std::vector<float> maxError(attributeCount, 0.f);
+    const std::uint8_t* in = static_cast<const std::uint8_t*>(vertices);
+
+    for (size_t v = 0; v < vertexCount; ++v) {
+        for (size_t a = 0; a < attributeCount; ++a) {
+            const VertexAttribute& from = sourceAttributes[a];
+            const VertexAttribute& to = targetAttributes[a];
+            const GLint sourceComponents = GetVertexFormatInfo(from.Format).Components;
+            const GLint targetComponents = GetVertexFormatInfo(to.Format).Components;
+
+            // Недостающие компоненты - как их подставил бы OpenGL: (0, 0, 0, 1);
+            // у нормали w не используется
+            float values[4] = { 0.f, 0.f, 0.f, to.Format == VertexFormat::SNorm10x3 ? 0.f : 1.f };
+            memcpy(values, in + v * source.Stride() + from.Offset, std::min(sourceComponents, 4) * sizeof(float));
+
+            float decoded[4] = { 0.f, 0.f, 0.f, 0.f };
+            Pack(to.Format, values, packed.data() + v * target.Stride() + to.Offset, decoded);
+
+            const GLint compared = std::min(sourceComponents, targetComponents);
+            for (GLint i = 0; i < compared; ++i) {
+                maxError[a] = std::max(maxError[a], std::fabs(decoded[i] - values[i]));
+            }
+        }
+    }
+
+    if (report != nullptr) {
+        report->MaxError = maxError;
+        report->SourceBytes = vertexCount * source.Stride();
+        report->PackedBytes = packed.size();
+    }
+    return packed;
+}
+
+std::vector<std::uint8_t> VertexQuantizer::Convert(const std::vector<GLfloat>& vertices, const VertexLayout& source, const VertexLayout& target,
+    QuantizeReport* report)
+{
+    return Convert(vertices.data(), vertices.size() * sizeof(GLfloat) / source.Stride(), source, target, report);
+}
+
+void VertexQuantizer::PrintReport(const char* name, const QuantizeReport& report)
+{
+    std::cout << "VertexQuantizer: " << name
+        << " bytes=" << report.SourceBytes << "->" << report.PackedBytes
+        << " (" << (report.PackedBytes ? float(report.SourceBytes) / report.PackedBytes : 0.f) << "x) maxError=";
+    for (size_t i = 0; i < report.MaxError.size(); ++i) {
+        std::cout << (i ? "/" : "") << report.MaxError[i];
+    }
+    std::cout << std::endl;
+}
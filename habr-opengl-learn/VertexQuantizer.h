@@ -0,0 +1,27 @@
+#pragma once
+#include "VertexLayout.h"
+#include <cstdint>
+#include <vector>
+
+struct QuantizeReport {
+    // Наибольшая абсолютная ошибка по компонентам каждого атрибута, в порядке атрибутов
+    std::vector<float> MaxError;
+    size_t SourceBytes = 0;
+    size_t PackedBytes = 0;
+};
+
+// Перевод вершин из float в упакованные форматы VertexLayout.
+// Атрибуты source и target сопоставляются по порядку; у source все форматы - Float*.
+// Значения вне диапазона нормализованных форматов обрезаются, это видно по MaxError.
+namespace VertexQuantizer {
+    std::vector<std::uint8_t> Convert(const void* vertices, size_t vertexCount, const VertexLayout& source, const VertexLayout& target,
+        QuantizeReport* report = nullptr);
+
+    std::vector<std::uint8_t> Convert(const std::vector<GLfloat>& vertices, const VertexLayout& source, const VertexLayout& target,
+        QuantizeReport* report = nullptr);
+
+    std::uint16_t FloatToHalf(float value);
+    float HalfToFloat(std::uint16_t value);
+
+    void PrintReport(const char* name, const QuantizeReport& report);
+}
@@ -1,4 +1,9 @@
 #version 330 core
+#ifdef SEPARABLE
+// Отдельная стадия конвейера: встроенный блок вывода объявляется явно
+#extension GL_ARB_separate_shader_objects : require
+out gl_PerVertex { vec4 gl_Position; };
+#endif
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 color;
 layout (location = 2) in vec2 texCoord;
@@ -6,14 +11,11 @@ layout (location = 2) in vec2 texCoord;
 out vec3 ourColor;
 out vec2 TexCoord;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#include "shader-common-matrices.glsl"
 
 void main()
 {
-    // Заметьте, что мы читаем умножение справа налево
-    gl_Position = projection * view * model * vec4(position, 1.0f);
+    gl_Position = ProjectPosition(position);
     ourColor = color;
     TexCoord = texCoord;
-}
\ No newline at end of file
+}
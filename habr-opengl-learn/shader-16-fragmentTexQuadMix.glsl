@@ -1,16 +0,0 @@
-#version 330 core
-
-in vec3 ourColor;
-in vec2 TexCoord;
-
-out vec4 color;
-
-uniform sampler2D ourTexture1;
-uniform sampler2D ourTexture2;
-
-uniform float alpha;
-
-void main()
-{
-    color = mix(texture(ourTexture1, TexCoord), texture(ourTexture2, vec2(TexCoord.x, 1.0 - TexCoord.y)), clamp(alpha, 0.0, 1.0));
-}
\ No newline at end of file
@@ -0,0 +1,33 @@
+// Общий блок матриц для вершинных шейдеров, подключается через #include
+#ifdef MODEL_BLOCK
+// Матрица объекта лежит в кольцевом буфере кадра (FrameRing), участок привязывает glBindBufferRange
+layout (std140) uniform ModelBlock
+{
+    mat4 model;
+};
+#else
+uniform mat4 model;
+#endif
+uniform mat4 view;
+uniform mat4 projection;
+
+#ifdef INSTANCED
+// InstanceTransform из GeometryArena: позиция и масштаб, кватернион поворота
+layout (location = 6) in vec4 instancePositionScale;
+layout (location = 7) in vec4 instanceRotation;
+
+vec3 RotateByQuaternion(vec3 v, vec4 q)
+{
+    return v + 2.0f * cross(q.xyz, cross(q.xyz, v) + q.w * v);
+}
+#endif
+
+vec4 ProjectPosition(vec3 position)
+{
+#ifdef INSTANCED
+    // Сначала экземпляр, потом общая модель - как glm::translate * glm::rotate * glm::scale в цикле
+    position = RotateByQuaternion(position * instancePositionScale.w, instanceRotation) + instancePositionScale.xyz;
+#endif
+    // Заметьте, что мы читаем умножение справа налево
+    return projection * view * model * vec4(position, 1.0f);
+}
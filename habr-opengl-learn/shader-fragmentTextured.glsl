@@ -0,0 +1,34 @@
+#version 330 core
+// Перестановки: TWO_TEXTURES - смешивание двух текстур, VERTEX_COLOR - тонировка цветом вершин
+
+#ifdef VERTEX_COLOR
+in vec3 ourColor;
+#endif
+in vec2 TexCoord;
+
+out vec4 color;
+
+#ifdef TWO_TEXTURES
+uniform sampler2D ourTexture1;
+uniform sampler2D ourTexture2;
+
+uniform float alpha = 0.2;
+#else
+uniform sampler2D ourTexture;
+#endif
+
+// Меньше 1 - полупрозрачный, RenderQueue рисует такие со смешиванием
+uniform float opacity = 1.0;
+
+void main()
+{
+#ifdef TWO_TEXTURES
+    color = mix(texture(ourTexture1, TexCoord), texture(ourTexture2, vec2(TexCoord.x, 1.0 - TexCoord.y)), clamp(alpha, 0.0, 1.0));
+#else
+    color = texture(ourTexture, TexCoord);
+#endif
+#if defined(VERTEX_COLOR) && !defined(TWO_TEXTURES)
+    color *= vec4(ourColor, 1.0f);
+#endif
+    color.a *= opacity;
+}